@@ -58,18 +58,54 @@ extern const char* LM_VERSION;
 #define LM_CODING_RATE 7U
 #define LM_PREAMBLE_LENGTH 8U
 #define LM_POWER 6
+
+// Percentage of the airtime used over a sliding window of one hour, for each frequency. 100 disables the limit
 #define LM_DUTY_CYCLE 100
 
+// Number of frequencies with their own airtime ledger
+#define LM_MAX_SUB_BANDS 4
+
+// Transmit power control. The unicast packets are sent with the lowest power that keeps this margin in dB over the demodulation
+// floor of the spreading factor, using the SNR reported by the next hop. The broadcast packets use the configured power
+#define LM_TX_POWER_SNR_MARGIN 10
+#define LM_MIN_POWER 2
+
+// Listen before talk. Maximum number of channel activity detections before sending a packet anyway
+#define LM_CSMA_MAX_ATTEMPTS 5
+
+// Binary exponential backoff before each channel activity detection, between 0 and 2^exponent times the time on air of the packet.
+// The backoff window is never longer than LM_CSMA_MAX_BACKOFF ms, so the slow spreading factors do not wait minutes
+#define LM_CSMA_MIN_BACKOFF_EXPONENT 1
+#define LM_CSMA_MAX_BACKOFF_EXPONENT 5
+#define LM_CSMA_MAX_BACKOFF 4000
+
 //Syncronization Word that identifies the mesh network
 #define LM_SYNC_WORD 19U
 
 // Comment this line if you want to remove the crc for each packet
 #define LM_ADDCRC_PAYLOAD
 
+// Uncomment this line to send the packet headers compacted, they are sent as they are in memory by default. The compact header elides
+// the fields implied by the type, the id and the packet size. The nodes of the previous versions cannot decode it, all the nodes of
+// the network need the same option
+// #define LM_COMPACT_HEADER
+#define LM_COMPACT_HEADER_VERSION 1
+
+// Comment this line to send the routes of the route packets as they are in memory. The compact routes are sorted by address,
+// with the address delta and the role flag in a varint, the metric in a nibble shared by two routes and the role only when it is not ROLE_DEFAULT.
+// The route packets are flagged with LM_ROUTE_COMPACT, the nodes decode both encodings
+#define LM_COMPACT_ROUTES
+
+// Comment this line to use the blocking transmit. The send task waits the TX done interrupt instead of polling the radio
+#define LM_ASYNC_TRANSMIT
+
+// Comment this line to process the packets in transit inside the process routine. The receive routine forwards them directly to the send queue
+#define LM_FAST_FORWARDING
+
 // Routing table max size
 #define RTMAXSIZE 256
 
-//MAX packet size per packet in bytes. It could be changed between 13 and 255 bytes. Recommended 100 or less bytes.
+//MAX packet size per packet in bytes. It could be changed between 21 and 255 bytes, smaller sizes are raised to the minimum. Recommended 100 or less bytes.
 //If exceed it will be automatically separated through multiple packets 
 //In bytes (226 bytes [UE max allowed with SF7 and 125khz])
 //MAX payload size for hello packets = LM_MAX_PACKET_SIZE - 7 bytes of header
@@ -77,14 +113,23 @@ extern const char* LM_VERSION;
 //MAX payload size for reliable and large packets = LM_MAX_PACKET_SIZE - 7 bytes of header - 2 bytes of via - 3 of control packet
 #define LM_MAX_PACKET_SIZE 100
 
-// Packet types
+//Number of preallocated packet buffers of LM_MAX_PACKET_SIZE bytes. If all are in use, the packets are allocated in the heap
+#define LM_PACKET_POOL_SIZE 32
+
+//Number of received frames that can wait to be processed. If the ring is full, the received frames are dropped
+#define LM_RECEIVED_RING_SIZE 16
+
+// Packet types. HELLO_P are the route packets of the previous versions. ROUTING_P carries the advertisement sequence, the flags and the
+// link qualities, the previous versions ignore it. The nodes decode both, and also send HELLO_P while they hear nodes of the previous versions
 #define NEED_ACK_P 0b00000011
 #define DATA_P     0b00000010
 #define HELLO_P    0b00000100
+#define ROUTING_P  0b00001000
 #define ACK_P      0b00001010
 #define XL_DATA_P  0b00010010
 #define LOST_P     0b00100010
 #define SYNC_P     0b01000010
+#define AGGREGATED_P 0b10000010
 
 // Packet configuration
 #define BROADCAST_ADDR 0xFFFF
@@ -96,8 +141,73 @@ extern const char* LM_VERSION;
 #define DEFAULT_TIMEOUT HELLO_PACKETS_DELAY*5
 #define MIN_TIMEOUT 20
 
+//Route advertisements. Every HELLO_PACKETS_DELAY s a node advertises only the routes added, changed or withdrawn since its previous advertisement.
+//The changes are advertised between LM_TRIGGERED_ROUTING_DELAY and 2 * LM_TRIGGERED_ROUTING_DELAY s after them, and the whole routing table every LM_FULL_ROUTING_DELAY s
+#define LM_TRIGGERED_ROUTING_DELAY 5
+#define LM_FULL_ROUTING_DELAY HELLO_PACKETS_DELAY*4
+
+// Route advertisement flags
+#define LM_ROUTE_FULL 0b00000001
+#define LM_ROUTE_FULL_FIRST 0b00000010
+#define LM_ROUTE_REQUEST_FULL 0b00000100
+#define LM_ROUTE_COMPACT 0b00001000
+#define LM_ROUTE_FULL_LAST 0b00010000
+
+//Metric of the withdrawn routes inside the route advertisements
+#define LM_ROUTE_WITHDRAWN_METRIC 0xFF
+
+//Routing metrics. The metric of a route is the sum of the cost of its links, between 1 and LM_MAX_LINK_COST.
+//LM_HOP_COUNT_METRIC: every link costs 1.
+//LM_SNR_METRIC: 1 when the worst SNR of both directions is LM_SNR_COST_MARGIN dB over the demodulation floor, plus 1 every LM_SNR_COST_STEP dB below.
+//LM_ETX_METRIC: expected transmission count, from the route packets lost in both directions.
+#define LM_HOP_COUNT_METRIC 0
+#define LM_SNR_METRIC 1
+#define LM_ETX_METRIC 2
+//Default routing metric, the hop count of the previous versions. LM_SNR_METRIC and LM_ETX_METRIC are opt-in
+#define LM_ROUTING_METRIC LM_HOP_COUNT_METRIC
+#define LM_MAX_LINK_COST 4
+#define LM_SNR_COST_MARGIN 8
+#define LM_SNR_COST_STEP 3
+
+//The next hop of a route only changes when the new metric improves the actual one more than LM_ROUTE_HYSTERESIS, with the SNR and ETX metrics
+#define LM_ROUTE_HYSTERESIS 1
+
+//Maximum number of next hops of each route, the best one and LM_MAX_NEXT_HOPS - 1 alternatives ranked by metric. 1 disables the alternatives.
+//A next hop is considered dead after LM_FAILOVER_TIMEOUTS timeouts of a reliable sequence, and its routes change to the best alternative
+#define LM_MAX_NEXT_HOPS 3
+#define LM_FAILOVER_TIMEOUTS 3
+
 //Maximum times that a sequence of packets reach the timeout
 #define MAX_TIMEOUTS 10
+
+//Maximum number of reliable sequences open at the same time, for each direction (sending and receiving)
+#define LM_MAX_SEQUENCES 32
+
+//Number of packets of a reliable sequence that can be sent without waiting for their ACK. 1 is stop-and-wait
+#define LM_RELIABLE_WINDOW 1
+#define LM_MAX_RELIABLE_WINDOW 64
+
+//Maximum number of packets of a reliable sequence. The receiver allocates the whole payload when the sequence starts, bigger sequences are rejected
+#define LM_MAX_SEQUENCE_PACKETS 128
+
+//The receiver of a reliable sequence sends one ACK every LM_DELAYED_ACK_COUNT packets, or when the timeout in ms is reached.
+//The ACKs are never delayed more than the window of the sequence, and they are sent immediately on gaps or repeated packets
+#define LM_DELAYED_ACK_COUNT 2
+#define LM_DELAYED_ACK_TIMEOUT 1000
+
+//Data packets with the same next hop are sent inside a single aggregated packet, up to LM_MAX_AGGREGATED_PACKETS.
+//A data packet waits LM_AGGREGATION_HOLD_TIME ms for other data packets when the send queue is empty. 0 only aggregates the queued packets
+#define LM_MAX_AGGREGATED_PACKETS 16
+#define LM_AGGREGATION_HOLD_TIME 0
+
+//Maximum number of packets of each traffic class inside the send queue. The new packets of a full class are dropped
+//The routing limit is raised to the packets of a full routing table advertisement of RTMAXSIZE routes.
+//Forwarded data packets received more than LM_FORWARDED_MAX_AGE ms ago are dropped instead of being sent. 0 disables it
+#define LM_ROUTING_QUEUE_LIMIT 8
+#define LM_CONTROL_QUEUE_LIMIT 32
+#define LM_FORWARDED_QUEUE_LIMIT 16
+#define LM_LOCAL_QUEUE_LIMIT 32
+#define LM_FORWARDED_MAX_AGE 30000
 #define MAX_RESEND_PACKET 3
 #define MAX_TRY_BEFORE_SEND 5
 
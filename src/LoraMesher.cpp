@@ -1,5 +1,8 @@
 #include "LoraMesher.h"
 
+#include <algorithm>
+#include <cassert>
+
 #ifndef ARDUINO
 #include "EspHal.h"
 #endif
@@ -81,10 +84,12 @@ LoraMesher::~LoraMesher() {
 
     ToSendPackets->Clear();
     delete ToSendPackets;
-    ReceivedPackets->Clear();
-    delete ReceivedPackets;
+    delete ReceivedFrames;
     ReceivedAppPackets->Clear();
     delete ReceivedAppPackets;
+    delete q_WSPIndex;
+    delete q_WRPIndex;
+    vSemaphoreDelete(transmitDoneSemaphore);
 
     clearDioActions();
     radio->reset();
@@ -114,7 +119,44 @@ void LoraMesher::restartRadio() {
 void LoraMesher::initConfiguration() {
     ESP_LOGV(LM_TAG, "Initializing Configuration");
 
+    //The hello packets need room for at least one route and one link quality
+    size_t minPacketSize = PacketService::getMinPacketSize();
+    if (loraMesherConfig->max_packet_size < minPacketSize) {
+        ESP_LOGE(LM_TAG, "Max packet size %u too small, raised to %u bytes", (unsigned) loraMesherConfig->max_packet_size, (unsigned) minPacketSize);
+        loraMesherConfig->max_packet_size = minPacketSize;
+    }
+
     PacketFactory::setMaxPacketSize(loraMesherConfig->max_packet_size);
+
+    LM_PacketPool::getInstance().init(loraMesherConfig->max_packet_size, loraMesherConfig->packetPoolSize);
+
+    airtimeLedger.setDutyCycle(loraMesherConfig->dutyCycle);
+
+    //Demodulation floor of the spreading factor, from -7.5 dB at SF7 to -20 dB at SF12, rounded up to keep the margins.
+    //Shared by the SNR metric and the transmit power control
+    RoutingTableService::setRoutingMetric(loraMesherConfig->routingMetric, loraMesherConfig->routeHysteresis,
+        (int8_t) ceil(-2.5f * (loraMesherConfig->sf - 4)));
+
+    RoutingTableService::setRouteRemovedCallback([](uint16_t address) { LoraMesher::getInstance().onRouteRemoved(address); });
+
+    //A full routing table advertisement fits inside the routing queue. A dropped route packet leaves a gap in the advertisement sequence
+    //and the neighbors request the full routing table again. The first packet has at least one route, the others are full of routes.
+    //The advertisement for the nodes of the previous versions can be queued at the same time
+    size_t routesPerPacket = (loraMesherConfig->max_packet_size - sizeof(RoutePacket)) / PacketService::getMaxRouteLength();
+    size_t legacyRoutesPerPacket = (loraMesherConfig->max_packet_size - sizeof(LegacyRoutePacket)) / sizeof(NetworkNode);
+    uint16_t fullRoutingPackets = 1 + (RTMAXSIZE - 1 + routesPerPacket - 1) / routesPerPacket +
+        (RTMAXSIZE + legacyRoutesPerPacket - 1) / legacyRoutesPerPacket;
+    if (loraMesherConfig->sendQueueLimits[ROUTING_CLASS] < fullRoutingPackets) {
+        ESP_LOGW(LM_TAG, "Routing queue limit raised to %d packets, a full routing table advertisement", fullRoutingPackets);
+        loraMesherConfig->sendQueueLimits[ROUTING_CLASS] = fullRoutingPackets;
+    }
+
+    if (ReceivedFrames == nullptr ||
+        ReceivedFrames->getMaxFrameSize() != loraMesherConfig->max_packet_size ||
+        ReceivedFrames->getCapacity() < loraMesherConfig->receivedFramesRingSize) {
+        delete ReceivedFrames;
+        ReceivedFrames = new LM_ReceivedFrameRing(loraMesherConfig->receivedFramesRingSize, loraMesherConfig->max_packet_size);
+    }
 }
 
 void LoraMesher::initializeLoRa() {
@@ -215,6 +257,8 @@ void LoraMesher::initializeLoRa() {
         ESP_LOGE(LM_TAG, "Radio module gave error: %d", res);
     }
 
+    currentPower = config.power;
+
 #ifdef LM_ADDCRC_PAYLOAD
     radio->setCRC(true);
 #endif
@@ -222,10 +266,9 @@ void LoraMesher::initializeLoRa() {
 }
 
 void LoraMesher::setDioActionsForScanChannel() {
-    // set the function that will be called
-    // when LoRa preamble is detected
+    // The blocking scan polls the interrupt pins by itself, the receive action
+    // would be called when the scan finishes
     clearDioActions();
-    // radio->setDioActionForScanning(onReceive);
 }
 
 void LoraMesher::setDioActionsForReceivePacket() {
@@ -251,16 +294,23 @@ int LoraMesher::startReceiving() {
     return res;
 }
 
-void LoraMesher::channelScan() {
+bool LoraMesher::channelScan() {
     setDioActionsForScanChannel();
 
     int res = radio->scanChannel();
 
-    if (res != RADIOLIB_ERR_NONE) {
-        ESP_LOGE(LM_TAG, "Starting new scan failed, code %d", res);
-        channelScan();
+    incChannelScans();
+
+    if (res == RADIOLIB_PREAMBLE_DETECTED || res == RADIOLIB_LORA_DETECTED) {
+        incChannelBusy();
+        return false;
     }
 
+    //If the scan fails, only the backoff protects the packet
+    if (res != RADIOLIB_CHANNEL_FREE)
+        ESP_LOGE(LM_TAG, "Channel scan failed, code %d", res);
+
+    return true;
 }
 
 //TODO: Retry start channel scan if it fails
@@ -342,6 +392,18 @@ void LoraMesher::initializeSchedulers() {
     vTaskDelay(5000 / portTICK_PERIOD_MS);
 }
 
+#if defined(ESP8266) || defined(ESP32)
+ICACHE_RAM_ATTR
+#endif
+void LoraMesher::onTransmitDone(void) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR(LoraMesher::getInstance().transmitDoneSemaphore, &xHigherPriorityTaskWoken);
+
+    if (xHigherPriorityTaskWoken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
 #if defined(ESP8266) || defined(ESP32)
 ICACHE_RAM_ATTR
 #endif
@@ -381,23 +443,36 @@ void LoraMesher::receivingRoutine() {
             hasReceivedMessage = true;
 
             packetSize = radio->getPacketLength();
+
+            //Get a free slot of the received frames ring, it is only written by this task
+            LM_ReceivedFrame* frame = ReceivedFrames->acquireWrite();
+
             if (packetSize == 0)
                 ESP_LOGW(LM_TAG, "Empty packet received");
+            else if (frame == nullptr) {
+                ESP_LOGW(LM_TAG, "Received frames ring full, dropping packet");
+                incReceivedDropped();
+            }
             else {
-                Packet<uint8_t>* rx = PacketService::createEmptyPacket(packetSize);
-
                 rssi = (int8_t) round(radio->getRSSI());
                 snr = (int8_t) round(radio->getSNR());
 
                 ESP_LOGI(LM_TAG, "Receiving LoRa packet: Size: %d bytes RSSI: %d SNR: %d", packetSize, rssi, snr);
 
-                size_t max_packet_size = PacketFactory::getMaxPacketSize();
+                size_t max_packet_size = ReceivedFrames->getMaxFrameSize();
                 if (packetSize > max_packet_size) {
+#ifdef LM_COMPACT_HEADER
+                    //The compact header has no packet size to detect a truncated frame, the frame is dropped
+                    ESP_LOGW(LM_TAG, "Received packet with size greater than MAX Packet Size, dropping it");
+                    startReceiving();
+                    continue;
+#else
                     ESP_LOGW(LM_TAG, "Received packet with size greater than MAX Packet Size");
                     packetSize = max_packet_size;
+#endif
                 }
 
-                state = radio->readData(reinterpret_cast<uint8_t*>(rx), packetSize);
+                state = radio->readData(frame->data, packetSize);
 
                 if (state != RADIOLIB_ERR_NONE) {
                     ESP_LOGW(LM_TAG, "Reading packet data gave error: %d", state);
@@ -406,19 +481,30 @@ void LoraMesher::receivingRoutine() {
                         restartRadio();
                     }
 
-                    // TODO: Set a count to get the number of CRC errors
-                    deletePacket(rx);
+                    if (state == RADIOLIB_ERR_CRC_MISMATCH)
+                        incCollisions();
                 }
-                else if (packetSize != rx->packetSize) {
+#ifndef LM_COMPACT_HEADER
+                else if (packetSize != reinterpret_cast<PacketHeader*>(frame->data)->packetSize) {
                     ESP_LOGW(LM_TAG, "Packet size is different from the size read");
-                    deletePacket(rx);
                 }
+#endif
                 else {
-                    //Create a Packet Queue element containing the Packet
-                    QueuePacket<Packet<uint8_t>>* pq = PacketQueueService::createQueuePacket(rx, 0, 0, rssi, snr);
+                    frame->length = packetSize;
+                    frame->rssi = rssi;
+                    frame->snr = snr;
+                    frame->receivedTime = millis();
+
+#ifdef LM_FAST_FORWARDING
+                    //The packets in transit do not wait for the process routine, the slot of the ring is reused
+                    if (forwardTransitFrame(frame)) {
+                        startReceiving();
+                        continue;
+                    }
+#endif
 
-                    //Add the Packet Queue element created into the ReceivedPackets List
-                    ReceivedPackets->Append(pq);
+                    //Publish the frame to the process routine
+                    ReceivedFrames->commitWrite();
 
                     //Notify that a packet needs to be process
                     TWres = xTaskNotifyFromISR(
@@ -434,6 +520,49 @@ void LoraMesher::receivingRoutine() {
     }
 }
 
+bool LoraMesher::forwardTransitFrame(LM_ReceivedFrame* frame) {
+    if (!PacketService::isTransitFrame(frame->data, frame->length, getLocalAddress()))
+        return false;
+
+#ifdef LM_COMPACT_HEADER
+    Packet<uint8_t>* packet = PacketService::decodeCompactPacket(frame->data, frame->length);
+#else
+    Packet<uint8_t>* packet = PacketService::copyPacket(frame->data, frame->length);
+#endif
+
+    if (packet == nullptr)
+        return false;
+
+#ifdef LM_TESTING
+    if (!shouldProcessPacket(packet)) {
+        deletePacket(packet);
+        return true;
+    }
+#endif
+
+    incReceivedDataPackets();
+    incReceivedIAmVia();
+    incReceivedPayloadBytes(PacketService::getPacketPayloadLengthWithoutControl(packet));
+    incReceivedControlBytes(PacketService::getControlLength(packet));
+
+    uint16_t nextHop = RoutingTableService::getNextHop(packet->dst);
+    if (nextHop == 0) {
+        ESP_LOGW(LM_TAG, "NextHop Not found from %X, destination %X", packet->src, packet->dst);
+        incDestinyUnreachable();
+        deletePacket(packet);
+        return true;
+    }
+
+    reinterpret_cast<DataPacket*>(packet)->via = nextHop;
+
+    QueuePacket<Packet<uint8_t>>* qp = PacketQueueService::createQueuePacket(packet, 0, 0, frame->rssi, frame->snr);
+    qp->enqueueTime = frame->receivedTime;
+
+    incFastForwardedPackets();
+    addToSendOrderedAndNotify(qp);
+    return true;
+}
+
 uint16_t LoraMesher::getLocalAddress() {
     return WiFiService::getLocalAddress();
 }
@@ -442,26 +571,44 @@ uint16_t LoraMesher::getLocalAddress() {
  *  Region Packet Service
 **/
 
-void LoraMesher::waitBeforeSend(uint8_t repeatedDetectPreambles) {
-    // TODO: Why did I set this if?
-    if (repeatedDetectPreambles > RoutingTableService::routingTableSize())
-        return;
+void LoraMesher::waitBeforeSend(uint32_t timeOnAir) {
+    for (uint8_t attempt = 0; attempt < LM_CSMA_MAX_ATTEMPTS; attempt++) {
+        //The backoff window doubles with each busy channel
+        uint8_t exponent = attempt + LM_CSMA_MIN_BACKOFF_EXPONENT;
+        if (exponent > LM_CSMA_MAX_BACKOFF_EXPONENT)
+            exponent = LM_CSMA_MAX_BACKOFF_EXPONENT;
+
+        uint32_t window = timeOnAir << exponent;
+        if (window > LM_CSMA_MAX_BACKOFF)
+            window = LM_CSMA_MAX_BACKOFF;
 
-    hasReceivedMessage = false;
+        uint32_t backoff = random(0, window + 1);
 
-    //Random delay, to avoid some collisions.
-    uint32_t randomDelay = getPropagationTimeWithRandom(repeatedDetectPreambles);
+        ESP_LOGV(LM_TAG, "Backoff %d ms, attempt %d", (int) backoff, attempt);
 
-    ESP_LOGV(LM_TAG, "RandomDelay %d ms", (int) randomDelay);
+        hasReceivedMessage = false;
 
-    //Set a random delay, to avoid some collisions.
-    vTaskDelay(randomDelay / portTICK_PERIOD_MS);
+        vTaskDelay(backoff / portTICK_PERIOD_MS);
 
-    if (hasReceivedMessage) {
+        incBackoffTime(backoff);
+
+        //A packet has been received while waiting, the channel was busy
+        if (hasReceivedMessage) {
+            ESP_LOGV(LM_TAG, "Packet received while waiting %d", attempt);
+            continue;
+        }
+
+        if (channelScan())
+            return;
+
+        ESP_LOGV(LM_TAG, "Channel busy %d", attempt);
+
+        //Receive the packet that is using the channel
         startReceiving();
-        ESP_LOGV(LM_TAG, "Preamble detected while waiting %d", repeatedDetectPreambles);
-        waitBeforeSend(repeatedDetectPreambles + 1);
     }
+
+    incChannelAccessFailures();
+    ESP_LOGW(LM_TAG, "Channel busy after %d attempts, sending anyway", LM_CSMA_MAX_ATTEMPTS);
 }
 
 uint32_t LoraMesher::getMaxPropagationTime() {
@@ -469,15 +616,30 @@ uint32_t LoraMesher::getMaxPropagationTime() {
 }
 
 bool LoraMesher::sendPacket(Packet<uint8_t>* p) {
-    waitBeforeSend(1);
+#ifdef LM_COMPACT_HEADER
+    //The compact frame is never longer than the packet, and the packet size is 8 bits
+    uint8_t frame[UINT8_MAX];
+    size_t frameLength = PacketService::encodeCompactPacket(p, frame);
+#else
+    uint8_t* frame = reinterpret_cast<uint8_t*>(p);
+    size_t frameLength = p->packetSize;
+#endif
+
+    waitBeforeSend(radio->getTimeOnAir(frameLength) / 1000);
+
+    setTransmitPower(getTransmitPower(p));
 
     clearDioActions();
 
     // Print the packet to be sent
     printHeaderPacket(p, "send");
 
+#ifdef LM_ASYNC_TRANSMIT
+    int resT = transmitAsync(frame, frameLength);
+#else
     //Blocking transmit, it is necessary due to deleting the packet after sending it. 
-    int resT = radio->transmit(reinterpret_cast<uint8_t*>(p), p->packetSize);
+    int resT = radio->transmit(frame, frameLength);
+#endif
 
     //Start receiving again after sending a packet
     startReceiving();
@@ -489,6 +651,200 @@ bool LoraMesher::sendPacket(Packet<uint8_t>* p) {
     return true;
 }
 
+int LoraMesher::transmitAsync(uint8_t* frame, size_t frameLength) {
+    uint32_t timeOnAir = radio->getTimeOnAir(frameLength) / 1000;
+
+    //Discard a TX done of a previous transmission that timed out
+    xSemaphoreTake(transmitDoneSemaphore, 0);
+
+    radio->setDioActionForTransmitDone(onTransmitDone);
+
+    //The frame is copied to the radio buffer, it can be deleted after starting the transmission
+    int res = radio->startTransmit(frame, frameLength);
+    if (res != RADIOLIB_ERR_NONE)
+        return res;
+
+    //Yield the CPU while the packet is being sent, with a margin in case the interrupt is lost
+    if (xSemaphoreTake(transmitDoneSemaphore, (timeOnAir * 2 + 100) / portTICK_PERIOD_MS) != pdTRUE) {
+        ESP_LOGE(LM_TAG, "Transmit done interrupt not received after %d ms", (int) timeOnAir * 2 + 100);
+        res = RADIOLIB_ERR_TX_TIMEOUT;
+    }
+
+    clearDioActions();
+    radio->finishTransmit();
+
+    return res;
+}
+
+bool LoraMesher::waitAirtimeBudget(uint32_t timeOnAir) {
+    uint32_t budget = airtimeLedger.getBudget();
+    if (budget != LM_AirtimeLedger::UNLIMITED && timeOnAir > budget) {
+        ESP_LOGE(LM_TAG, "Time on air %d ms longer than the airtime budget %d ms", (int) timeOnAir, (int) budget);
+        return false;
+    }
+
+    unsigned long now = millis();
+    unsigned long sendTime = airtimeLedger.getEarliestSendTime(loraMesherConfig->freq, timeOnAir, now);
+    if (sendTime <= now)
+        return true;
+
+    uint32_t wait = sendTime - now;
+
+    ESP_LOGW(LM_TAG, "Airtime budget exhausted, next message in %d ms", (int) wait);
+
+    incAirtimeBudgetWaitTime(wait);
+
+    vTaskDelay(wait / portTICK_PERIOD_MS);
+
+    return true;
+}
+
+int8_t LoraMesher::getTransmitPower(Packet<uint8_t>* p) {
+    int8_t power = loraMesherConfig->power;
+
+    if (loraMesherConfig->txPowerSnrMargin == 0 || !PacketService::isDataPacket(p->type) || p->dst == BROADCAST_ADDR)
+        return power;
+
+    uint16_t via = reinterpret_cast<DataPacket*>(p)->via;
+
+    int8_t sentSNR;
+    if (!RoutingTableService::getSentSNR(via, sentSNR))
+        return power;
+
+    //The reported SNR has been measured with the configured power
+    int16_t excess = sentSNR - (RoutingTableService::getDemodulationFloor() + loraMesherConfig->txPowerSnrMargin);
+    if (excess <= 0)
+        return power;
+
+    int16_t reducedPower = power - excess;
+    if (reducedPower < LM_MIN_POWER)
+        reducedPower = LM_MIN_POWER;
+
+    return reducedPower < power ? reducedPower : power;
+}
+
+void LoraMesher::setTransmitPower(int8_t power) {
+    if (power < loraMesherConfig->power)
+        incReducedPowerPackets();
+
+    if (power == currentPower)
+        return;
+
+    int res = radio->setOutputPower(power);
+    if (res != RADIOLIB_ERR_NONE) {
+        ESP_LOGE(LM_TAG, "Setting output power %d gave error: %d", power, res);
+        return;
+    }
+
+    ESP_LOGV(LM_TAG, "Output power changed to %d dBm", power);
+    currentPower = power;
+}
+
+QueuePacket<Packet<uint8_t>>* LoraMesher::aggregatePackets(QueuePacket<Packet<uint8_t>>* tx, uint16_t nextHop) {
+    size_t maxPacketSize = PacketFactory::getMaxPacketSize();
+    size_t aggregatedSize = sizeof(DataPacket) + PacketService::getAggregatedLength(reinterpret_cast<DataPacket*>(tx->packet));
+
+    //There is no space for another data packet
+    if (aggregatedSize + sizeof(AggregatedPacket) >= maxPacketSize)
+        return tx;
+
+    //The nodes of the previous versions do not know the aggregated packets
+    if (RoutingTableService::isLegacyNode(nextHop))
+        return tx;
+
+    //Wait for other data packets
+    if (loraMesherConfig->aggregationHoldTime > 0 && ToSendPackets->getLength() == 0)
+        vTaskDelay(loraMesherConfig->aggregationHoldTime / portTICK_PERIOD_MS);
+
+    QueuePacket<Packet<uint8_t>>* aggregated[LM_MAX_AGGREGATED_PACKETS];
+    aggregated[0] = tx;
+    size_t numPackets = 1;
+
+    //Resolve the next hops with a snapshot, the routing table lock is never taken while holding the send queue lock
+    RoutingTableSnapshot* snapshot = RoutingTableService::getRoutingTableSnapshot();
+    auto isVia = [snapshot, nextHop](uint16_t dst) {
+        for (size_t i = 0; i < snapshot->numberOfNodes; i++) {
+            if (snapshot->routeNodes[i].networkNode.address == dst)
+                return snapshot->routeNodes[i].via == nextHop;
+        }
+        return false;
+    };
+
+    ToSendPackets->setInUse();
+
+    while (numPackets < LM_MAX_AGGREGATED_PACKETS) {
+        QueuePacket<Packet<uint8_t>>* next = ToSendPackets->Extract([&](QueuePacket<Packet<uint8_t>>* qp) {
+            Packet<uint8_t>* p = qp->packet;
+            return PacketService::isOnlyDataPacket(p->type) && p->dst != BROADCAST_ADDR &&
+                aggregatedSize + PacketService::getAggregatedLength(reinterpret_cast<DataPacket*>(p)) <= maxPacketSize &&
+                isVia(p->dst);
+        });
+
+        if (next == nullptr)
+            break;
+
+        removeFromSendQueueOccupancy(next);
+        aggregatedSize += PacketService::getAggregatedLength(reinterpret_cast<DataPacket*>(next->packet));
+        aggregated[numPackets++] = next;
+    }
+
+    ToSendPackets->releaseInUse();
+
+    snapshot->release();
+
+    if (numPackets == 1)
+        return tx;
+
+    DataPacket* packets[LM_MAX_AGGREGATED_PACKETS];
+    uint32_t separateTimeOnAir = 0;
+
+    for (size_t i = 0; i < numPackets; i++) {
+        packets[i] = reinterpret_cast<DataPacket*>(aggregated[i]->packet);
+        separateTimeOnAir += radio->getTimeOnAir(PacketService::getFrameLength(aggregated[i]->packet)) / 1000;
+    }
+
+    DataPacket* aggregatedPacket = PacketService::createAggregatedPacket(nextHop, getLocalAddress(), packets, numPackets);
+
+    if (aggregatedPacket == nullptr) {
+        ESP_LOGE(LM_TAG, "Aggregated packet not created, sending the packets separately");
+        ToSendPackets->setInUse();
+        for (size_t i = 1; i < numPackets; i++)
+            pushToSendQueue(aggregated[i]);
+        ToSendPackets->releaseInUse();
+
+        return tx;
+    }
+
+    uint32_t aggregatedTimeOnAir = radio->getTimeOnAir(PacketService::getFrameLength(reinterpret_cast<Packet<uint8_t>*>(aggregatedPacket))) / 1000;
+    uint32_t airtimeSaved = separateTimeOnAir > aggregatedTimeOnAir ? separateTimeOnAir - aggregatedTimeOnAir : 0;
+
+    ESP_LOGI(LM_TAG, "Aggregated %d packets via %X, %d bytes, airtime saved %d ms", numPackets, nextHop, aggregatedPacket->packetSize, (int) airtimeSaved);
+
+    incSentAggregatedPackets();
+    incAggregatedDataPackets(numPackets);
+    incAggregationAirtimeSaved(airtimeSaved);
+
+    QueuePacket<Packet<uint8_t>>* aggregatedTx = PacketQueueService::createQueuePacket(
+        reinterpret_cast<Packet<uint8_t>*>(aggregatedPacket), tx->priority);
+
+    //Keep the forwarded packets in the forwarding statistics, with the enqueue time of the oldest one
+    uint16_t localAddress = getLocalAddress();
+    aggregatedTx->enqueueTime = tx->enqueueTime;
+
+    for (size_t i = 0; i < numPackets; i++) {
+        if (aggregated[i]->packet->src != localAddress) {
+            if (aggregatedTx->forwardedPackets == 0 || aggregated[i]->enqueueTime < aggregatedTx->enqueueTime)
+                aggregatedTx->enqueueTime = aggregated[i]->enqueueTime;
+            aggregatedTx->forwardedPackets++;
+        }
+    }
+
+    for (size_t i = 0; i < numPackets; i++)
+        PacketQueueService::deleteQueuePacketAndPacket(aggregated[i]);
+
+    return aggregatedTx;
+}
+
 void LoraMesher::sendPackets() {
     ESP_LOGV(LM_TAG, "Send routine started");
     vTaskSuspend(NULL);
@@ -502,8 +858,6 @@ void LoraMesher::sendPackets() {
 #else
     srand(getLocalAddress());
 #endif
-    const uint8_t dutyCycleEvery = (100 - LM_DUTY_CYCLE) / portTICK_PERIOD_MS;
-
     for (;;) {
         /* Wait for the notification of new packet has to be sent and enter blocking */
         ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
@@ -519,11 +873,23 @@ void LoraMesher::sendPackets() {
 
             QueuePacket<Packet<uint8_t>>* tx = ToSendPackets->Pop();
 
+            if (tx)
+                removeFromSendQueueOccupancy(tx);
+
             ToSendPackets->releaseInUse();
 
             if (tx) {
                 ESP_LOGV(LM_TAG, "Send n. %d", sendCounter);
 
+                //Drop the forwarded packets that waited too long, they are likely useless for the destination
+                if (loraMesherConfig->forwardedMaxAge > 0 && getTrafficClass(tx->packet) == FORWARDED_CLASS &&
+                    millis() - tx->enqueueTime > loraMesherConfig->forwardedMaxAge) {
+                    ESP_LOGW(LM_TAG, "Forwarded packet from %X to %X too old, dropping it", tx->packet->src, tx->packet->dst);
+                    incSendQueueDrops(FORWARDED_CLASS);
+                    PacketQueueService::deleteQueuePacketAndPacket(tx);
+                    continue;
+                }
+
                 if (tx->packet->src == getLocalAddress())
                     tx->packet->id = sendId++;
 
@@ -540,27 +906,47 @@ void LoraMesher::sendPackets() {
                     }
 
                     (reinterpret_cast<DataPacket*>(tx->packet))->via = nextHop;
+
+                    if (PacketService::isOnlyDataPacket(tx->packet->type))
+                        tx = aggregatePackets(tx, nextHop);
                 }
 
                 recordState(LM_StateType::STATE_TYPE_SENT, tx->packet);
 
+                uint32_t timeOnAir = radio->getTimeOnAir(PacketService::getFrameLength(tx->packet)) / 1000;
+
+                if (!waitAirtimeBudget(timeOnAir)) {
+                    incAirtimeBudgetDropped();
+                    PacketQueueService::deleteQueuePacketAndPacket(tx);
+                    continue;
+                }
+
                 //Send packet
                 bool hasSend = sendPacket(tx->packet);
 
                 sendCounter++;
 
                 if (hasSend) {
+                    airtimeLedger.record(loraMesherConfig->freq, timeOnAir, millis());
                     incSendPackets();
                     incSentPayloadBytes(PacketService::getPacketPayloadLengthWithoutControl(tx->packet));
                     incSentControlBytes(PacketService::getControlLength(tx->packet));
-                    if (tx->packet->src != getLocalAddress())
+                    if (tx->packet->src != getLocalAddress()) {
+                        incForwardedPackets();
+                        forwardingLatency.record(millis() - tx->enqueueTime);
+                    }
+                    for (uint8_t i = 0; i < tx->forwardedPackets; i++) {
                         incForwardedPackets();
+                        forwardingLatency.record(millis() - tx->enqueueTime);
+                    }
                 }
 
                 //TODO: If the packet has not been send, add it to the queue and send it again
                 if (!hasSend && resendMessage < MAX_RESEND_PACKET) {
                     tx->priority = MAX_PRIORITY;
-                    PacketQueueService::addOrdered(ToSendPackets, tx);
+                    ToSendPackets->setInUse();
+                    pushToSendQueue(tx);
+                    ToSendPackets->releaseInUse();
 
                     resendMessage++;
                     continue;
@@ -568,15 +954,13 @@ void LoraMesher::sendPackets() {
 
                 resendMessage = 0;
 
-                uint32_t timeOnAir = radio->getTimeOnAir(tx->packet->packetSize) / 1000;
-
-                TickType_t delayBetweenSend = timeOnAir * dutyCycleEvery;
-
-                ESP_LOGV(LM_TAG, "TimeOnAir %d ms, next message in %d ms", (int) timeOnAir, (int) delayBetweenSend);
+                uint32_t remaining = getRemainingAirtimeBudget();
+                if (remaining == LM_AirtimeLedger::UNLIMITED)
+                    ESP_LOGV(LM_TAG, "TimeOnAir %d ms, remaining airtime unlimited", (int) timeOnAir);
+                else
+                    ESP_LOGV(LM_TAG, "TimeOnAir %d ms, remaining airtime %d ms", (int) timeOnAir, (int) remaining);
 
                 PacketQueueService::deleteQueuePacketAndPacket(tx);
-
-                vTaskDelay(delayBetweenSend / portTICK_PERIOD_MS);
             }
         }
     }
@@ -587,13 +971,24 @@ void LoraMesher::sendHelloPacket() {
 
     vTaskSuspend(NULL);
 
-    size_t maxNodesPerPacket = (PacketFactory::getMaxPacketSize() - sizeof(RoutePacket)) / sizeof(NetworkNode);
+    //initConfiguration raises the max packet size to fit one route and one link quality, the subtractions below cannot wrap
+    size_t maxPacketSize = PacketFactory::getMaxPacketSize();
+    assert(maxPacketSize >= PacketService::getMinPacketSize());
+
+    size_t maxNodesPerPacket = (maxPacketSize - sizeof(RoutePacket)) / sizeof(NetworkNode);
+    //The link qualities leave room for at least one route inside the first packet
+    size_t maxLinksPerPacket = (maxPacketSize - sizeof(RoutePacket) - PacketService::getMaxRouteLength()) / sizeof(LinkQuality);
 
     ESP_LOGV(LM_TAG, "Max routing nodes per packet: %d", maxNodesPerPacket);
 
     //Wait an initial 2 second
     vTaskDelay(2000 / portTICK_PERIOD_MS);
 
+    //Routing table of the previous advertisement, only the changes since it are advertised
+    RoutingTableSnapshot* advertised = nullptr;
+    unsigned long lastFullAdvertisement = 0;
+    uint8_t advertisementSeq = 0;
+
     for (;;) {
         ESP_LOGV(LM_TAG, "Creating Routing Packet");
         ESP_LOGV(LM_TAG, "Stack space unused after entering the task: %d", uxTaskGetStackHighWaterMark(NULL));
@@ -601,36 +996,215 @@ void LoraMesher::sendHelloPacket() {
 
         incSentHelloPackets();
 
-        NetworkNode* nodes = RoutingTableService::getAllNetworkNodes();
-        size_t numOfNodes = RoutingTableService::routingTableSize();
+        RoutingTableSnapshot* snapshot = RoutingTableService::getRoutingTableSnapshot();
 
-        size_t numPackets = (numOfNodes + maxNodesPerPacket - 1) / maxNodesPerPacket;
-        numPackets = (numPackets == 0) ? 1 : numPackets;
+        bool full = advertised == nullptr || sendFullRouting || millis() - lastFullAdvertisement >= LM_FULL_ROUTING_DELAY * 1000;
+        sendFullRouting = false;
 
-        for (size_t i = 0; i < numPackets; ++i) {
-            size_t startIndex = i * maxNodesPerPacket;
-            size_t endIndex = startIndex + maxNodesPerPacket;
-            if (endIndex > numOfNodes) {
-                endIndex = numOfNodes;
-            }
+        //The first advertisement asks the neighbors for their routing table
+        uint8_t flags = full ? LM_ROUTE_FULL : 0;
+        if (requestFullRouting || advertised == nullptr)
+            flags |= LM_ROUTE_REQUEST_FULL;
+        requestFullRouting = false;
 
-            size_t nodesInThisPacket = endIndex - startIndex;
+        NetworkNode* changes = nullptr;
+        NetworkNode* nodes = snapshot->networkNodes;
+        size_t numOfNodes = snapshot->numberOfNodes;
+
+        if (full) {
+            lastFullAdvertisement = millis();
+            incSentFullRouting();
+        }
+        else if (snapshot->version != advertised->version) {
+            changes = RoutingTableService::getRouteChanges(advertised, snapshot, numOfNodes);
+            nodes = changes;
+        }
+        else
+            numOfNodes = 0;
+
+        ESP_LOGI(LM_TAG, "Route advertisement, %s, %d nodes", full ? "full" : "changes", numOfNodes);
+
+        // Send back the SNR received from the neighbors, for their transmit power control
+        LinkQuality* links = snapshot->numberOfNodes > 0 ? new LinkQuality[snapshot->numberOfNodes] : nullptr;
+        size_t numOfLinks = 0;
+
+        for (size_t i = 0; i < snapshot->numberOfNodes && numOfLinks < maxLinksPerPacket; i++) {
+            RouteNode* node = &snapshot->routeNodes[i];
+            if (node->hasAdvertisementSeq)
+                links[numOfLinks++] = LinkQuality(node->networkNode.address, node->receivedSNR, node->receivedRatio);
+        }
+
+#ifdef LM_COMPACT_ROUTES
+        // The compact routes encode the address delta to the previous route, sorted by address the deltas are the shortest
+        NetworkNode* sorted = numOfNodes > 0 ? new NetworkNode[numOfNodes] : nullptr;
+        if (sorted != nullptr) {
+            std::copy(nodes, nodes + numOfNodes, sorted);
+            std::sort(sorted, sorted + numOfNodes, [](const NetworkNode& a, const NetworkNode& b) { return a.address < b.address; });
+        }
+        nodes = sorted;
+
+        uint8_t* encoded = new uint8_t[maxPacketSize];
+#endif
+
+        size_t startIndex = 0;
+        bool firstPacket = true;
+
+        do {
+            // The link qualities are sent inside the first packet
+            size_t linksInThisPacket = firstPacket ? numOfLinks : 0;
+            size_t headerLength = sizeof(RoutePacket) + linksInThisPacket * sizeof(LinkQuality);
+            size_t maxNodesLength = maxPacketSize > headerLength ? maxPacketSize - headerLength : 0;
+            assert(maxNodesLength >= PacketService::getMaxRouteLength());
+
+            uint8_t packetFlags = firstPacket && full ? flags | LM_ROUTE_FULL_FIRST : flags;
+
+#ifdef LM_COMPACT_ROUTES
+            size_t nodesLength = 0;
+            size_t nodesInThisPacket = nodes == nullptr ? 0 :
+                PacketService::encodeRoutes(&nodes[startIndex], numOfNodes - startIndex, encoded, maxNodesLength, nodesLength);
+            uint8_t* nodesInPacket = encoded;
+            packetFlags |= LM_ROUTE_COMPACT;
+#else
+            size_t nodesInThisPacket = numOfNodes - startIndex;
+            if (nodesInThisPacket > maxNodesLength / sizeof(NetworkNode))
+                nodesInThisPacket = maxNodesLength / sizeof(NetworkNode);
+
+            size_t nodesLength = nodesInThisPacket * sizeof(NetworkNode);
+            uint8_t* nodesInPacket = nodes == nullptr ? nullptr : reinterpret_cast<uint8_t*>(&nodes[startIndex]);
+#endif
+
+            //With the last packet the neighbors know the whole routing table, and remove the routes that it does not contain
+            if (full && startIndex + nodesInThisPacket >= numOfNodes)
+                packetFlags |= LM_ROUTE_FULL_LAST;
 
             // Create and send the packet
             RoutePacket* tx = PacketService::createRoutingPacket(
-                getLocalAddress(), &nodes[startIndex], nodesInThisPacket, RoleService::getRole()
+                getLocalAddress(), nodesInPacket, nodesLength, RoleService::getRole(),
+                ++advertisementSeq, packetFlags, links, linksInThisPacket
             );
 
-            setPackedForSend(reinterpret_cast<Packet<uint8_t>*>(tx), DEFAULT_PRIORITY + 1);
+            if (tx != nullptr)
+                setPackedForSend(reinterpret_cast<Packet<uint8_t>*>(tx), DEFAULT_PRIORITY + 1);
+
+            incAdvertisedRoutes(nodesInThisPacket, nodesLength);
+
+            startIndex += nodesInThisPacket;
+            firstPacket = false;
+
+            //The next packets would not advance either
+            if (nodesInThisPacket == 0 && startIndex < numOfNodes) {
+                ESP_LOGE(LM_TAG, "No route fits inside the route packet, %d routes not advertised", numOfNodes - startIndex);
+                break;
+            }
+        } while (startIndex < numOfNodes);
+
+#ifdef LM_COMPACT_ROUTES
+        delete[] sorted;
+        delete[] encoded;
+#endif
+
+        delete[] links;
+        delete[] changes;
+
+        //The nodes of the previous versions expect the whole routing table every HELLO_PACKETS_DELAY s, only while they are heard
+        if (lastLegacyHello != 0 && millis() - lastLegacyHello < DEFAULT_TIMEOUT * 1000 &&
+            (lastLegacyAdvertisement == 0 || millis() - lastLegacyAdvertisement >= HELLO_PACKETS_DELAY * 1000)) {
+            lastLegacyAdvertisement = millis();
+            sendLegacyHelloPackets(snapshot);
+        }
+
+        if (advertised != nullptr)
+            advertised->release();
+        advertised = snapshot;
+
+        // Wait for HELLO_PACKETS_DELAY seconds or a change of the routing table to send the next hello packet
+        if (ulTaskNotifyTake(pdTRUE, HELLO_PACKETS_DELAY * 1000 / portTICK_PERIOD_MS) > 0) {
+            // Wait for other changes, with a random delay to not send at the same time than the neighbors
+            vTaskDelay((LM_TRIGGERED_ROUTING_DELAY * 1000 + random(0, LM_TRIGGERED_ROUTING_DELAY * 1000)) / portTICK_PERIOD_MS);
+            ulTaskNotifyTake(pdTRUE, 0);
         }
+    }
+}
+
+void LoraMesher::sendLegacyHelloPackets(RoutingTableSnapshot* snapshot) {
+    size_t maxNodesPerPacket = (PacketFactory::getMaxPacketSize() - sizeof(LegacyRoutePacket)) / sizeof(NetworkNode);
+    size_t numOfNodes = snapshot->numberOfNodes;
+    size_t startIndex = 0;
+
+    ESP_LOGI(LM_TAG, "Legacy route advertisement, %d nodes", numOfNodes);
+
+    do {
+        size_t nodesInThisPacket = numOfNodes - startIndex;
+        if (nodesInThisPacket > maxNodesPerPacket)
+            nodesInThisPacket = maxNodesPerPacket;
+
+        LegacyRoutePacket* tx = PacketService::createLegacyRoutingPacket(
+            getLocalAddress(), snapshot->networkNodes == nullptr ? nullptr : &snapshot->networkNodes[startIndex],
+            nodesInThisPacket, RoleService::getRole());
+
+        if (tx != nullptr)
+            setPackedForSend(reinterpret_cast<Packet<uint8_t>*>(tx), DEFAULT_PRIORITY + 1);
+
+        startIndex += nodesInThisPacket;
+    } while (startIndex < numOfNodes);
+}
+
+void LoraMesher::notifyRoutingChanged() {
+    xTaskNotifyGive(Hello_TaskHandle);
+}
+
+void LoraMesher::notifyRoutesRemoved() {
+    if (RoutingTableService::hasRemovedRoutes())
+        xTaskNotifyGive(RoutingTableManager_TaskHandle);
+}
+
+void LoraMesher::onRouteRemoved(uint16_t address) {
+    // The route could have been learned again before dispatching it
+    if (RoutingTableService::hasAddressRoutingTable(address))
+        return;
+
+    ESP_LOGW(LM_TAG, "Route to %X removed, purging its sequences and packets", address);
+
+    abortSequences(q_WSP, address);
+    abortSequences(q_WRP, address);
+
+    ToSendPackets->setInUse();
+
+    QueuePacket<Packet<uint8_t>>* qp;
+    while ((qp = ToSendPackets->Extract([&](QueuePacket<Packet<uint8_t>>* p) {
+        return PacketService::isDataPacket(p->packet->type) && p->packet->dst == address;
+    })) != nullptr) {
+        removeFromSendQueueOccupancy(qp);
+        incDestinyUnreachable();
+        PacketQueueService::deleteQueuePacketAndPacket(qp);
+    }
+
+    ToSendPackets->releaseInUse();
+}
+
+void LoraMesher::abortSequences(LM_LinkedList<listConfiguration>* queue, uint16_t address) {
+    listConfiguration* aborted[LM_MAX_SEQUENCES];
+    size_t numAborted = 0;
+
+    queue->setInUse();
+
+    for (listConfiguration& listConfig : *queue) {
+        if (numAborted < LM_MAX_SEQUENCES && listConfig.config->source == address)
+            aborted[numAborted++] = &listConfig;
+    }
 
-        // Delete the nodes array
-        if (numOfNodes > 0)
-            delete[] nodes;
+    for (size_t i = 0; i < numAborted; i++) {
+        ESP_LOGW(LM_TAG, "Aborting sequence Seq_Id: %d Src: %X", aborted[i]->config->seq_id, address);
 
-        // Wait for HELLO_PACKETS_DELAY seconds to send the next hello packet
-        vTaskDelay(HELLO_PACKETS_DELAY * 1000 / portTICK_PERIOD_MS);
+        getSequenceIndex(queue)->erase(getSequenceKey(aborted[i]->config->seq_id, address));
+        if (queue->Search(aborted[i]))
+            queue->DeleteCurrent();
+
+        clearLinkedList(aborted[i]);
+        incAbortedSequences();
     }
+
+    queue->releaseInUse();
 }
 
 void LoraMesher::processPackets() {
@@ -644,10 +1218,27 @@ void LoraMesher::processPackets() {
         /* Wait for the notification of receivingRoutine and enter blocking */
         ulTaskNotifyTake(pdPASS, portMAX_DELAY);
 
-        ESP_LOGV(LM_TAG, "Size of Received Packets Queue: %d", ReceivedPackets->getLength());
+        ESP_LOGV(LM_TAG, "Size of Received Frames Ring: %d", ReceivedFrames->getLength());
+
+        LM_ReceivedFrame* frame;
+
+        while ((frame = ReceivedFrames->peekRead()) != nullptr) {
+            //Copy the frame into a packet and release the slot of the ring
+#ifdef LM_COMPACT_HEADER
+            Packet<uint8_t>* packet = PacketService::decodeCompactPacket(frame->data, frame->length);
+#else
+            Packet<uint8_t>* packet = PacketService::copyPacket(frame->data, frame->length);
+#endif
+
+            QueuePacket<Packet<uint8_t>>* rx = nullptr;
+            if (packet)
+                rx = PacketQueueService::createQueuePacket(packet, 0, 0, frame->rssi, frame->snr);
 
-        while (ReceivedPackets->getLength() > 0) {
-            QueuePacket<Packet<uint8_t>>* rx = ReceivedPackets->Pop();
+            //The forwarded packets keep the time they were received
+            if (rx)
+                rx->enqueueTime = frame->receivedTime;
+
+            ReceivedFrames->commitRead();
 
             if (rx) {
                 uint8_t type = rx->packet->type;
@@ -668,12 +1259,47 @@ void LoraMesher::processPackets() {
                 incReceivedPayloadBytes(PacketService::getPacketPayloadLengthWithoutControl(rx->packet));
                 incReceivedControlBytes(PacketService::getControlLength(rx->packet));
 
-                if (PacketService::isHelloPacket(type)) {
+                if (PacketService::isLegacyHelloPacket(type)) {
+                    incRecHelloPackets();
+
+                    uint32_t routingTableVersion = RoutingTableService::getRoutingTableVersion();
+
+                    RoutingTableService::processLegacyRoute(reinterpret_cast<LegacyRoutePacket*>(rx->packet), rx->snr);
+                    lastLegacyHello = millis();
+
+                    if (routingTableVersion != RoutingTableService::getRoutingTableVersion())
+                        notifyRoutingChanged();
+
+                    notifyRoutesRemoved();
+
+                    PacketQueueService::deleteQueuePacketAndPacket(rx);
+                }
+                else if (PacketService::isHelloPacket(type)) {
                     incRecHelloPackets();
 
-                    RoutingTableService::processRoute(reinterpret_cast<RoutePacket*>(rx->packet), rx->snr);
+                    RoutePacket* routePacket = reinterpret_cast<RoutePacket*>(rx->packet);
+                    uint32_t routingTableVersion = RoutingTableService::getRoutingTableVersion();
+
+                    //Some route packets of the source have been lost, ask for its whole routing table
+                    bool lost = RoutingTableService::processRoute(routePacket, rx->snr);
+                    if (lost) {
+                        requestFullRouting = true;
+                        incRoutingResyncs();
+                    }
+
+                    bool requested = routePacket->flags & LM_ROUTE_REQUEST_FULL;
+                    if (requested)
+                        sendFullRouting = true;
+
+                    if (lost || requested || routingTableVersion != RoutingTableService::getRoutingTableVersion())
+                        notifyRoutingChanged();
+
+                    notifyRoutesRemoved();
+
                     PacketQueueService::deleteQueuePacketAndPacket(rx);
                 }
+                else if (PacketService::isAggregatedPacket(type))
+                    processAggregatedPacket(reinterpret_cast<QueuePacket<DataPacket>*>(rx));
                 else if (PacketService::isDataPacket(type))
                     processDataPacket(reinterpret_cast<QueuePacket<DataPacket>*>(rx));
                 else {
@@ -694,18 +1320,29 @@ void LoraMesher::routingTableManager() {
         ESP_LOGV(LM_TAG, "Stack space unused after entering the task: %d", uxTaskGetStackHighWaterMark(NULL));
         ESP_LOGV(LM_TAG, "Free heap: %d", getFreeHeap());
 
-        // TODO: If the routing table removes a node, remove the nodes from the Q_WSP and Q_WRP
-        RoutingTableService::manageTimeoutRoutingTable();
+        uint32_t routingTableVersion = RoutingTableService::getRoutingTableVersion();
+
+        uint32_t nextTimeout = RoutingTableService::manageTimeoutRoutingTable();
+
+        if (routingTableVersion != RoutingTableService::getRoutingTableVersion())
+            notifyRoutingChanged();
+
+        // Purge the sequences and packets of the removed routes, without holding the routing table
+        RoutingTableService::dispatchRemovedRoutes();
 
         // Record the state for the simulation
         recordState(LM_StateType::STATE_TYPE_MANAGER);
 
-        // if (q_WRP->getLength() != 0 || q_WSP->getLength() != 0) {
-        //     vTaskDelay(randomDelay * 1000 / portTICK_PERIOD_MS);
-        //     continue;
-        // }
+        // Wait until the next route timeout or until some routes are removed by other tasks
+        TickType_t delayTicks = DEFAULT_TIMEOUT * 1000 / portTICK_PERIOD_MS;
+        if (nextTimeout != 0) {
+            uint32_t now = millis();
+            uint32_t untilTimeout = nextTimeout > now ? nextTimeout - now : 0;
+            if (untilTimeout < DEFAULT_TIMEOUT * 1000)
+                delayTicks = untilTimeout / portTICK_PERIOD_MS + 1;
+        }
 
-        vTaskDelay(DEFAULT_TIMEOUT * 1000 / portTICK_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, delayTicks);
     }
 }
 
@@ -720,7 +1357,12 @@ void LoraMesher::queueManager() {
         // Record the state for the simulation
         recordState(LM_StateType::STATE_TYPE_MANAGER);
 
-        if (q_WSP->getLength() == 0 && q_WRP->getLength() == 0) {
+        sequenceTimeouts->setInUse();
+        sequencePacketConfig* nextTimeout = sequenceTimeouts->top();
+        unsigned long nextTimeoutMs = nextTimeout != nullptr ? nextTimeout->getHeapKey() : 0;
+        sequenceTimeouts->releaseInUse();
+
+        if (nextTimeout == nullptr) {
             ESP_LOGV(LM_TAG, "No packets to send or received");
 
             // Wait for the notification of send or receive reliable message and enter blocking
@@ -730,11 +1372,16 @@ void LoraMesher::queueManager() {
             continue;
         }
 
-        managerReceivedQueue();
-        managerSendQueue();
+        unsigned long now = millis();
+        if (nextTimeoutMs >= now) {
+            // Wait until the next timeout, or until notified that an earlier timeout has been scheduled
+            ulTaskNotifyTake(
+                pdTRUE,
+                (nextTimeoutMs - now + 1) / portTICK_PERIOD_MS + 1);
+            continue;
+        }
 
-        // TODO: Calculate the min timeout for the queue manager, get the min timeout from the queues
-        vTaskDelay(MIN_TIMEOUT * 1000 / portTICK_PERIOD_MS);
+        managerTimeouts();
     }
 }
 
@@ -760,23 +1407,17 @@ void LoraMesher::sendReliablePacket(uint16_t dst, uint8_t* payload, uint32_t pay
         return;
     if (dst == BROADCAST_ADDR) {
         ESP_LOGW(LM_TAG, "Be aware of sending a reliable packet to the broadcast address");
-        size_t numOfNodes = RoutingTableService::routingTableSize();
-        if (numOfNodes > 0) {
-            NetworkNode* nodes = RoutingTableService::getAllNetworkNodes();
-            for (size_t i = 0; i < numOfNodes; i++) {
-                NetworkNode* node = &nodes[i];
-                sendReliablePacket(node->address, payload, payloadSize);
-            }
-            delete[] nodes;
+        RoutingTableSnapshot* snapshot = RoutingTableService::getRoutingTableSnapshot();
+        for (size_t i = 0; i < snapshot->numberOfNodes; i++) {
+            NetworkNode* node = &snapshot->networkNodes[i];
+            sendReliablePacket(node->address, payload, payloadSize);
         }
+        snapshot->release();
         return;
     }
     ESP_LOGV(LM_TAG, "Sending reliable payload with %d bytes to %X", (int) payloadSize, dst);
 
-    // Get the Routing Table node of the destination
-    RouteNode* node = RoutingTableService::findNode(dst);
-
-    if (node == NULL) {
+    if (!RoutingTableService::hasAddressRoutingTable(dst)) {
         ESP_LOGV(LM_TAG, "Destination not found in the routing table");
         return;
     }
@@ -791,13 +1432,25 @@ void LoraMesher::sendReliablePacket(uint16_t dst, uint8_t* payload, uint32_t pay
     size_t maxPayloadSize = PacketService::getMaximumPayloadLength(type);
 
     //Number of packets
-    uint16_t numOfPackets = payloadSize / maxPayloadSize + (payloadSize % maxPayloadSize > 0);
+    uint32_t numOfPackets = payloadSize / maxPayloadSize + (payloadSize % maxPayloadSize > 0);
+
+    if (numOfPackets > LM_MAX_SEQUENCE_PACKETS) {
+        ESP_LOGE(LM_TAG, "Reliable payload of %d bytes needs %d packets, maximum %d", (int) payloadSize, (int) numOfPackets, LM_MAX_SEQUENCE_PACKETS);
+        return;
+    }
+
+    //Number of packets sent without waiting for their ACK
+    uint8_t window = loraMesherConfig->reliableWindowSize;
+    if (window == 0)
+        window = 1;
+    else if (window > LM_MAX_RELIABLE_WINDOW)
+        window = LM_MAX_RELIABLE_WINDOW;
 
     //Create a new Linked list to store the QueuePackets and the payload
     LM_LinkedList<QueuePacket<ControlPacket>>* packetList = new LM_LinkedList<QueuePacket<ControlPacket>>();
 
     //Add the SYNC configuration packet
-    packetList->Append(getStartSequencePacketQueue(dst, seq_id, numOfPackets));
+    packetList->Append(getStartSequencePacketQueue(dst, seq_id, numOfPackets, window));
 
 
     for (uint16_t i = 1; i <= numOfPackets; i++) {
@@ -824,26 +1477,28 @@ void LoraMesher::sendReliablePacket(uint16_t dst, uint8_t* payload, uint32_t pay
     }
 
     //Create the pair of configuration
-    listConfiguration* listConfig = new listConfiguration();
-    listConfig->config = new sequencePacketConfig(seq_id, dst, numOfPackets, node);
-    listConfig->list = packetList;
+    listConfiguration* listConfig = new listConfiguration(new sequencePacketConfig(seq_id, dst, QueueType::WSP, numOfPackets), packetList);
+    listConfig->fragments = new QueuePacket<ControlPacket>*[numOfPackets + 1]();
+    listConfig->config->window = window;
+
+    for (QueuePacket<ControlPacket>& pq : *packetList)
+        listConfig->fragments[pq.number] = &pq;
 
     // Set the RTT of the first packet of the sequence
     listConfig->config->calculatingRTT = millis();
 
+    //Add dataList pair to the waiting send packets queue
+    if (!addSequenceList(q_WSP, listConfig)) {
+        ESP_LOGE(LM_TAG, "Sequence not added, maximum number of sequences reached or sequence id in use. Not sending the reliable payload to %X", dst);
+        clearLinkedList(listConfig);
+        return;
+    }
+
     // Set the timeout of the first packet of the sequence
     addTimeout(listConfig->config);
 
-    //Add dataList pair to the waiting send packets queue
-    q_WSP->setInUse();
-    q_WSP->Append(listConfig);
-    q_WSP->releaseInUse();
-
     //Send the first packet of the sequence (SYNC packet)
     sendPacketSequence(listConfig, 0);
-
-    // Notify the queueManager that a new sequence has been started
-    notifyNewSequenceStarted();
 }
 
 void LoraMesher::processDataPacket(QueuePacket<DataPacket>* pq) {
@@ -880,6 +1535,46 @@ void LoraMesher::processDataPacket(QueuePacket<DataPacket>* pq) {
     PacketQueueService::deleteQueuePacketAndPacket(pq);
 }
 
+void LoraMesher::processAggregatedPacket(QueuePacket<DataPacket>* pq) {
+    DataPacket* packet = pq->packet;
+
+    if (packet->via != getLocalAddress()) {
+        ESP_LOGV(LM_TAG, "Aggregated packet not for me, deleting it");
+        incReceivedNotForMe();
+        PacketQueueService::deleteQueuePacketAndPacket(pq);
+        return;
+    }
+
+    size_t payloadLength = PacketService::getPacketPayloadLength(packet);
+    size_t position = 0;
+
+    while (position + sizeof(AggregatedPacket) <= payloadLength) {
+        AggregatedPacket* aggregated = reinterpret_cast<AggregatedPacket*>(packet->payload + position);
+        size_t aggregatedLength = sizeof(AggregatedPacket) + aggregated->payloadSize;
+
+        if (position + aggregatedLength > payloadLength) {
+            ESP_LOGE(LM_TAG, "Wrong aggregated packet size from %X", packet->src);
+            break;
+        }
+
+        position += aggregatedLength;
+
+        DataPacket* dPacket = PacketService::createDataPacket(aggregated->dst, aggregated->src, DATA_P, aggregated->payload, aggregated->payloadSize);
+        if (dPacket == nullptr)
+            continue;
+
+        //The aggregated packets are sent to the next hop
+        dPacket->via = getLocalAddress();
+
+        QueuePacket<DataPacket>* dpq = PacketQueueService::createQueuePacket(dPacket, 0, 0, pq->rssi, pq->snr);
+        dpq->enqueueTime = pq->enqueueTime;
+
+        processDataPacket(dpq);
+    }
+
+    PacketQueueService::deleteQueuePacketAndPacket(pq);
+}
+
 void LoraMesher::processDataPacketForMe(QueuePacket<DataPacket>* pq) {
     DataPacket* p = pq->packet;
     ControlPacket* cPacket = reinterpret_cast<ControlPacket*>(p);
@@ -899,7 +1594,7 @@ void LoraMesher::processDataPacketForMe(QueuePacket<DataPacket>* pq) {
     }
     else if (PacketService::isAckPacket(p->type)) {
         ESP_LOGV(LM_TAG, "ACK Packet received");
-        addAck(p->src, cPacket->seq_id, cPacket->number);
+        addAck(p->src, cPacket->seq_id, cPacket->number, cPacket->payload, PacketService::getPacketPayloadLength(cPacket));
     }
     else if (PacketService::isLostPacket(p->type)) {
         ESP_LOGV(LM_TAG, "Lost Packet received");
@@ -907,7 +1602,9 @@ void LoraMesher::processDataPacketForMe(QueuePacket<DataPacket>* pq) {
     }
     else if (PacketService::isSyncPacket(p->type)) {
         ESP_LOGV(LM_TAG, "Synchronization Packet received");
-        processSyncPacket(p->src, cPacket->seq_id, cPacket->number);
+        //The payload of the SYNC packet contains the window of the sequence, stop-and-wait if there is no payload
+        uint8_t window = PacketService::getPacketPayloadLength(cPacket) > 0 ? cPacket->payload[0] : 1;
+        processSyncPacket(p->src, cPacket->seq_id, cPacket->number, window);
 
         needAck = false;
     }
@@ -949,13 +1646,6 @@ void LoraMesher::notifyUserReceivedPacket(AppPacket<uint8_t>* appPacket) {
         deletePacket(appPacket);
 }
 
-uint32_t LoraMesher::getPropagationTimeWithRandom(uint8_t multiplayer) {
-    // TODO: Use the RTT or other congestion metrics to calculate the time, timeouts...
-    uint32_t time = getMaxPropagationTime();
-    uint32_t randomTime = random(time, time * 3 + (multiplayer + routingTableSize()) * 100);
-    return randomTime;
-}
-
 void LoraMesher::recalculateMaxTimeOnAir() {
     maxTimeOnAir = radio->getTimeOnAir(PacketFactory::getMaxPacketSize()) / 1000;
     ESP_LOGV(LM_TAG, "Max Time on Air changed %d ms", (int) maxTimeOnAir);
@@ -965,7 +1655,7 @@ void LoraMesher::recordState(LM_StateType type, Packet<uint8_t>* packet) {
     if (simulatorService == nullptr)
         return;
 
-    simulatorService->addState(ReceivedPackets->getLength(), getSendQueueSize(),
+    simulatorService->addState(ReceivedFrames->getLength(), getSendQueueSize(),
         getReceivedQueueSize(), routingTableSize(), q_WRP->getLength(), q_WSP->getLength(),
         type, packet);
 }
@@ -1016,8 +1706,65 @@ size_t LoraMesher::getSendQueueSize() {
     return ToSendPackets->getLength();
 }
 
+uint16_t LoraMesher::getSendQueueOccupancy(TrafficClass trafficClass) {
+    return sendQueueOccupancy[trafficClass];
+}
+
+uint32_t LoraMesher::getSendQueueDropsNum(TrafficClass trafficClass) {
+    return sendQueueDropsNum[trafficClass];
+}
+
+LoraMesher::TrafficClass LoraMesher::getTrafficClass(Packet<uint8_t>* p) {
+    if (PacketService::isHelloPacket(p->type))
+        return ROUTING_CLASS;
+
+    if (PacketService::isAckPacket(p->type) || PacketService::isLostPacket(p->type) || PacketService::isSyncPacket(p->type))
+        return CONTROL_CLASS;
+
+    if (p->src != getLocalAddress())
+        return FORWARDED_CLASS;
+
+    return LOCAL_CLASS;
+}
+
+void LoraMesher::pushToSendQueue(QueuePacket<Packet<uint8_t>>* qp) {
+    TrafficClass trafficClass = getTrafficClass(qp->packet);
+
+    //A flood of data packets cannot delay the routing and control packets
+    if ((trafficClass == FORWARDED_CLASS || trafficClass == LOCAL_CLASS) && qp->priority > DEFAULT_PRIORITY)
+        qp->priority = DEFAULT_PRIORITY;
+
+    sendQueueOccupancy[trafficClass]++;
+    ToSendPackets->Push(qp);
+}
+
+void LoraMesher::removeFromSendQueueOccupancy(QueuePacket<Packet<uint8_t>>* qp) {
+    TrafficClass trafficClass = getTrafficClass(qp->packet);
+    if (sendQueueOccupancy[trafficClass] > 0)
+        sendQueueOccupancy[trafficClass]--;
+}
+
 void LoraMesher::addToSendOrderedAndNotify(QueuePacket<Packet<uint8_t>>* qp) {
-    PacketQueueService::addOrdered(ToSendPackets, qp);
+    TrafficClass trafficClass = getTrafficClass(qp->packet);
+
+    ToSendPackets->setInUse();
+
+    if (sendQueueOccupancy[trafficClass] >= loraMesherConfig->sendQueueLimits[trafficClass]) {
+        ToSendPackets->releaseInUse();
+
+        ESP_LOGW(LM_TAG, "Send queue full for traffic class %d, dropping packet to %X", trafficClass, qp->packet->dst);
+        incSendQueueDrops(trafficClass);
+        PacketQueueService::deleteQueuePacketAndPacket(qp);
+        return;
+    }
+
+    if (qp->enqueueTime == 0)
+        qp->enqueueTime = millis();
+
+    pushToSendQueue(qp);
+
+    ToSendPackets->releaseInUse();
+
     ESP_LOGI(LM_TAG, "Added packet to Q_SP, notifying sender task");
 
     //Notify the sendData task handle
@@ -1038,11 +1785,18 @@ void LoraMesher::notifyNewSequenceStarted() {
  * Large and Reliable payloads
  */
 
-QueuePacket<ControlPacket>* LoraMesher::getStartSequencePacketQueue(uint16_t destination, uint8_t seq_id, uint16_t num_packets) {
+QueuePacket<ControlPacket>* LoraMesher::getStartSequencePacketQueue(uint16_t destination, uint8_t seq_id, uint16_t num_packets, uint8_t window) {
     uint8_t type = SYNC_P | NEED_ACK_P | XL_DATA_P;
 
-    //Create the packet
-    ControlPacket* cPacket = PacketService::createEmptyControlPacket(destination, getLocalAddress(), type, seq_id, num_packets);
+    //Create the packet, the stop-and-wait sequences do not include the window
+    ControlPacket* cPacket;
+    if (window > 1) {
+        cPacket = PacketService::createControlPacket(destination, getLocalAddress(), type, &window, sizeof(window));
+        cPacket->seq_id = seq_id;
+        cPacket->number = num_packets;
+    }
+    else
+        cPacket = PacketService::createEmptyControlPacket(destination, getLocalAddress(), type, seq_id, num_packets);
 
     //Create a packet queue
     return PacketQueueService::createQueuePacket(cPacket, DEFAULT_PRIORITY, 0);
@@ -1057,6 +1811,69 @@ void LoraMesher::sendAckPacket(uint16_t destination, uint8_t seq_id, uint16_t se
     setPackedForSend(reinterpret_cast<Packet<uint8_t>*>(cPacket), DEFAULT_PRIORITY + 3);
 }
 
+void LoraMesher::addDelayedAck(sequencePacketConfig* configPacket) {
+    configPacket->pendingAcks++;
+
+    //The sender cannot send more packets than the window without receiving an ACK
+    uint8_t maxPendingAcks = loraMesherConfig->delayedAckCount;
+    if (maxPendingAcks > configPacket->window)
+        maxPendingAcks = configPacket->window;
+
+    if (configPacket->pendingAcks >= maxPendingAcks) {
+        sendSelectiveAckPacket(configPacket);
+        return;
+    }
+
+    if (configPacket->pendingAcks == 1) {
+        configPacket->ackTimeout = millis() + LM_DELAYED_ACK_TIMEOUT;
+        scheduleTimeout(configPacket);
+    }
+}
+
+void LoraMesher::flushDelayedAck(sequencePacketConfig* configPacket) {
+    if (configPacket->pendingAcks > 0)
+        sendSelectiveAckPacket(configPacket);
+}
+
+void LoraMesher::sendSelectiveAckPacket(sequencePacketConfig* configPacket) {
+    //All the pending ACKs are sent inside this one
+    if (configPacket->pendingAcks > 0) {
+        uint32_t saved = configPacket->pendingAcks - 1;
+        configPacket->acksSaved += saved;
+        incAcksSaved(saved);
+
+        configPacket->pendingAcks = 0;
+        scheduleTimeout(configPacket);
+    }
+
+    //Bitmap of the packets lastAck + 2 to lastAck + window
+    uint8_t sack[(LM_MAX_RELIABLE_WINDOW + 7) / 8] = {0};
+    size_t sackSize = 0;
+
+    for (uint16_t i = 0; i + 1 < configPacket->window; i++) {
+        uint32_t num = configPacket->lastAck + 2 + i;
+        if (num > configPacket->number)
+            break;
+
+        if (configPacket->fragmentState[num] == FRAGMENT_ACKED) {
+            sack[i / 8] |= 1 << (i % 8);
+            sackSize = i / 8 + 1;
+        }
+    }
+
+    //Without packets received out of order, it is a normal ACK
+    if (sackSize == 0) {
+        sendAckPacket(configPacket->source, configPacket->seq_id, configPacket->lastAck);
+        return;
+    }
+
+    ControlPacket* cPacket = PacketService::createControlPacket(configPacket->source, getLocalAddress(), ACK_P, sack, sackSize);
+    cPacket->seq_id = configPacket->seq_id;
+    cPacket->number = configPacket->lastAck;
+
+    setPackedForSend(reinterpret_cast<Packet<uint8_t>*>(cPacket), DEFAULT_PRIORITY + 3);
+}
+
 void LoraMesher::sendLostPacket(uint16_t destination, uint8_t seq_id, uint16_t seq_num) {
     uint8_t type = LOST_P;
 
@@ -1074,7 +1891,7 @@ bool LoraMesher::sendPacketSequence(listConfiguration* lstConfig, uint16_t seq_n
     }
 
     //Get the packet queue with the sequence number
-    QueuePacket<ControlPacket>* pq = PacketQueueService::findPacketQueue(lstConfig->list, seq_num);
+    QueuePacket<ControlPacket>* pq = seq_num <= lstConfig->config->number ? lstConfig->fragments[seq_num] : nullptr;
 
     if (pq == nullptr) {
         ESP_LOGE(LM_TAG, "NOT FOUND the packet queue with Seq_id: %d, Num: %d", lstConfig->config->seq_id, seq_num);
@@ -1090,44 +1907,75 @@ bool LoraMesher::sendPacketSequence(listConfiguration* lstConfig, uint16_t seq_n
     return true;
 }
 
-void LoraMesher::addAck(uint16_t source, uint8_t seq_id, uint16_t seq_num) {
+void LoraMesher::addAck(uint16_t source, uint8_t seq_id, uint16_t seq_num, uint8_t* sack, size_t sackSize) {
     listConfiguration* config = findSequenceList(q_WSP, seq_id, source);
     if (config == nullptr) {
         ESP_LOGE(LM_TAG, "NOT FOUND the sequence packet config in add ack with Seq_id: %d, Source: %d", seq_id, source);
         return;
     }
 
+    sequencePacketConfig* configPacket = config->config;
+
     //If all packets has been arrived to the destiny
     //Delete this sequence
-    if (config->config->number == seq_num) {
+    if (configPacket->number == seq_num) {
         ESP_LOGI(LM_TAG, "All the packets has been arrived to the seq_Id: %d", seq_id);
         findAndClearLinkedList(q_WSP, config);
         return;
     }
 
-    if (config->config->lastAck > seq_num) {
-        ESP_LOGE(LM_TAG, "ACK received that has been yet acknowledged Seq_id: %d, Num: %d", config->config->seq_id, seq_num);
+    if (configPacket->lastAck > seq_num || seq_num > configPacket->number) {
+        ESP_LOGE(LM_TAG, "ACK received that has been yet acknowledged Seq_id: %d, Num: %d", configPacket->seq_id, seq_num);
         return;
     }
 
     //Set has been received some ACK
-    config->config->firstAckReceived = 1;
+    configPacket->firstAckReceived = 1;
 
-    // TODO: Check for repeated ACKs and packets.
+    //The ACK is cumulative, all the previous packets have been received
+    for (uint32_t num = configPacket->lastAck + 1; num <= seq_num; num++)
+        configPacket->fragmentState[num] = FRAGMENT_ACKED;
 
     //Add the last ack to the config packet
-    config->config->lastAck = seq_num;
+    configPacket->lastAck = seq_num;
+
+    //Packets received after the first missing one
+    uint32_t highestAcked = seq_num;
+    for (size_t i = 0; i < sackSize * 8; i++) {
+        uint32_t num = seq_num + 2 + i;
+        if (num > configPacket->number)
+            break;
+
+        if ((sack[i / 8] >> (i % 8)) & 1) {
+            configPacket->fragmentState[num] = FRAGMENT_ACKED;
+            highestAcked = num;
+        }
+    }
 
     // Recalculate the RTT
-    actualizeRTT(config->config);
+    actualizeRTT(configPacket);
 
     //Reset the timeouts
-    resetTimeout(config->config);
+    resetTimeout(configPacket);
+
+    //Resend only once the packets lost before a packet that has been received
+    for (uint32_t num = seq_num + 1; num < highestAcked; num++) {
+        if (configPacket->fragmentState[num] == FRAGMENT_SENT) {
+            ESP_LOGV(LM_TAG, "Resending the packet %d of the seq_Id: %d, lost inside the window", num, seq_id);
+            sendPacketSequence(config, num);
+            configPacket->fragmentState[num] = FRAGMENT_RESENT;
+        }
+    }
 
-    ESP_LOGV(LM_TAG, "Sending next packet after receiving an ACK");
+    ESP_LOGV(LM_TAG, "Sending next packets after receiving an ACK");
 
-    //Send the next packet sequence
-    sendPacketSequence(config, seq_num + 1);
+    //Send the next packets inside the window
+    while (configPacket->nextFragment <= configPacket->number &&
+        configPacket->nextFragment <= (uint32_t) configPacket->lastAck + configPacket->window) {
+        sendPacketSequence(config, configPacket->nextFragment);
+        configPacket->fragmentState[configPacket->nextFragment] = FRAGMENT_SENT;
+        configPacket->nextFragment++;
+    }
 }
 
 bool LoraMesher::processLargePayloadPacket(QueuePacket<ControlPacket>* pq) {
@@ -1140,137 +1988,145 @@ bool LoraMesher::processLargePayloadPacket(QueuePacket<ControlPacket>* pq) {
         return false;
     }
 
-    if (configList->config->lastAck + 1 != cPacket->number) {
-        ESP_LOGE(LM_TAG, "Sequence number received in bad order in seq_Id: %d, received: %d expected: %d", cPacket->seq_id, cPacket->number, configList->config->lastAck + 1);
-        sendLostPacket(cPacket->src, cPacket->seq_id, configList->config->lastAck + 1);
+    sequencePacketConfig* configPacket = configList->config;
 
+    if (cPacket->number > configPacket->number) {
+        ESP_LOGE(LM_TAG, "Sequence number out of the sequence seq_Id: %d, received: %d", cPacket->seq_id, cPacket->number);
         PacketQueueService::deleteQueuePacketAndPacket(pq);
         return false;
     }
 
-    configList->config->lastAck++;
-
-    configList->list->setInUse();
-    configList->list->Append(pq);
-    configList->list->releaseInUse();
+    if (cPacket->number <= configPacket->lastAck || configPacket->fragmentState[cPacket->number] == FRAGMENT_ACKED) {
+        ESP_LOGW(LM_TAG, "Sequence number received repeated in seq_Id: %d, received: %d", cPacket->seq_id, cPacket->number);
+        //The previous ACK could have been lost, send it again
+        sendSelectiveAckPacket(configPacket);
 
-    //Send ACK
-    sendAckPacket(cPacket->src, cPacket->seq_id, cPacket->number);
-
-    // Recalculate the RTT
-    actualizeRTT(configList->config);
-
-    // Reset the timeouts
-    resetTimeout(configList->config);
-
-    //All packets has been arrived, join them and send to the user
-    if (configList->config->lastAck == configList->config->number) {
-        joinPacketsAndNotifyUser(configList);
-        return true;
+        PacketQueueService::deleteQueuePacketAndPacket(pq);
+        return false;
     }
 
-    return true;
-}
-
-void LoraMesher::joinPacketsAndNotifyUser(listConfiguration* listConfig) {
-    ESP_LOGV(LM_TAG, "Joining packets seq_Id: %d Src: %X", listConfig->config->seq_id, listConfig->config->source);
-
-    LM_LinkedList<QueuePacket<ControlPacket>>* list = listConfig->list;
+    if (cPacket->number > configPacket->lastAck + configPacket->window) {
+        ESP_LOGE(LM_TAG, "Sequence number received in bad order in seq_Id: %d, received: %d expected: %d", cPacket->seq_id, cPacket->number, configPacket->lastAck + 1);
+        sendLostPacket(cPacket->src, cPacket->seq_id, configPacket->lastAck + 1);
 
-    list->setInUse();
-    if (!list->moveToStart()) {
-        list->releaseInUse();
-        return;
+        PacketQueueService::deleteQueuePacketAndPacket(pq);
+        return false;
     }
 
-    //TODO: getPacketPayloadLength could be done when adding the packets inside the list
-    size_t payloadSize = 0;
-    size_t number = 1;
+    size_t payloadSize = PacketService::getPacketPayloadLength(cPacket);
+    size_t maxPayloadSize = PacketService::getMaximumPayloadLength(cPacket->type);
 
-    do {
-        ControlPacket* currentP = reinterpret_cast<ControlPacket*>(list->getCurrent()->packet);
-
-        if (number != (currentP->number))
-            //TODO: ORDER THE PACKETS if they are not ordered?
-            ESP_LOGE(LM_TAG, "Wrong packet order");
+    // All the payloads have the maximum size except the last one
+    if (payloadSize > maxPayloadSize || (cPacket->number != configPacket->number && payloadSize != maxPayloadSize)) {
+        ESP_LOGE(LM_TAG, "Wrong payload size in seq_Id: %d, Num: %d, Size: %d", cPacket->seq_id, cPacket->number, payloadSize);
+        PacketQueueService::deleteQueuePacketAndPacket(pq);
+        return false;
+    }
 
-        number++;
-        payloadSize += PacketService::getPacketPayloadLength(currentP);
-    } while (list->next());
+    //Copy the payload at its offset and delete the packet, the packets inside the window can be received in any order
+    AppPacket<uint8_t>* reassembly = configList->reassembly;
+    memcpy(reassembly->payload + (cPacket->number - 1) * maxPayloadSize, cPacket->payload, payloadSize);
+    reassembly->payloadSize += payloadSize;
 
-    //Move to start again
-    list->moveToStart();
+    configPacket->fragmentState[cPacket->number] = FRAGMENT_ACKED;
 
-    ControlPacket* currentP = list->getCurrent()->packet;
+    uint16_t number = cPacket->number;
+    bool inOrder = number == configPacket->lastAck + 1;
 
-    uint32_t appPacketLength = sizeof(AppPacket<uint8_t>);
+    PacketQueueService::deleteQueuePacketAndPacket(pq);
 
-    //Packet length = size of the packet + size of the payload
-    uint32_t packetLength = appPacketLength + payloadSize;
+    //Advance the cumulative ACK while the packets have been received
+    while (configPacket->lastAck < configPacket->number && configPacket->fragmentState[configPacket->lastAck + 1] == FRAGMENT_ACKED)
+        configPacket->lastAck++;
 
-    AppPacket<uint8_t>* p = static_cast<AppPacket<uint8_t>*>(pvPortMalloc(packetLength));
+    //Send the ACK immediately on gaps, filled gaps and the last packet. Otherwise delay it
+    if (inOrder && configPacket->lastAck == number && configPacket->lastAck != configPacket->number)
+        addDelayedAck(configPacket);
+    else {
+        configPacket->pendingAcks++;
+        sendSelectiveAckPacket(configPacket);
+    }
 
-    ESP_LOGV(LM_TAG, "Large Packet Packet length: %d Payload Size: %d", (int) packetLength, payloadSize);
+    // Recalculate the RTT
+    actualizeRTT(configPacket);
 
-    if (p) {
-        //Copy the payload into the packet
-        unsigned long actualPayloadSizeDst = appPacketLength;
+    // Reset the timeouts
+    resetTimeout(configPacket);
 
-        do {
-            currentP = list->getCurrent()->packet;
+    //All packets has been arrived, notify the user
+    if (configPacket->lastAck == configPacket->number)
+        joinPacketsAndNotifyUser(configList);
 
-            size_t actualPayloadSizeSrc = PacketService::getPacketPayloadLength(currentP);
+    return true;
+}
 
-            memcpy(reinterpret_cast<void*>((unsigned long) p + (actualPayloadSizeDst)), currentP->payload, actualPayloadSizeSrc);
-            actualPayloadSizeDst += actualPayloadSizeSrc;
-        } while (list->next());
-    }
+void LoraMesher::joinPacketsAndNotifyUser(listConfiguration* listConfig) {
+    ESP_LOGV(LM_TAG, "Reassembled packet seq_Id: %d Src: %X, ACKs saved: %d", listConfig->config->seq_id, listConfig->config->source, listConfig->config->acksSaved);
 
-    list->releaseInUse();
+    AppPacket<uint8_t>* p = listConfig->reassembly;
+    listConfig->reassembly = nullptr;
 
     //Set values to the AppPacket
-    p->payloadSize = payloadSize;
     p->src = listConfig->config->source;
     p->dst = getLocalAddress();
 
+    ESP_LOGV(LM_TAG, "Large Packet Payload Size: %d", (int) p->payloadSize);
+
     //TODO: When finished, clear everything? Or maintain the config until timeout?
     findAndClearLinkedList(q_WRP, listConfig);
 
     notifyUserReceivedPacket(p);
 }
 
-void LoraMesher::processSyncPacket(uint16_t source, uint8_t seq_id, uint16_t seq_num) {
+void LoraMesher::processSyncPacket(uint16_t source, uint8_t seq_id, uint16_t seq_num, uint8_t window) {
     //Check for repeated sequence lists
     listConfiguration* listConfig = findSequenceList(q_WRP, seq_id, source);
 
     if (listConfig == nullptr) {
-        // Get the Routing Table node of the destination
-        RouteNode* node = RoutingTableService::findNode(source);
-
-        if (node == nullptr) {
+        if (!RoutingTableService::hasAddressRoutingTable(source)) {
             ESP_LOGW(LM_TAG, "Node not found in the routing table");
             return;
         }
 
+        if (seq_num == 0) {
+            ESP_LOGW(LM_TAG, "Sequence without packets from %X", source);
+            return;
+        }
+
+        if (seq_num > LM_MAX_SEQUENCE_PACKETS) {
+            ESP_LOGW(LM_TAG, "Sequence of %X with %d packets, maximum %d", source, seq_num, LM_MAX_SEQUENCE_PACKETS);
+            return;
+        }
+
+        //Allocate the packet where all the payloads will be copied
+        size_t maxPayloadSize = PacketService::getMaximumPayloadLength(NEED_ACK_P | XL_DATA_P);
+        AppPacket<uint8_t>* reassembly = static_cast<AppPacket<uint8_t>*>(pvPortMalloc(sizeof(AppPacket<uint8_t>) + seq_num * maxPayloadSize));
+
+        if (reassembly == nullptr) {
+            ESP_LOGE(LM_TAG, "Not enough memory to receive the sequence of %X with %d packets", source, seq_num);
+            return;
+        }
+
+        reassembly->payloadSize = 0;
+
         //Create the pair of configuration
-        listConfig = new listConfiguration();
-        listConfig->config = new sequencePacketConfig(seq_id, source, seq_num, node);
-        listConfig->list = new LM_LinkedList<QueuePacket<ControlPacket>>();
+        listConfig = new listConfiguration(new sequencePacketConfig(seq_id, source, QueueType::WRP, seq_num), new LM_LinkedList<QueuePacket<ControlPacket>>());
+        listConfig->reassembly = reassembly;
+        listConfig->config->window = window == 0 ? 1 : (window > LM_MAX_RELIABLE_WINDOW ? LM_MAX_RELIABLE_WINDOW : window);
 
         // Starting to calculate RTT
         actualizeRTT(listConfig->config);
 
         //Add list configuration to the waiting received packets queue
-        q_WRP->setInUse();
-        q_WRP->Append(listConfig);
-        q_WRP->releaseInUse();
+        if (!addSequenceList(q_WRP, listConfig)) {
+            ESP_LOGW(LM_TAG, "Maximum number of sequences reached, ignoring the sequence of %X", source);
+            clearLinkedList(listConfig);
+            return;
+        }
 
         // Reset the timeout
         addTimeout(listConfig->config);
 
-        // Notify the queueManager that a new sequence has been started
-        notifyNewSequenceStarted();
-
         //Change the number to send the ack to the correct one
         //cPacket->number in SYNC_P specify the number of packets and it needs to ACK the 0
         sendAckPacket(source, seq_id, 0);
@@ -1299,6 +2155,12 @@ void LoraMesher::processLostPacket(uint16_t destination, uint8_t seq_id, uint16_
 
     //Send the packet sequence that has been lost
     if (sendPacketSequence(listConfig, seq_num)) {
+        if (seq_num > 0)
+            listConfig->config->fragmentState[seq_num] = FRAGMENT_RESENT;
+
+        if (seq_num == listConfig->config->nextFragment)
+            listConfig->config->nextFragment++;
+
         listConfig->config->numberOfTimeouts++;
         //Reset the timeout of this sequence packets inside the q_WSP
         recalculateTimeoutAfterTimeout(listConfig->config);
@@ -1329,30 +2191,11 @@ void LoraMesher::actualizeRTT(sequencePacketConfig* config) {
         return;
     }
 
-    RouteNode* node = config->node;
-
-    if (node == nullptr) {
-        ESP_LOGW(LM_TAG, "Node not found in the routing table");
-        return;
-    }
-
     unsigned long actualRTT = millis() - config->calculatingRTT;
 
-    // First time RTT is calculated for this node (RFC 6298)
-    if (node->SRTT == 0) {
-        node->SRTT = actualRTT;
-        node->RTTVAR = actualRTT / 2;
-    }
-    else {
-        unsigned long absRTT = (node->SRTT > actualRTT) ? (node->SRTT - actualRTT) : (actualRTT - node->SRTT);
-        node->RTTVAR = std::min((node->RTTVAR * 3 + absRTT) / 4, 100000UL);
-        node->SRTT = std::min((node->SRTT * 7 + actualRTT) / 8, 100000UL);
-    }
+    RoutingTableService::updateRTT(config->source, actualRTT);
 
     config->calculatingRTT = millis();
-
-    ESP_LOGV(LM_TAG, "Updating RTT (%u ms), SRTT (%u), RTTVAR (%u) seq_Id: %d Src: %X",
-        (unsigned int) actualRTT, (unsigned int) node->SRTT, (unsigned int) node->RTTVAR, config->seq_id, config->source);
 }
 
 void LoraMesher::clearLinkedList(listConfiguration* listConfig) {
@@ -1366,11 +2209,18 @@ void LoraMesher::clearLinkedList(listConfiguration* listConfig) {
 
     for (int i = 0; i < listSize; i++) {
         QueuePacket<ControlPacket>* current = list->getCurrent();
-        PacketQueueService::deleteQueuePacketAndPacket(current);
         list->DeleteCurrent();
+        PacketQueueService::deleteQueuePacketAndPacket(current);
     }
 
     delete list;
+
+    sequenceTimeouts->setInUse();
+    sequenceTimeouts->remove(listConfig->config);
+    sequenceTimeouts->releaseInUse();
+
+    delete[] listConfig->fragments;
+    vPortFree(listConfig->reassembly);
     delete listConfig->config;
     delete listConfig;
 }
@@ -1381,109 +2231,167 @@ void LoraMesher::findAndClearLinkedList(LM_LinkedList<listConfiguration>* queue,
     if (!queue->Search(listConfig)) {
         ESP_LOGE(LM_TAG, "Not found list config");
         queue->releaseInUse();
+        return;
     }
 
-    clearLinkedList(listConfig);
-
+    getSequenceIndex(queue)->erase(getSequenceKey(listConfig->config->seq_id, listConfig->config->source));
     queue->DeleteCurrent();
 
+    clearLinkedList(listConfig);
+
     queue->releaseInUse();
 }
 
 LoraMesher::listConfiguration* LoraMesher::findSequenceList(LM_LinkedList<listConfiguration>* queue, uint8_t seq_id, uint16_t source) {
-    queue->setInUse();
+    queue->setInRead();
 
-    if (queue->moveToStart()) {
-        do {
-            listConfiguration* current = queue->getCurrent();
+    listConfiguration** listConfig = getSequenceIndex(queue)->find(getSequenceKey(seq_id, source));
 
-            if (current->config->seq_id == seq_id && current->config->source == source) {
-                queue->releaseInUse();
-                return current;
-            }
+    queue->releaseInRead();
+
+    return listConfig != nullptr ? *listConfig : nullptr;
+}
 
-        } while (queue->next());
+bool LoraMesher::addSequenceList(LM_LinkedList<listConfiguration>* queue, listConfiguration* listConfig) {
+    queue->setInUse();
+
+    listConfiguration** indexed = getSequenceIndex(queue)->insert(getSequenceKey(listConfig->config->seq_id, listConfig->config->source));
+    // Full index or a sequence with the same id and address is still open
+    if (indexed == nullptr || *indexed != nullptr) {
+        queue->releaseInUse();
+        return false;
     }
 
+    *indexed = listConfig;
+    queue->Append(listConfig);
+
     queue->releaseInUse();
+    return true;
+}
 
-    return nullptr;
+void LoraMesher::managerTimeouts() {
+    ESP_LOGV(LM_TAG, "Checking timeouts. Open connections WRP: %d WSP: %d", q_WRP->getLength(), q_WSP->getLength());
 
-}
+    // Hold both queues, the expired sequences cannot be cleared by other tasks while they are managed
+    q_WRP->setInUse();
+    q_WSP->setInUse();
 
-void LoraMesher::managerReceivedQueue() {
-    managerTimeouts(q_WRP, QueueType::WRP);
-}
+    for (;;) {
+        sequenceTimeouts->setInUse();
+
+        sequencePacketConfig* configPacket = sequenceTimeouts->top();
+        if (configPacket == nullptr || configPacket->getHeapKey() >= millis()) {
+            sequenceTimeouts->releaseInUse();
+            break;
+        }
+
+        sequenceTimeouts->pop();
+        sequenceTimeouts->releaseInUse();
+
+        LM_LinkedList<listConfiguration>* queue = configPacket->queueType == QueueType::WRP ? q_WRP : q_WSP;
+
+        listConfiguration** current = getSequenceIndex(queue)->find(getSequenceKey(configPacket->seq_id, configPacket->source));
+        if (current == nullptr || (*current)->config != configPacket) {
+            ESP_LOGE(LM_TAG, "Timeout of a sequence not found in the queue, Seq_Id: %d", configPacket->seq_id);
+            continue;
+        }
+
+        unsigned long now = millis();
+
+        if (configPacket->pendingAcks > 0 && configPacket->ackTimeout < now)
+            flushDelayedAck(configPacket);
+
+        //Only the delayed ACK timeout has been reached
+        if (configPacket->timeout >= now) {
+            scheduleTimeout(configPacket);
+            continue;
+        }
+
+        manageSequenceTimeout(queue, *current);
+    }
 
-void LoraMesher::managerSendQueue() {
-    managerTimeouts(q_WSP, QueueType::WSP);
+    q_WSP->releaseInUse();
+    q_WRP->releaseInUse();
 }
 
-void LoraMesher::managerTimeouts(LM_LinkedList<listConfiguration>* queue, QueueType type) {
+void LoraMesher::manageSequenceTimeout(LM_LinkedList<listConfiguration>* queue, listConfiguration* current) {
+    sequencePacketConfig* configPacket = current->config;
+
     String queueName;
-    if (type == QueueType::WRP) {
+    if (configPacket->queueType == QueueType::WRP) {
         queueName = F("Waiting Received Queue");
     }
     else {
         queueName = F("Waiting Send Queue");
     }
 
-    ESP_LOGV(LM_TAG, "Checking %s timeouts. Open connections %d", queueName.c_str(), queue->getLength());
-
-    queue->setInUse();
+    // Increment number of timeouts
+    configPacket->numberOfTimeouts++;
+
+    // Description of the timeout:
+    // The number of the packet would be the following: 
+    // If it is a sender it starts from 0 to n + 1 packets, that includes the sync packet: If num = 0, it is that the sync packet has been lost, if num > 0, it is that the packet num - 1 has been lost
+    // For the the receiver it starts from 0 to n packets
+    ESP_LOGW(LM_TAG, "%s timeout reached, Src: %X, Seq_Id: %d, Num: %d, N.TimeOuts %d",
+        queueName.c_str(), configPacket->source, configPacket->seq_id, configPacket->lastAck + configPacket->firstAckReceived, configPacket->numberOfTimeouts);
+
+    // If number of timeouts is greater than Max timeouts, erase it
+    if (configPacket->numberOfTimeouts >= MAX_TIMEOUTS) {
+        ESP_LOGE(LM_TAG, "%s, MAX TIMEOUTS reached, erasing Id: %d", queueName.c_str(), configPacket->seq_id);
+        getSequenceIndex(queue)->erase(getSequenceKey(configPacket->seq_id, configPacket->source));
+        if (queue->Search(current))
+            queue->DeleteCurrent();
+        clearLinkedList(current);
+        return;
+    }
 
-    if (queue->moveToStart()) {
-        do {
-            listConfiguration* current = queue->getCurrent();
-
-            // Get Config packet
-            sequencePacketConfig* configPacket = current->config;
-
-            // If Config packet has reached timeout
-            if (configPacket->timeout < millis()) {
-                // Increment number of timeouts
-                configPacket->numberOfTimeouts++;
-
-                // Description of the timeout:
-                // The number of the packet would be the following: 
-                // If it is a sender it starts from 0 to n + 1 packets, that includes the sync packet: If num = 0, it is that the sync packet has been lost, if num > 0, it is that the packet num - 1 has been lost
-                // For the the receiver it starts from 0 to n packets
-                ESP_LOGW(LM_TAG, "%s timeout reached, Src: %X, Seq_Id: %d, Num: %d, N.TimeOuts %d",
-                    queueName.c_str(), configPacket->source, configPacket->seq_id, configPacket->lastAck + configPacket->firstAckReceived, configPacket->numberOfTimeouts);
-
-                // If number of timeouts is greater than Max timeouts, erase it
-                if (configPacket->numberOfTimeouts >= MAX_TIMEOUTS) {
-                    ESP_LOGE(LM_TAG, "%s, MAX TIMEOUTS reached, erasing Id: %d", queueName.c_str(), configPacket->seq_id);
-                    clearLinkedList(current);
-                    queue->DeleteCurrent();
-                    continue;
-                }
+    // Recalculate the timeout
+    recalculateTimeoutAfterTimeout(configPacket);
 
-                // Recalculate the timeout
-                recalculateTimeoutAfterTimeout(configPacket);
+    if (configPacket->queueType == QueueType::WSP) {
+        uint16_t nextHop = RoutingTableService::getNextHop(configPacket->source);
 
-                if (type == QueueType::WRP) {
-                    // Send Last ACK + 1 (Request this packet)
-                    sendLostPacket(configPacket->source, configPacket->seq_id, configPacket->lastAck + 1);
-                }
-                else {
-                    // Repeat the configPacket ACK
-                    if (configPacket->firstAckReceived == 0)
-                        // Send the first packet of the sequence (SYNC packet)
-                        sendPacketSequence(current, 0);
-                }
-            }
+        // Send with the configured power until the next hop reports the SNR again
+        RoutingTableService::clearSentSNR(nextHop);
 
-            vTaskDelay(1);
+        // The next hop is dead, the next packets of the sequence use the alternative next hops
+        if (nextHop != 0 && configPacket->numberOfTimeouts % LM_FAILOVER_TIMEOUTS == 0) {
+            ESP_LOGW(LM_TAG, "Next hop %X not responding, changing the routes through it", nextHop);
+            incRouteFailovers(RoutingTableService::failNextHop(nextHop));
+            notifyRoutingChanged();
+            notifyRoutesRemoved();
+        }
+    }
 
-        } while (queue->next());
+    if (configPacket->queueType == QueueType::WRP) {
+        // Send Last ACK + 1 (Request this packet)
+        sendLostPacket(configPacket->source, configPacket->seq_id, configPacket->lastAck + 1);
+    }
+    else {
+        // Repeat the configPacket ACK
+        if (configPacket->firstAckReceived == 0)
+            // Send the first packet of the sequence (SYNC packet)
+            sendPacketSequence(current, 0);
     }
+}
 
-    queue->releaseInUse();
+void LoraMesher::scheduleTimeout(sequencePacketConfig* configPacket) {
+    sequenceTimeouts->setInUse();
+
+    if (!sequenceTimeouts->push(configPacket))
+        ESP_LOGE(LM_TAG, "Sequence timeouts full, Seq_Id: %d", configPacket->seq_id);
+
+    bool isNextTimeout = sequenceTimeouts->top() == configPacket;
+
+    sequenceTimeouts->releaseInUse();
+
+    // Wake the queue manager to wait for the new next timeout
+    if (isNextTimeout)
+        notifyNewSequenceStarted();
 }
 
 unsigned long LoraMesher::getMaximumTimeout(sequencePacketConfig* configPacket) {
-    uint8_t hops = configPacket->node->networkNode.metric;
+    uint8_t hops = RoutingTableService::getNumberOfHops(configPacket->source);
     if (hops == 0) {
         ESP_LOGE(LM_TAG, "Find next hop in add timeout");
         return 100000;
@@ -1497,18 +2405,19 @@ unsigned long LoraMesher::calculateTimeout(sequencePacketConfig* configPacket) {
     //TODO: This timeout should be a little variable depending on the duty cycle. 
     //TODO: Account for how many hops the packet needs to do
     //TODO: Account for how many packets are inside the Q_SP
-    uint8_t hops = configPacket->node->networkNode.metric;
-    if (hops == 0) {
+    uint8_t hops = 0;
+    unsigned long SRTT = 0, RTTVAR = 0;
+    if (!RoutingTableService::getRTT(configPacket->source, hops, SRTT, RTTVAR) || hops == 0) {
         ESP_LOGE(LM_TAG, "Find next hop in add timeout");
         return MIN_TIMEOUT * 1000;
     }
 
-    if (configPacket->node->SRTT == 0)
+    if (SRTT == 0)
         // TODO: The default timeout should be enough smaller to prevent unnecessary timeouts.
         // TODO: Testing the default value
         return MIN_TIMEOUT * 1000 + hops * 5000;
 
-    unsigned long calculatedTimeout = configPacket->node->SRTT + 4 * configPacket->node->RTTVAR;
+    unsigned long calculatedTimeout = SRTT + 4 * RTTVAR;
     unsigned long maxTimeout = getMaximumTimeout(configPacket);
 
     if (calculatedTimeout > maxTimeout)
@@ -1523,6 +2432,8 @@ void LoraMesher::addTimeout(sequencePacketConfig* configPacket) {
     configPacket->timeout = millis() + timeout;
     configPacket->previousTimeout = timeout;
 
+    scheduleTimeout(configPacket);
+
     ESP_LOGV(LM_TAG, "Timeout set to %u s", (unsigned int) (timeout / 1000));
 }
 
@@ -1549,6 +2460,8 @@ void LoraMesher::recalculateTimeoutAfterTimeout(sequencePacketConfig* configPack
     configPacket->timeout = millis() + timeout;
     configPacket->previousTimeout = timeout;
 
+    scheduleTimeout(configPacket);
+
     ESP_LOGV(LM_TAG, "Timeout recalculated to %u s", (unsigned int) (timeout / 1000));
 }
 
@@ -11,6 +11,18 @@
 
 #include "utilities/LinkedQueue.hpp"
 
+#include "utilities/PriorityQueue.hpp"
+
+#include "utilities/RingBuffer.hpp"
+
+#include "utilities/HashTable.hpp"
+
+#include "utilities/MinHeap.hpp"
+
+#include "utilities/AirtimeLedger.hpp"
+
+#include "utilities/LatencyHistogram.hpp"
+
 #include "services/PacketService.h"
 
 #include "services/RoutingTableService.h"
@@ -48,6 +60,18 @@ public:
         SX1280_MOD,
     };
 
+    /**
+     * @brief Traffic classes of the send queue. Each class has its own limit of packets inside the send queue
+     *
+     */
+    enum TrafficClass: uint8_t {
+        ROUTING_CLASS, // Hello packets
+        CONTROL_CLASS, // ACK, LOST and SYNC packets
+        FORWARDED_CLASS, // Data packets from other nodes
+        LOCAL_CLASS, // Data packets created by this node
+        NUM_TRAFFIC_CLASSES,
+    };
+
     /**
      * @brief LoRaMesher configuration
      *
@@ -68,7 +92,7 @@ public:
         uint8_t syncWord = LM_SYNC_WORD; // LoRa sync word. Can be used to distinguish different networks. Note that value 0x34 is reserved for LoRaWAN networks.
         int8_t power = LM_POWER; // Transmission output power in dBm. Allowed values range from 2 to 17 dBm.
         uint16_t preambleLength = LM_PREAMBLE_LENGTH; // Length of LoRa transmission preamble in symbols. The actual preamble length is 4.25 symbols longer than the set number. Allowed values range from 6 to 65535.
-        // MAX packet size per packet in bytes. It could be changed between 13 and 255 bytes. Recommended 100 or less bytes.
+        // MAX packet size per packet in bytes. It could be changed between 21 and 255 bytes, smaller sizes are raised to the minimum. Recommended 100 or less bytes.
         // If exceed it will be automatically separated through multiple packets 
         // In bytes (226 bytes [UE max allowed with SF7 and 125khz])
         // MAX payload size for hello packets = LM_MAX_PACKET_SIZE - 7 bytes of header
@@ -76,6 +100,28 @@ public:
         // MAX payload size for reliable and large packets = LM_MAX_PACKET_SIZE - 7 bytes of header - 2 bytes of via - 3 of control packet.
         // Having different max_packet_size in the same network will cause problems.
         size_t max_packet_size = LM_MAX_PACKET_SIZE;
+        // Number of preallocated buffers of max_packet_size bytes used for the packets. When all are in use, the packets are allocated in the heap.
+        size_t packetPoolSize = LM_PACKET_POOL_SIZE;
+        // Number of received frames that can wait to be processed. When the ring is full, the received frames are dropped.
+        size_t receivedFramesRingSize = LM_RECEIVED_RING_SIZE;
+        // Number of packets of a reliable sequence sent without waiting for their ACK, up to LM_MAX_RELIABLE_WINDOW. 1 is stop-and-wait. The receiver uses the window of the sender.
+        uint8_t reliableWindowSize = LM_RELIABLE_WINDOW;
+        // Number of received packets of a reliable sequence acknowledged with a single ACK. 1 sends an ACK for every packet.
+        uint8_t delayedAckCount = LM_DELAYED_ACK_COUNT;
+        // Percentage of the airtime that can be used over a sliding window of one hour, for each frequency. 100 disables the limit. E.g. 1 or 0.1 for the EU868 sub-bands.
+        float dutyCycle = LM_DUTY_CYCLE;
+        // Time in ms that a data packet waits for other data packets with the same next hop to be aggregated, when the send queue is empty. 0 only aggregates the queued packets.
+        uint32_t aggregationHoldTime = LM_AGGREGATION_HOLD_TIME;
+        // SNR margin in dB over the demodulation floor kept by the transmit power control of the unicast packets. 0 sends all the packets with the configured power.
+        uint8_t txPowerSnrMargin = LM_TX_POWER_SNR_MARGIN;
+        // Maximum number of packets of each traffic class inside the send queue, indexed by TrafficClass. The new packets of a full class are dropped. The routing limit is raised to fit a full routing table advertisement.
+        uint16_t sendQueueLimits[NUM_TRAFFIC_CLASSES] = {LM_ROUTING_QUEUE_LIMIT, LM_CONTROL_QUEUE_LIMIT, LM_FORWARDED_QUEUE_LIMIT, LM_LOCAL_QUEUE_LIMIT};
+        // Time in ms that a forwarded data packet can wait since it was received until it is sent. Older forwarded packets are dropped. 0 disables it.
+        uint32_t forwardedMaxAge = LM_FORWARDED_MAX_AGE;
+        // Routing metric, LM_HOP_COUNT_METRIC, LM_SNR_METRIC or LM_ETX_METRIC. All the nodes of the network need to use the same metric.
+        uint8_t routingMetric = LM_ROUTING_METRIC;
+        // Minimum improvement of the metric to change the next hop of a route with the SNR and ETX metrics, so the routes do not flap with small variations of the links.
+        uint8_t routeHysteresis = LM_ROUTE_HYSTERESIS;
 #ifdef ARDUINO
         // Custom SPI pins
         SPIClass* spi = nullptr;
@@ -215,7 +261,11 @@ public:
      * @param power Transmission output power in dBm.
      * @param useRfo Whether to use the RFO (true) or the PA_BOOST (false) pin for the RF output. Defaults to PA_BOOST.
      */
-    void setOutputPower(int8_t power, bool useRfo = false) { radio->setOutputPower(power, useRfo); }
+    void setOutputPower(int8_t power, bool useRfo = false) {
+        loraMesherConfig->power = power;
+        currentPower = power;
+        radio->setOutputPower(power, useRfo);
+    }
 
     /**
      * @brief Set the Receive App Data Task Handle, every time a received packet for this node is detected, this task will be notified.
@@ -228,7 +278,21 @@ public:
      * @brief A copy of the routing table list. Delete it after using the list.
      *
      */
-    LM_LinkedList<RouteNode>* routingTableListCopy() { return new LM_LinkedList<RouteNode>(*RoutingTableService::routingTableList); }
+    LM_LinkedList<RouteNode>* routingTableListCopy() { return RoutingTableService::getRoutingTableListCopy(); }
+
+    /**
+     * @brief Get an immutable snapshot of the routing table, shared between the readers. Call release() of the snapshot after using it.
+     *
+     * @return RoutingTableSnapshot* Snapshot of the routing table
+     */
+    RoutingTableSnapshot* getRoutingTableSnapshot() { return RoutingTableService::getRoutingTableSnapshot(); }
+
+    /**
+     * @brief Get the version of the routing table. Compare it with the version of a snapshot to know if the routing table has changed.
+     *
+     * @return uint32_t Version of the routing table
+     */
+    uint32_t getRoutingTableVersion() { return RoutingTableService::getRoutingTableVersion(); }
 
     /**
      * @brief Create a Packet And Send it
@@ -259,6 +323,7 @@ public:
     /**
      * @brief Send the payload reliable.
      * It will wait for an ACK back from the destination to send the next packet.
+     * Payloads that need more than LM_MAX_SEQUENCE_PACKETS packets are not sent.
      *
      * @param dst destination address
      * @param payload payload to send
@@ -293,6 +358,23 @@ public:
      */
     size_t getSendQueueSize();
 
+    /**
+     * @brief Get the number of packets of a traffic class waiting inside the send queue
+     *
+     * @param trafficClass Traffic class
+     * @return uint16_t
+     */
+    uint16_t getSendQueueOccupancy(TrafficClass trafficClass);
+
+    /**
+     * @brief Get the number of packets of a traffic class dropped because the class was full inside the send queue,
+     * or because they waited too long inside it
+     *
+     * @param trafficClass Traffic class
+     * @return uint32_t
+     */
+    uint32_t getSendQueueDropsNum(TrafficClass trafficClass);
+
     /**
       * @brief Get the Next Application Packet
       *
@@ -315,7 +397,7 @@ public:
      */
     template <typename T>
     static void deletePacket(AppPacket<T>* p) {
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 
     /**
@@ -361,6 +443,49 @@ public:
      */
     uint32_t getSentHelloPacketsNum() { return sentHelloPacketsNum; }
 
+    /**
+     * @brief Get the number of route advertisements with the whole routing table. The others only have the changes
+     *
+     * @return uint32_t
+     */
+    uint32_t getSentFullRoutingNum() { return sentFullRoutingNum; }
+
+    /**
+     * @brief Get the number of route packets received after losing previous route packets of the same source
+     *
+     * @return uint32_t
+     */
+    uint32_t getRoutingResyncsNum() { return routingResyncsNum; }
+
+    /**
+     * @brief Get the number of routes advertised inside the route packets, including the withdrawn routes
+     *
+     * @return uint32_t
+     */
+    uint32_t getAdvertisedRoutesNum() { return advertisedRoutesNum; }
+
+    /**
+     * @brief Get the bytes of the routes advertised inside the route packets, without the headers and the link qualities.
+     * Divided by getAdvertisedRoutesNum() it is the average size of an advertised route
+     *
+     * @return uint32_t
+     */
+    uint32_t getAdvertisedRoutesBytes() { return advertisedRoutesBytes; }
+
+    /**
+     * @brief Get the number of routes changed to an alternative next hop, because their next hop was not responding
+     *
+     * @return uint32_t
+     */
+    uint32_t getRouteFailoversNum() { return routeFailoversNum; }
+
+    /**
+     * @brief Get the number of reliable sequences aborted, because the route to their node was removed
+     *
+     * @return uint32_t
+     */
+    uint32_t getAbortedSequencesNum() { return abortedSequencesNum; }
+
     /**
      * @brief Get the Received Broadcast Packets Num
      *
@@ -375,6 +500,20 @@ public:
      */
     uint32_t getForwardedPacketsNum() { return forwardedPacketsNum; }
 
+    /**
+     * @brief Get the number of packets in transit forwarded directly by the receive routine
+     *
+     * @return uint32_t
+     */
+    uint32_t getFastForwardedPacketsNum() { return fastForwardedPacketsNum; }
+
+    /**
+     * @brief Get the histogram of the time in ms between receiving a packet in transit and sending it to the next hop
+     *
+     * @return const LM_LatencyHistogram&
+     */
+    const LM_LatencyHistogram& getForwardingLatencyHistogram() { return forwardingLatency; }
+
     /**
      * @brief Get the Data Packets For Me Num
      *
@@ -431,6 +570,163 @@ public:
      */
     uint32_t getSentControlBytes() { return sentControlBytes; }
 
+    /**
+     * @brief Get the number of received frames dropped because the received frames ring was full
+     *
+     * @return uint32_t
+     */
+    uint32_t getReceivedDroppedNum() { return receivedDroppedNum; }
+
+    /**
+     * @brief Get the airtime that can still be used in the actual frequency over the last hour
+     *
+     * @return uint32_t remaining airtime in ms, LM_AirtimeLedger::UNLIMITED if the duty cycle is 100
+     */
+    uint32_t getRemainingAirtimeBudget() { return airtimeLedger.getRemaining(loraMesherConfig->freq, millis()); }
+
+    /**
+     * @brief Get the airtime used in the actual frequency over the last hour
+     *
+     * @return uint32_t used airtime in ms
+     */
+    uint32_t getUsedAirtime() { return airtimeLedger.getUsed(loraMesherConfig->freq, millis()); }
+
+    /**
+     * @brief Get the total time the packets waited for airtime budget before being sent, in ms
+     *
+     * @return uint32_t
+     */
+    uint32_t getAirtimeBudgetWaitTime() { return airtimeBudgetWaitTime; }
+
+    /**
+     * @brief Get the number of packets dropped because their time on air is longer than the whole airtime budget
+     *
+     * @return uint32_t
+     */
+    uint32_t getAirtimeBudgetDroppedNum() { return airtimeBudgetDroppedNum; }
+
+    /**
+     * @brief Get the number of aggregated packets sent
+     *
+     * @return uint32_t
+     */
+    uint32_t getSentAggregatedPacketsNum() { return sentAggregatedPacketsNum; }
+
+    /**
+     * @brief Get the number of data packets sent inside aggregated packets
+     *
+     * @return uint32_t
+     */
+    uint32_t getAggregatedDataPacketsNum() { return aggregatedDataPacketsNum; }
+
+    /**
+     * @brief Get the airtime saved by sending the data packets inside aggregated packets, in ms
+     *
+     * @return uint32_t
+     */
+    uint32_t getAggregationAirtimeSaved() { return aggregationAirtimeSaved; }
+
+    /**
+     * @brief Get the number of packets sent with less power than the configured one
+     *
+     * @return uint32_t
+     */
+    uint32_t getReducedPowerPacketsNum() { return reducedPowerPacketsNum; }
+
+    /**
+     * @brief Get the number of ACK packets not sent, because they have been coalesced into delayed ACKs
+     *
+     * @return uint32_t
+     */
+    uint32_t getAcksSavedNum() { return acksSavedNum; }
+
+    /**
+     * @brief Get the number of channel activity detections done before sending
+     *
+     * @return uint32_t
+     */
+    uint32_t getChannelScansNum() { return channelScansNum; }
+
+    /**
+     * @brief Get the number of channel activity detections that found the channel busy
+     *
+     * @return uint32_t
+     */
+    uint32_t getChannelBusyNum() { return channelBusyNum; }
+
+    /**
+     * @brief Get the ratio of channel activity detections that found the channel busy
+     *
+     * @return float between 0 and 1
+     */
+    float getChannelBusyRatio() { return channelScansNum == 0 ? 0 : (float) channelBusyNum / channelScansNum; }
+
+    /**
+     * @brief Get the total time waited in backoffs before sending, in ms
+     *
+     * @return uint32_t
+     */
+    uint32_t getBackoffTime() { return backoffTime; }
+
+    /**
+     * @brief Get the number of packets sent with the channel busy, after LM_CSMA_MAX_ATTEMPTS channel activity detections
+     *
+     * @return uint32_t
+     */
+    uint32_t getChannelAccessFailuresNum() { return channelAccessFailuresNum; }
+
+    /**
+     * @brief Get the number of received packets with a wrong CRC, most of them are caused by collisions
+     *
+     * @return uint32_t
+     */
+    uint32_t getCollisionsNum() { return collisionsNum; }
+
+    /**
+     * @brief Get the ratio of received packets with a wrong CRC
+     *
+     * @return float between 0 and 1
+     */
+    float getCollisionRatio() {
+        uint32_t received = receivedDataPacketsNum + receivedHelloPacketsNum + collisionsNum;
+        return received == 0 ? 0 : (float) collisionsNum / received;
+    }
+
+    /**
+     * @brief Get the number of buffers of the packet pool
+     *
+     * @return size_t
+     */
+    size_t getPacketPoolSize() { return LM_PacketPool::getInstance().getSize(); }
+
+    /**
+     * @brief Get the number of buffers of the packet pool in use
+     *
+     * @return uint32_t
+     */
+    uint32_t getPacketPoolUsed() { return LM_PacketPool::getInstance().getUsed(); }
+
+    /**
+     * @brief Get the maximum number of buffers of the packet pool used at the same time
+     *
+     * @return uint32_t
+     */
+    uint32_t getPacketPoolPeak() { return LM_PacketPool::getInstance().getPeak(); }
+
+    /**
+     * @brief Get the number of packets allocated in the heap because the packet pool was exhausted
+     *
+     * @return uint32_t
+     */
+    uint32_t getPacketPoolFallbacks() { return LM_PacketPool::getInstance().getFallbacks(); }
+
+    /**
+     * @brief Get the number of packets allocated in the heap because they were greater than the buffers of the packet pool
+     *
+     * @return uint32_t
+     */
+    uint32_t getPacketPoolOversized() { return LM_PacketPool::getInstance().getOversized(); }
+
     /**
      * @brief Defines that the node is a gateway
      *
@@ -453,17 +749,21 @@ public:
     /**
      * @brief Get the Nearest Gateway object
      *
-     * @return RouteNode*
+     * @param gateway Copy of the Route Node of the gateway
+     * @return true If there is a gateway inside the routing table
+     * @return false If not
      */
-    static RouteNode* getClosestGateway() { return RoutingTableService::getBestNodeByRole(ROLE_GATEWAY); };
+    static bool getClosestGateway(RouteNode& gateway) { return RoutingTableService::getBestNodeByRole(ROLE_GATEWAY, gateway); };
 
     /**
      * @brief Get the Best Node With Role
      *
      * @param role Role to be searched
-     * @return RouteNode* Route Node
+     * @param node Copy of the Route Node
+     * @return true If there is a node with the role inside the routing table
+     * @return false If not
      */
-    static RouteNode* getBestNodeWithRole(uint8_t role) { return RoutingTableService::getBestNodeByRole(role); };
+    static bool getBestNodeWithRole(uint8_t role, RouteNode& node) { return RoutingTableService::getBestNodeByRole(role, node); };
 
     /**
      * @brief Set the Simulator Service object
@@ -494,11 +794,61 @@ private:
      */
     LoraMesherConfig* loraMesherConfig = new LoraMesherConfig();
 
+    /**
+     * @brief Airtime used by the sent packets, for each frequency
+     *
+     */
+    LM_AirtimeLedger airtimeLedger;
+
+    /**
+     * @brief Wait until the packet can be sent without exceeding the duty cycle
+     *
+     * @param timeOnAir Time on air of the packet in ms
+     * @return true The packet can be sent
+     * @return false The time on air is longer than the whole budget, the packet can never be sent
+     */
+    bool waitAirtimeBudget(uint32_t timeOnAir);
+
+    /**
+     * @brief Aggregate the queued data packets with the same next hop into a single packet
+     *
+     * @param tx Data packet to be sent
+     * @param nextHop Next hop of the data packet
+     * @return QueuePacket<Packet<uint8_t>>* the aggregated packet, or tx if there are no other packets to aggregate
+     */
+    QueuePacket<Packet<uint8_t>>* aggregatePackets(QueuePacket<Packet<uint8_t>>* tx, uint16_t nextHop);
+
+    /**
+     * @brief Output power of the radio
+     *
+     */
+    int8_t currentPower = LM_POWER;
+
+    /**
+     * @brief Get the transmit power for the packet. The unicast packets use the lowest power that keeps the SNR margin
+     * at the next hop, from the SNR reported inside its hello packets. The hello packets are sent with the configured power.
+     *
+     * @param p Packet to be sent
+     * @return int8_t Power in dBm
+     */
+    int8_t getTransmitPower(Packet<uint8_t>* p);
+
+    /**
+     * @brief Set the output power of the radio, if it is different than the actual one
+     *
+     * @param power Power in dBm
+     */
+    void setTransmitPower(int8_t power);
+
     LM_LinkedList<AppPacket<uint8_t>>* ReceivedAppPackets = new LM_LinkedList<AppPacket<uint8_t>>();
 
-    LM_LinkedList<QueuePacket<Packet<uint8_t>>>* ReceivedPackets = new LM_LinkedList<QueuePacket<Packet<uint8_t>>>();
+    /**
+     * @brief Received frames waiting to be processed. The receiving routine is the only producer and the process routine the only consumer
+     *
+     */
+    LM_ReceivedFrameRing* ReceivedFrames = nullptr;
 
-    LM_LinkedList<QueuePacket<Packet<uint8_t>>>* ToSendPackets = new LM_LinkedList<QueuePacket<Packet<uint8_t>>>();
+    LM_PriorityQueue<QueuePacket<Packet<uint8_t>>>* ToSendPackets = new LM_PriorityQueue<QueuePacket<Packet<uint8_t>>>();
 
     /**
      * @brief RadioLib module
@@ -514,13 +864,13 @@ private:
 
     /**
      * @brief Receive packets task handle. Every time a LoRa packet is detected it will create a packet,
-     *  store it into the received packets queue and notify the receive data task handle
+     *  store it into the received frames ring and notify the receive data task handle
      *
      */
     TaskHandle_t ReceivePacket_TaskHandle = nullptr;
 
     /**
-     * @brief Receive Data task handle. It will process all the packets inside the received packets queue.
+     * @brief Receive Data task handle. It will process all the packets inside the received frames ring.
      * It will be notified by the ReceivePacket_TaskHandle
      *
      */
@@ -556,6 +906,27 @@ private:
 
     static void onReceive(void);
 
+    /**
+     * @brief Interrupt called when a packet has been sent
+     *
+     */
+    static void onTransmitDone(void);
+
+    /**
+     * @brief Given by the TX done interrupt, the send task waits it while the packet is being sent
+     *
+     */
+    SemaphoreHandle_t transmitDoneSemaphore = xSemaphoreCreateBinary();
+
+    /**
+     * @brief Start the transmission and block the task until the TX done interrupt
+     *
+     * @param frame Frame to be sent
+     * @param frameLength Length of the frame in bytes
+     * @return int RadioLib status code
+     */
+    int transmitAsync(uint8_t* frame, size_t frameLength);
+
     void setDioActionsForScanChannel();
 
     void setDioActionsForReceivePacket();
@@ -565,10 +936,21 @@ private:
     int startReceiving();
 
     /**
-     * @brief Scan activity channel
+     * @brief Blocking channel activity detection
+     *
+     * @return true If the channel is free
+     * @return false If a LoRa preamble has been detected
+     */
+    bool channelScan();
+
+    /**
+     * @brief Add a received frame in transit directly to the send queue, without the process routine
      *
+     * @param frame Received frame
+     * @return true If the frame was in transit and it has been handled
+     * @return false If the frame needs to be processed by the process routine
      */
-    void channelScan();
+    bool forwardTransitFrame(LM_ReceivedFrame* frame);
 
     int startChannelScan();
 
@@ -580,6 +962,56 @@ private:
 
     void sendHelloPacket();
 
+    /**
+     * @brief Send the whole routing table inside route packets of the previous versions, HELLO_P
+     *
+     * @param snapshot Snapshot of the routing table
+     */
+    void sendLegacyHelloPackets(RoutingTableSnapshot* snapshot);
+
+    /**
+     * @brief The next route advertisement has the whole routing table, a neighbor has asked for it
+     *
+     */
+    volatile bool sendFullRouting = false;
+
+    /**
+     * @brief The next route advertisement asks the neighbors for their whole routing table, route packets have been lost
+     *
+     */
+    volatile bool requestFullRouting = false;
+
+    /**
+     * @brief Time in ms of the last route packet received from a node of the previous versions, 0 if none
+     *
+     */
+    volatile unsigned long lastLegacyHello = 0;
+
+    /**
+     * @brief Time in ms of the last route advertisement sent to the nodes of the previous versions
+     *
+     */
+    unsigned long lastLegacyAdvertisement = 0;
+
+    /**
+     * @brief Notify the hello task that the routing table has changed, to advertise the changes
+     *
+     */
+    void notifyRoutingChanged();
+
+    /**
+     * @brief Notify the routing table manager that routes have been removed, to purge the packets and sequences that depend on them
+     *
+     */
+    void notifyRoutesRemoved();
+
+    /**
+     * @brief Abort the reliable sequences with the node and drop the packets waiting to be sent to it, if the route has not been added again
+     *
+     * @param address Address of the removed route
+     */
+    void onRouteRemoved(uint16_t address);
+
     void routingTableManager();
 
     void queueManager();
@@ -601,12 +1033,36 @@ private:
     uint32_t sentHelloPacketsNum = 0;
     void incSentHelloPackets() { sentHelloPacketsNum++; }
 
+    uint32_t sentFullRoutingNum = 0;
+    void incSentFullRouting() { sentFullRoutingNum++; }
+
+    uint32_t routingResyncsNum = 0;
+    void incRoutingResyncs() { routingResyncsNum++; }
+
+    uint32_t advertisedRoutesNum = 0;
+    uint32_t advertisedRoutesBytes = 0;
+    void incAdvertisedRoutes(size_t routes, size_t bytes) {
+        advertisedRoutesNum += routes;
+        advertisedRoutesBytes += bytes;
+    }
+
+    uint32_t routeFailoversNum = 0;
+    void incRouteFailovers(uint32_t failovers) { routeFailoversNum += failovers; }
+
+    uint32_t abortedSequencesNum = 0;
+    void incAbortedSequences() { abortedSequencesNum++; }
+
     uint32_t receivedBroadcastPacketsNum = 0;
     void incReceivedBroadcast() { receivedBroadcastPacketsNum++; }
 
     uint32_t forwardedPacketsNum = 0;
     void incForwardedPackets() { forwardedPacketsNum++; }
 
+    uint32_t fastForwardedPacketsNum = 0;
+    void incFastForwardedPackets() { fastForwardedPacketsNum++; }
+
+    LM_LatencyHistogram forwardingLatency;
+
     uint32_t dataPacketForMeNum = 0;
     void incDataPacketForMe() { dataPacketForMeNum++; }
 
@@ -631,8 +1087,50 @@ private:
     uint32_t sentControlBytes = 0;
     void incSentControlBytes(uint32_t numBytes) { sentControlBytes += numBytes; }
 
+    uint32_t receivedDroppedNum = 0;
+    void incReceivedDropped() { receivedDroppedNum++; }
+
+    uint32_t acksSavedNum = 0;
+    void incAcksSaved(uint32_t numAcks) { acksSavedNum += numAcks; }
+
+    uint32_t channelScansNum = 0;
+    void incChannelScans() { channelScansNum++; }
+
+    uint32_t channelBusyNum = 0;
+    void incChannelBusy() { channelBusyNum++; }
+
+    uint32_t backoffTime = 0;
+    void incBackoffTime(uint32_t ms) { backoffTime += ms; }
+
+    uint32_t channelAccessFailuresNum = 0;
+    void incChannelAccessFailures() { channelAccessFailuresNum++; }
+
+    uint32_t collisionsNum = 0;
+    void incCollisions() { collisionsNum++; }
+
+    uint32_t airtimeBudgetWaitTime = 0;
+    void incAirtimeBudgetWaitTime(uint32_t ms) { airtimeBudgetWaitTime += ms; }
+
+    uint32_t airtimeBudgetDroppedNum = 0;
+    void incAirtimeBudgetDropped() { airtimeBudgetDroppedNum++; }
+
+    uint32_t sentAggregatedPacketsNum = 0;
+    void incSentAggregatedPackets() { sentAggregatedPacketsNum++; }
+
+    uint32_t aggregatedDataPacketsNum = 0;
+    void incAggregatedDataPackets(uint32_t numPackets) { aggregatedDataPacketsNum += numPackets; }
+
+    uint32_t aggregationAirtimeSaved = 0;
+    void incAggregationAirtimeSaved(uint32_t ms) { aggregationAirtimeSaved += ms; }
+
+    uint32_t reducedPowerPacketsNum = 0;
+    void incReducedPowerPackets() { reducedPowerPacketsNum++; }
+
+    uint32_t sendQueueDropsNum[NUM_TRAFFIC_CLASSES] = {0};
+    void incSendQueueDrops(TrafficClass trafficClass) { sendQueueDropsNum[trafficClass]++; }
+
     /**
-     * @brief Function that process the packets inside Received Packets
+     * @brief Function that process the frames inside Received Frames
      * Task executed every time that a packet arrive.
      *
      */
@@ -646,7 +1144,7 @@ private:
      */
     template <typename T>
     static void deletePacket(Packet<T>* p) {
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 
     /**
@@ -671,7 +1169,38 @@ private:
     void addToSendOrderedAndNotify(QueuePacket<Packet<uint8_t>>* qp);
 
     /**
-     * @brief Notify the QueueManager_TaskHandle that a new sequence has been started
+     * @brief Number of packets of each traffic class inside the ToSendPackets, updated with the ToSendPackets in use
+     *
+     */
+    uint16_t sendQueueOccupancy[NUM_TRAFFIC_CLASSES] = {0};
+
+    /**
+     * @brief Get the traffic class of a packet
+     *
+     * @param p Packet
+     * @return TrafficClass
+     */
+    TrafficClass getTrafficClass(Packet<uint8_t>* p);
+
+    /**
+     * @brief Add the Queue packet into the ToSendPackets without checking the limit of its traffic class.
+     * The data packets never have more priority than the routing and control packets.
+     * The ToSendPackets needs to be in use
+     *
+     * @param qp Queue packet
+     */
+    void pushToSendQueue(QueuePacket<Packet<uint8_t>>* qp);
+
+    /**
+     * @brief Remove the Queue packet from the occupancy of its traffic class, after taking it from the ToSendPackets.
+     * The ToSendPackets needs to be in use
+     *
+     * @param qp Queue packet
+     */
+    void removeFromSendQueueOccupancy(QueuePacket<Packet<uint8_t>>* qp);
+
+    /**
+     * @brief Notify the QueueManager_TaskHandle that a new sequence timeout has been scheduled
      *
      */
     void notifyNewSequenceStarted();
@@ -683,6 +1212,13 @@ private:
      */
     void processDataPacket(QueuePacket<DataPacket>* pq);
 
+    /**
+     * @brief Split the aggregated packet and process every data packet inside it
+     *
+     * @param pq packet queue of the aggregated packet
+     */
+    void processAggregatedPacket(QueuePacket<DataPacket>* pq);
+
     /**
      * @brief Process the data packet that destination is this node
      *
@@ -728,9 +1264,10 @@ private:
      * @param destination destination address
      * @param seq_id Sequence Id
      * @param num_packets Number of packets of the sequence
+     * @param window Number of packets sent without waiting for their ACK
      * @return QueuePacket<ControlPacket>*
      */
-    QueuePacket<ControlPacket>* getStartSequencePacketQueue(uint16_t destination, uint8_t seq_id, uint16_t num_packets);
+    QueuePacket<ControlPacket>* getStartSequencePacketQueue(uint16_t destination, uint8_t seq_id, uint16_t num_packets, uint8_t window);
 
     /**
      * @brief Sends an ACK packet to the destination
@@ -773,17 +1310,20 @@ private:
      * @param source Source Id
      * @param seq_id Sequence Id
      * @param seq_num Sequence number
+     * @param window Number of packets that the source sends without waiting for their ACK
      */
-    void processSyncPacket(uint16_t source, uint8_t seq_id, uint16_t seq_num);
+    void processSyncPacket(uint16_t source, uint8_t seq_id, uint16_t seq_num, uint8_t window);
 
     /**
      * @brief Add the ack number to the respectively sequence and reset the timeout numbers
      *
      * @param source Source of the packet
      * @param seq_id Sequence id of the packet
-     * @param seq_num Sequence number that has been Acknowledged
+     * @param seq_num Sequence number that has been Acknowledged, all the previous packets are acknowledged
+     * @param sack Bitmap of the packets acknowledged after seq_num + 1, bit 0 is seq_num + 2
+     * @param sackSize Size of the bitmap in bytes
      */
-    void addAck(uint16_t source, uint8_t seq_id, uint16_t seq_num);
+    void addAck(uint16_t source, uint8_t seq_id, uint16_t seq_num, uint8_t* sack = nullptr, size_t sackSize = 0);
 
     /**
      * @brief Sequence Id, used to get the id of the packet sequence
@@ -798,26 +1338,31 @@ private:
      */
     uint8_t getSequenceId();
 
-    /**
-     * @brief Manage all the packets inside the Q_WSP, checking for timeouts and erasing them if lost connection
-     *
-     */
-    void managerSendQueue();
+    enum QueueType {
+        WRP,
+        WSP
+    };
 
     /**
-     * @brief Manage all the packets inside the Q_WRP, checking for timeouts and erasing them if lost connection
+     * @brief State of every packet of a sequence
      *
      */
-    void managerReceivedQueue();
+    enum FragmentState: uint8_t {
+        FRAGMENT_PENDING, // Not sent or not received
+        FRAGMENT_SENT, // Sent, waiting for the ACK
+        FRAGMENT_RESENT, // Sent again, it will not be resent until a timeout or a lost packet
+        FRAGMENT_ACKED // Acknowledged by the receiver or received
+    };
 
     /**
      * @brief Used to set the configuration of the sequence of packets of the lists of packets
      *
      */
-    struct sequencePacketConfig {
+    struct sequencePacketConfig: public LM_HeapNode {
         //Identification is Sequence Id and Source address
         uint8_t seq_id; //Sequence Id
         uint16_t source; //Source Address
+        QueueType queueType; //Queue of the sequence, Q_WSP or Q_WRP
 
         uint16_t number{0}; //Number of packets of the sequence
         uint8_t firstAckReceived{0}; //If this value is set to 0, there has not been received any ack.
@@ -826,26 +1371,72 @@ private:
         unsigned long previousTimeout{0}; //Previous timeout of the sequence
         uint8_t numberOfTimeouts{0}; //Number of timeouts that has been occurred
         unsigned long calculatingRTT{0}; // Calculating RTT
-        RouteNode* node; //Node of the routing table sequence
+        uint8_t window{1}; //Number of packets sent without waiting for their ACK
+        uint16_t nextFragment{1}; //Next packet to be sent for the first time
+        FragmentState* fragmentState; //State of every packet of the sequence, from 0 to number
+        uint8_t pendingAcks{0}; //Q_WRP. Received packets not acknowledged yet
+        unsigned long ackTimeout{0}; //Q_WRP. Time when the pending ACKs need to be sent
+        uint32_t acksSaved{0}; //Q_WRP. ACK packets not sent in this sequence, coalesced into delayed ACKs
+
+        sequencePacketConfig(uint8_t seq_id, uint16_t source, QueueType queueType, uint16_t number):
+            seq_id(seq_id), source(source), queueType(queueType), number(number), fragmentState(new FragmentState[number + 1]()) {};
 
-        sequencePacketConfig(uint8_t seq_id, uint16_t source, uint16_t number, RouteNode* node): seq_id(seq_id), source(source), number(number), node(node) {};
+        ~sequencePacketConfig() { delete[] fragmentState; }
+
+        sequencePacketConfig(const sequencePacketConfig&) = delete;
+        sequencePacketConfig& operator=(const sequencePacketConfig&) = delete;
+
+        unsigned long getHeapKey() const { return pendingAcks > 0 && ackTimeout < timeout ? ackTimeout : timeout; }
     };
 
     /**
      * @brief List configuration
      *
      */
-    struct listConfiguration {
+    struct listConfiguration: public LM_IntrusiveListNode<listConfiguration> {
         sequencePacketConfig* config;
         LM_LinkedList<QueuePacket<ControlPacket>>* list;
-    };
+        QueuePacket<ControlPacket>** fragments = nullptr; //Q_WSP. Packets of the list indexed by their number, from 0 to config->number
+        AppPacket<uint8_t>* reassembly = nullptr; //Q_WRP. Packet where the received payloads are copied at their offset
 
-    enum QueueType {
-        WRP,
-        WSP
+        listConfiguration(sequencePacketConfig* config, LM_LinkedList<QueuePacket<ControlPacket>>* list): config(config), list(list) {};
     };
 
-    void managerTimeouts(LM_LinkedList<listConfiguration>* queue, QueueType type);
+    /**
+     * @brief Index of the sequences of a queue by sequence id and address
+     *
+     */
+    using SequenceIndex = LM_HashTable<uint32_t, listConfiguration*, LM_MAX_SEQUENCES>;
+
+    /**
+     * @brief Manage the sequences of the Q_WSP and Q_WRP that have reached the timeout, erasing them if lost connection
+     *
+     */
+    void managerTimeouts();
+
+    /**
+     * @brief Manage a sequence that has reached the timeout
+     *
+     * @param queue Queue of the sequence
+     * @param current List configuration of the sequence
+     */
+    void manageSequenceTimeout(LM_LinkedList<listConfiguration>* queue, listConfiguration* current);
+
+    /**
+     * @brief Abort the sequences of a queue with the node
+     *
+     * @param queue Q_WSP or Q_WRP
+     * @param address Address of the node
+     */
+    void abortSequences(LM_LinkedList<listConfiguration>* queue, uint16_t address);
+
+    /**
+     * @brief Add or update the timeout of the sequence inside the timeouts heap.
+     * It notifies the queue manager when the timeout is the next one to expire.
+     *
+     * @param configPacket configuration packet with the new timeout
+     */
+    void scheduleTimeout(sequencePacketConfig* configPacket);
 
     /**
      * @brief Actualize the RTT field
@@ -876,9 +1467,30 @@ private:
     bool sendPacketSequence(listConfiguration* lstConfig, uint16_t seq_num);
 
     /**
-     * @brief Join all the packets inside the list configuration and notify the user
+     * @brief Sends the cumulative ACK of a received sequence, with a bitmap of the packets received after the first missing one
+     *
+     * @param configPacket Configuration of the received sequence
+     */
+    void sendSelectiveAckPacket(sequencePacketConfig* configPacket);
+
+    /**
+     * @brief Acknowledge a received packet of a sequence. The ACK is delayed until there are enough pending ACKs or the ACK timeout is reached
      *
-     * @param listConfig list configuration to join
+     * @param configPacket Configuration of the received sequence
+     */
+    void addDelayedAck(sequencePacketConfig* configPacket);
+
+    /**
+     * @brief Send the pending ACKs of a received sequence, if any
+     *
+     * @param configPacket Configuration of the received sequence
+     */
+    void flushDelayedAck(sequencePacketConfig* configPacket);
+
+    /**
+     * @brief Notify the user with the reassembled packet of the list configuration and clear the list configuration
+     *
+     * @param listConfig list configuration with all the payloads received
      */
     void joinPacketsAndNotifyUser(listConfiguration* listConfig);
 
@@ -953,6 +1565,33 @@ private:
      */
     listConfiguration* findSequenceList(LM_LinkedList<listConfiguration>* queue, uint8_t seq_id, uint16_t source);
 
+    /**
+     * @brief Add the list configuration inside the queue and its index
+     *
+     * @param queue Queue where to add the list configuration
+     * @param listConfig List configuration to be added
+     * @return true If it has been added
+     * @return false If the maximum number of sequences has been reached
+     */
+    bool addSequenceList(LM_LinkedList<listConfiguration>* queue, listConfiguration* listConfig);
+
+    /**
+     * @brief Get the index of the sequences of the queue
+     *
+     * @param queue Q_WSP or Q_WRP
+     * @return SequenceIndex* Index of the queue
+     */
+    SequenceIndex* getSequenceIndex(LM_LinkedList<listConfiguration>* queue) { return queue == q_WSP ? q_WSPIndex : q_WRPIndex; }
+
+    /**
+     * @brief Get the key of a sequence inside the sequence index
+     *
+     * @param seq_id Sequence id
+     * @param source Source address of the sequence
+     * @return uint32_t key
+     */
+    static uint32_t getSequenceKey(uint8_t seq_id, uint16_t source) { return ((uint32_t) source << 8) | seq_id; }
+
     /**
      * @brief Queue Waiting Sending Packets (Q_WSP)
      * List pairs (sequencePacketConfig defines the configuration of the following packets, id and number of packets,
@@ -967,6 +1606,24 @@ private:
      */
     LM_LinkedList<listConfiguration>* q_WRP = new LM_LinkedList<listConfiguration>();
 
+    /**
+     * @brief Index of the Q_WSP sequences, protected by the Q_WSP lock
+     *
+     */
+    SequenceIndex* q_WSPIndex = new SequenceIndex();
+
+    /**
+     * @brief Index of the Q_WRP sequences, protected by the Q_WRP lock
+     *
+     */
+    SequenceIndex* q_WRPIndex = new SequenceIndex();
+
+    /**
+     * @brief Timeouts of the Q_WSP and Q_WRP sequences, ordered by the next to expire
+     *
+     */
+    LM_MinHeap<sequencePacketConfig, 2 * LM_MAX_SEQUENCES>* sequenceTimeouts = new LM_MinHeap<sequencePacketConfig, 2 * LM_MAX_SEQUENCES>();
+
     /**
      * @brief Max time on air for a given configuration in ms
      *
@@ -974,11 +1631,12 @@ private:
     uint32_t maxTimeOnAir = 0;
 
     /**
-     * @brief Wait before sending function
+     * @brief Listen before talk. Wait a binary exponential backoff and scan the channel until it is free
+     * or LM_CSMA_MAX_ATTEMPTS is reached
      *
-     * @param repeatedDetectPreambles Number of repeated detected preambles
+     * @param timeOnAir Time on air of the packet to be sent in ms, used as the backoff slot
      */
-    void waitBeforeSend(uint8_t repeatedDetectPreambles);
+    void waitBeforeSend(uint32_t timeOnAir);
 
     /**
      * @brief Max propagation time for a given configuration in ms
@@ -986,14 +1644,6 @@ private:
      */
     uint32_t getMaxPropagationTime();
 
-    /**
-     * @brief Get the Propagation Time With Random ms
-     * @param multiplayer Multiplayer of the random
-     *
-     * @return uint32_t Propagation time with random
-     */
-    uint32_t getPropagationTimeWithRandom(uint8_t multiplayer);
-
     /**
      * @brief Max Time on air for a given configuration, Used for time slots
      *
@@ -1070,12 +1720,16 @@ public:
     bool hasActiveReceivedConnections() { return q_WRP->getLength() > 0; }
 
     /**
-     * @brief Returns if there are active connections, Q_WRP or Q_WSP or Queue ToSendPackets or Queue ReceivedPackets greater than 0
+     * @brief Returns if there are active connections, Q_WRP or Q_WSP or Queue ToSendPackets or Ring ReceivedFrames greater than 0
      *
      * @return true
      * @return false
      */
-    bool hasActiveConnections() { return hasActiveReceivedConnections() || hasActiveSentConnections() || ToSendPackets->getLength() > 0 || ReceivedPackets->getLength() > 0; };
+    bool hasActiveConnections() {
+        // The received frames ring is created by begin()
+        return hasActiveReceivedConnections() || hasActiveSentConnections() || ToSendPackets->getLength() > 0 ||
+            (ReceivedFrames != nullptr && ReceivedFrames->getLength() > 0);
+    };
 
     /**
      * @brief Returns the number of packets inside the waiting send packets queue
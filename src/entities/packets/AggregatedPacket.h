@@ -0,0 +1,21 @@
+#ifndef _LORAMESHER_AGGREGATED_PACKET_H
+#define _LORAMESHER_AGGREGATED_PACKET_H
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Data packet inside the payload of an aggregated packet. The aggregated packet has the via,
+ * the type is always DATA_P.
+ *
+ */
+#pragma pack(1)
+class AggregatedPacket {
+public:
+    uint16_t dst = 0;
+    uint16_t src = 0;
+    uint8_t payloadSize = 0;
+    uint8_t payload[];
+};
+#pragma pack()
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "BuildOptions.h"
 
+#include "utilities/PacketPool.hpp"
+
 /**
  * @brief Application packet, it is used to send the packet to the application layer
  *
@@ -51,7 +53,7 @@ public:
      */
     void operator delete(void* p) {
         ESP_LOGV(LM_TAG, "Deleting app packet");
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 };
 
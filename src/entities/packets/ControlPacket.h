@@ -5,6 +5,8 @@
 
 #include "BuildOptions.h"
 
+#include "utilities/PacketPool.hpp"
+
 #pragma pack(1)
 class ControlPacket final: public RouteDataPacket {
 public:
@@ -28,7 +30,7 @@ public:
      */
     void operator delete(void* p) {
         ESP_LOGV(LM_TAG, "Deleting Control packet");
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 };
 #pragma pack()
@@ -5,6 +5,8 @@
 
 #include "BuildOptions.h"
 
+#include "utilities/PacketPool.hpp"
+
 #pragma pack(1)
 class DataPacket final: public RouteDataPacket {
 public:
@@ -17,7 +19,7 @@ public:
      */
     void operator delete(void* p) {
         ESP_LOGV(LM_TAG, "Deleting Data packet");
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 };
 #pragma pack()
@@ -0,0 +1,38 @@
+#ifndef _LORAMESHER_LEGACY_ROUTE_PACKET_H
+#define _LORAMESHER_LEGACY_ROUTE_PACKET_H
+
+#include "PacketHeader.h"
+#include "entities/routingTable/NetworkNode.h"
+
+/**
+ * @brief Route packet of the previous versions, HELLO_P. The whole routing table as it is in memory, without advertisement sequence,
+ * flags or link qualities
+ *
+ */
+#pragma pack(1)
+class LegacyRoutePacket final: public PacketHeader {
+public:
+
+    /**
+     * @brief Node Role
+     *
+     */
+    uint8_t nodeRole = 0;
+
+    /**
+     * @brief Network nodes
+     *
+     */
+    NetworkNode networkNodes[];
+
+    /**
+     * @brief Get the Number of Network Nodes
+     *
+     * @return size_t Number of Network Nodes inside the packet
+     */
+    size_t getNetworkNodesSize() { return (this->packetSize - sizeof(LegacyRoutePacket)) / sizeof(NetworkNode); }
+};
+
+#pragma pack()
+
+#endif
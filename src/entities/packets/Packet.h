@@ -3,6 +3,7 @@
 
 #include "BuildOptions.h"
 #include "PacketHeader.h"
+#include "utilities/PacketPool.hpp"
 
 #pragma pack(1)
 template <typename T>
@@ -18,7 +19,7 @@ public:
      */
     void operator delete(void* p) {
         ESP_LOGV(LM_TAG, "Deleting  packet");
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 
 };
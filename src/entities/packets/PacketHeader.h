@@ -3,6 +3,8 @@
 
 #include "BuildOptions.h"
 
+#include "utilities/PacketPool.hpp"
+
 #pragma pack(1)
 class PacketHeader {
 public:
@@ -20,7 +22,7 @@ public:
      */
     void operator delete(void* p) {
         ESP_LOGV(LM_TAG, "Deleting Header packet");
-        vPortFree(p);
+        LM_PacketPool::getInstance().release(p);
     }
 
 };
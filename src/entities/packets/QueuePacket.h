@@ -3,13 +3,18 @@
 
 #include "BuildOptions.h"
 
+#include "utilities/LinkedQueue.hpp"
+
 template <typename T>
-class QueuePacket {
+class QueuePacket: public LM_IntrusiveListNode<QueuePacket<T>> {
 public:
     uint16_t number = 0;
     uint8_t priority = 0;
     float rssi = 0;
     float snr = 0;
+    unsigned long enqueueTime = 0;
+    //Forwarded packets inside an aggregated packet, its enqueueTime is the oldest of them
+    uint8_t forwardedPackets = 0;
     T* packet;
 };
 
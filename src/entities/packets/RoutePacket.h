@@ -3,6 +3,7 @@
 
 #include "PacketHeader.h"
 #include "entities/routingTable/NetworkNode.h"
+#include "entities/routingTable/LinkQuality.h"
 
 #pragma pack(1)
 class RoutePacket final: public PacketHeader {
@@ -15,17 +16,54 @@ public:
     uint8_t nodeRole = 0;
 
     /**
-     * @brief Network nodes
+     * @brief Sequence number of the route packet, incremented with every route packet of the source.
+     * A gap means that some changes of the routes of the source have been lost
+     *
+     */
+    uint8_t advertisementSeq = 0;
+
+    /**
+     * @brief Route advertisement flags. LM_ROUTE_FULL when the packet is part of an advertisement of the whole routing table,
+     * LM_ROUTE_FULL_FIRST for its first packet, LM_ROUTE_FULL_LAST for its last one and LM_ROUTE_REQUEST_FULL to ask the neighbors
+     * for their whole routing table.
+     * LM_ROUTE_COMPACT when the network nodes are encoded with PacketService::encodeRoutes.
+     * Otherwise the network nodes are only the changes since the previous packet, LM_ROUTE_WITHDRAWN_METRIC for the removed routes
+     *
+     */
+    uint8_t flags = 0;
+
+    /**
+     * @brief Number of link qualities after the network nodes
+     *
+     */
+    uint8_t numberOfLinks = 0;
+
+    /**
+     * @brief Network nodes, only without LM_ROUTE_COMPACT
      *
      */
     NetworkNode networkNodes[];
 
     /**
-     * @brief Get the Number of Network Nodes
+     * @brief Get the length in bytes of the network nodes, encoded or not
+     *
+     * @return size_t Length of the network nodes
+     */
+    size_t getNetworkNodesLength() { return this->packetSize - sizeof(RoutePacket) - numberOfLinks * sizeof(LinkQuality); }
+
+    /**
+     * @brief Get the Number of Network Nodes, only without LM_ROUTE_COMPACT
      *
      * @return size_t Number of Network Nodes inside the packet
      */
-    size_t getNetworkNodesSize() { return (this->packetSize - sizeof(RoutePacket)) / sizeof(NetworkNode); }
+    size_t getNetworkNodesSize() { return getNetworkNodesLength() / sizeof(NetworkNode); }
+
+    /**
+     * @brief Get the Link Qualities, the SNR of the neighbors received by the source of the packet
+     *
+     * @return LinkQuality* Array of numberOfLinks link qualities
+     */
+    LinkQuality* getLinkQualities() { return reinterpret_cast<LinkQuality*>(reinterpret_cast<uint8_t*>(networkNodes) + getNetworkNodesLength()); }
 };
 
 #pragma pack()
@@ -0,0 +1,31 @@
+#ifndef _LORAMESHER_LINK_QUALITY_H
+#define _LORAMESHER_LINK_QUALITY_H
+
+#include <cstdint>
+
+#pragma pack(1)
+
+/**
+ * @brief SNR and delivery ratio of the packets received from a neighbor, sent back to it inside the hello packets
+ *
+ */
+class LinkQuality {
+public:
+    uint16_t address = 0;
+
+    int8_t snr = 0;
+
+    /**
+     * @brief Ratio of the route packets of the neighbor received, 255 when all of them are received
+     *
+     */
+    uint8_t deliveryRatio = UINT8_MAX;
+
+    LinkQuality() {};
+
+    LinkQuality(uint16_t address_, int8_t snr_, uint8_t deliveryRatio_): address(address_), snr(snr_), deliveryRatio(deliveryRatio_) {};
+};
+
+#pragma pack()
+
+#endif
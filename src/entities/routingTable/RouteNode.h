@@ -1,13 +1,44 @@
 #ifndef _LORAMESHER_ROUTE_NODE_H
 #define _LORAMESHER_ROUTE_NODE_H
 
+#include "BuildOptions.h"
+
 #include "NetworkNode.h"
 
+#include "utilities/LinkedQueue.hpp"
+
+#include "utilities/MinHeap.hpp"
+
+/**
+ * @brief Alternative next hop of a route
+ *
+ */
+class RouteAlternative {
+public:
+    /**
+     * @brief Next hop
+     *
+     */
+    uint16_t via = 0;
+
+    /**
+     * @brief Metric of the route through the next hop
+     *
+     */
+    uint8_t metric = 0;
+
+    /**
+     * @brief Timeout of the route through the next hop
+     *
+     */
+    uint32_t timeout = 0;
+};
+
 /**
  * @brief Route Node
  *
  */
-class RouteNode {
+class RouteNode: public LM_IntrusiveListNode<RouteNode>, public LM_HeapNode {
 public:
     /**
      * @brief Network node
@@ -34,11 +65,76 @@ public:
     int8_t receivedSNR = 0;
 
     /**
-     * @brief SNR from sent packets. Only available nodes at 1 hop.
+     * @brief SNR from sent packets, received inside the hello packets of the node. Only available nodes at 1 hop.
      *
      */
     int8_t sentSNR = 0;
 
+    /**
+     * @brief The node has sent back the SNR of our packets
+     *
+     */
+    bool hasSentSNR = false;
+
+    /**
+     * @brief Sequence number of the last route packet received from the node. Only available nodes at 1 hop.
+     *
+     */
+    uint8_t advertisementSeq = 0;
+
+    /**
+     * @brief All the route packets of the node have been received since its last advertisement of the whole routing table.
+     * Only available nodes at 1 hop.
+     *
+     */
+    bool advertisementSynced = false;
+
+    /**
+     * @brief Time in ms when the last advertisement of the whole routing table of the node started. Only available nodes at 1 hop.
+     *
+     */
+    uint32_t fullAdvertisementStart = 0;
+
+    /**
+     * @brief The node sends the route packets of the previous versions, HELLO_P. Only available nodes at 1 hop.
+     *
+     */
+    bool legacy = false;
+
+    /**
+     * @brief A route packet has been received from the node, advertisementSeq is valid. Only available nodes at 1 hop.
+     *
+     */
+    bool hasAdvertisementSeq = false;
+
+    /**
+     * @brief Moving average of the ratio of route packets of the node received, 255 when all of them are received.
+     * Only available nodes at 1 hop.
+     *
+     */
+    uint8_t receivedRatio = UINT8_MAX;
+
+    /**
+     * @brief Ratio of our route packets received by the node, received inside the hello packets of the node.
+     * Only available nodes at 1 hop.
+     *
+     */
+    uint8_t sentRatio = UINT8_MAX;
+
+    static constexpr uint8_t MAX_ALTERNATIVES = LM_MAX_NEXT_HOPS > 1 ? LM_MAX_NEXT_HOPS - 1 : 0;
+
+    /**
+     * @brief Alternative next hops, ordered by metric. They replace the next hop when it times out, it is withdrawn or it is dead
+     *
+     */
+    RouteAlternative alternatives[MAX_ALTERNATIVES > 0 ? MAX_ALTERNATIVES : 1];
+
+    /**
+     * @brief Number of alternative next hops
+     *
+     */
+    uint8_t numberOfAlternatives = 0;
+
     /**
      * @brief SRTT, smoothed round-trip time (RFC 6298)
      *
@@ -51,6 +147,23 @@ public:
      */
     unsigned long RTTVAR = 0;
 
+    /**
+     * @brief Get the key of the route inside the route timeouts heap, the first timeout of its next hops
+     *
+     * @return uint32_t timeout
+     */
+    uint32_t getHeapKey() const {
+        uint32_t key = timeout;
+        for (uint8_t i = 0; i < numberOfAlternatives; i++) {
+            if (alternatives[i].timeout < key)
+                key = alternatives[i].timeout;
+        }
+
+        return key;
+    }
+
+    RouteNode() {};
+
     /**
      * @brief Construct a new Route Node object
      *
@@ -0,0 +1,80 @@
+#ifndef _LORAMESHER_ROUTING_TABLE_SNAPSHOT_H
+#define _LORAMESHER_ROUTING_TABLE_SNAPSHOT_H
+
+#include <atomic>
+
+#include "NetworkNode.h"
+
+#include "RouteNode.h"
+
+/**
+ * @brief Immutable copy of the routing table at a given version. It is shared between the readers
+ * with a reference count, release it after using it.
+ *
+ */
+class RoutingTableSnapshot {
+public:
+    /**
+     * @brief Version of the routing table when the snapshot was created
+     *
+     */
+    const uint32_t version;
+
+    /**
+     * @brief Number of nodes inside the snapshot
+     *
+     */
+    const size_t numberOfNodes;
+
+    /**
+     * @brief Route nodes. The timeout and the SNR of the route nodes do not change the version of the routing table,
+     * they could be outdated.
+     *
+     */
+    RouteNode* const routeNodes;
+
+    /**
+     * @brief Network nodes, in the same order than the route nodes
+     *
+     */
+    NetworkNode* const networkNodes;
+
+    /**
+     * @brief Construct a new Routing Table Snapshot object
+     *
+     * @param version_ Version of the routing table
+     * @param numberOfNodes_ Number of nodes
+     */
+    RoutingTableSnapshot(uint32_t version_, size_t numberOfNodes_):
+        version(version_),
+        numberOfNodes(numberOfNodes_),
+        routeNodes(numberOfNodes_ > 0 ? new RouteNode[numberOfNodes_] : nullptr),
+        networkNodes(numberOfNodes_ > 0 ? new NetworkNode[numberOfNodes_] : nullptr) {};
+
+    /**
+     * @brief Add a reference to the snapshot
+     *
+     */
+    void acquire() {
+        refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Release a reference to the snapshot, it is deleted with the last reference
+     *
+     */
+    void release() {
+        if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+private:
+    std::atomic<uint32_t> refCount{1};
+
+    ~RoutingTableSnapshot() {
+        delete[] routeNodes;
+        delete[] networkNodes;
+    }
+};
+
+#endif
@@ -62,6 +62,14 @@ int16_t LM_SX1276::transmit(uint8_t* buffer, size_t length) {
     return module->transmit(buffer, length);
 }
 
+int16_t LM_SX1276::startTransmit(uint8_t* buffer, size_t length) {
+    return module->startTransmit(buffer, length);
+}
+
+int16_t LM_SX1276::finishTransmit() {
+    return module->finishTransmit();
+}
+
 uint32_t LM_SX1276::getTimeOnAir(size_t length) {
     return module->getTimeOnAir(length);
 }
@@ -82,6 +90,10 @@ void LM_SX1276::setDioActionForScanningTimeout(void(*action)()) {
     module->setDio0Action(action, RISING);
 }
 
+void LM_SX1276::setDioActionForTransmitDone(void (*action)()) {
+    module->setPacketSentAction(action);
+}
+
 void LM_SX1276::clearDioActions() {
     module->clearDio0Action();
     module->clearDio1Action();
@@ -62,6 +62,14 @@ int16_t LM_SX1280::transmit(uint8_t* buffer, size_t length) {
     return module->transmit(buffer, length);
 }
 
+int16_t LM_SX1280::startTransmit(uint8_t* buffer, size_t length) {
+    return module->startTransmit(buffer, length);
+}
+
+int16_t LM_SX1280::finishTransmit() {
+    return module->finishTransmit();
+}
+
 uint32_t LM_SX1280::getTimeOnAir(size_t length) {
     return module->getTimeOnAir(length);
 }
@@ -84,6 +92,10 @@ void LM_SX1280::setDioActionForScanningTimeout(void(*action)()) {
     // module->setDio0Action(action, RISING);
 }
 
+void LM_SX1280::setDioActionForTransmitDone(void (*action)()) {
+    module->setPacketSentAction(action);
+}
+
 void LM_SX1280::clearDioActions() {
     module->clearDio1Action();
 }
@@ -3,6 +3,8 @@
 
 #include "entities/packets/Packet.h"
 
+#include "utilities/PacketPool.hpp"
+
 class PacketFactory {
 public:
 
@@ -39,7 +41,7 @@ public:
 
         ESP_LOGV(LM_TAG, "Creating packet with %d bytes", packetSize);
 
-        T* p = static_cast<T*>(pvPortMalloc(packetSize));
+        T* p = static_cast<T*>(LM_PacketPool::getInstance().allocate(packetSize));
 
         if (p) {
             //Copy the payload into the packet
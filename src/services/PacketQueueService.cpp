@@ -1,19 +1,9 @@
 #include "PacketQueueService.h"
 
-void PacketQueueService::addOrdered(LM_LinkedList<QueuePacket<Packet<uint8_t>>>* list, QueuePacket<Packet<uint8_t>>* qp) {
-    list->setInUse();
-    if (list->moveToStart()) {
-        do {
-            QueuePacket<Packet<uint8_t>>* current = list->getCurrent();
-            if (current->priority < qp->priority) {
-                list->addCurrent(qp);
-                list->releaseInUse();
-                return;
-            }
-        } while (list->next());
-    }
+void PacketQueueService::addOrdered(LM_PriorityQueue<QueuePacket<Packet<uint8_t>>>* queue, QueuePacket<Packet<uint8_t>>* qp) {
+    queue->setInUse();
 
-    list->Append(qp);
+    queue->Push(qp);
 
-    list->releaseInUse();
+    queue->releaseInUse();
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 
 #include "utilities/LinkedQueue.hpp"
 
+#include "utilities/PriorityQueue.hpp"
+
 #include "BuildOptions.h"
 
 class PacketQueueService {
@@ -43,33 +45,28 @@ public:
      * @return QueuePacket<T>* QueueElement inside the list
      */
     template<class T>
-    static QueuePacket<T>* findPacketQueue(LM_LinkedList<QueuePacket<T>>* queue, uint8_t num) {
-        queue->setInUse();
-
-        if (queue->moveToStart()) {
-            do {
-                QueuePacket<T>* current = queue->getCurrent();
-
-                if (current->number == num) {
-                    queue->releaseInUse();
-                    return current;
-                }
-
-            } while (queue->next());
+    static QueuePacket<T>* findPacketQueue(LM_LinkedList<QueuePacket<T>>* queue, uint16_t num) {
+        queue->setInRead();
+
+        for (QueuePacket<T>& current : *queue) {
+            if (current.number == num) {
+                queue->releaseInRead();
+                return &current;
+            }
         }
 
-        queue->releaseInUse();
+        queue->releaseInRead();
 
         return nullptr;
     }
 
     /**
-     * @brief Add the Queue packet into the list ordered
+     * @brief Add the Queue packet into the priority queue, ordered by its priority
      *
-     * @param list Linked list to add the QueuePacket
+     * @param queue Priority queue to add the QueuePacket
      * @param qp Queue packet to be added
      */
-    static void addOrdered(LM_LinkedList<QueuePacket<Packet<uint8_t>>>* list, QueuePacket<Packet<uint8_t>>* qp);
+    static void addOrdered(LM_PriorityQueue<QueuePacket<Packet<uint8_t>>>* queue, QueuePacket<Packet<uint8_t>>* qp);
 
     /**
      * @brief It will delete the packet queue and the packet inside it
@@ -78,7 +75,7 @@ public:
      */
     static void deleteQueuePacketAndPacket(QueuePacket<Packet<uint8_t>>* pq) {
         ESP_LOGI(LM_TAG, "Deleting packet");
-        vPortFree(pq->packet);
+        LM_PacketPool::getInstance().release(pq->packet);
 
         ESP_LOGI(LM_TAG, "Deleting packet queue");
         delete pq;
@@ -7,7 +7,7 @@ Packet<uint8_t>* PacketService::createEmptyPacket(size_t packetSize) {
         packetSize = maxPacketSize;
     }
 
-    Packet<uint8_t>* p = static_cast<Packet<uint8_t>*>(pvPortMalloc(packetSize));
+    Packet<uint8_t>* p = static_cast<Packet<uint8_t>*>(LM_PacketPool::getInstance().allocate(packetSize));
 
     ESP_LOGI(LM_TAG, "Packet created with %d bytes", packetSize);
 
@@ -25,7 +25,7 @@ AppPacket<uint8_t>* PacketService::convertPacket(DataPacket* p) {
 AppPacket<uint8_t>* PacketService::createAppPacket(uint16_t dst, uint16_t src, uint8_t* payload, uint32_t payloadSize) {
     int packetLength = sizeof(AppPacket<uint8_t>) + payloadSize;
 
-    AppPacket<uint8_t>* p = static_cast<AppPacket<uint8_t>*>(pvPortMalloc(packetLength));
+    AppPacket<uint8_t>* p = static_cast<AppPacket<uint8_t>*>(LM_PacketPool::getInstance().allocate(packetLength));
 
     if (p) {
         //Copy the payload into the packet
@@ -52,10 +52,14 @@ bool PacketService::isOnlyDataPacket(uint8_t type) {
 }
 
 bool PacketService::isControlPacket(uint8_t type) {
-    return !(isHelloPacket(type) || isOnlyDataPacket(type));
+    return !(isHelloPacket(type) || isOnlyDataPacket(type) || isAggregatedPacket(type));
 }
 
 bool PacketService::isHelloPacket(uint8_t type) {
+    return isLegacyHelloPacket(type) || type == ROUTING_P;
+}
+
+bool PacketService::isLegacyHelloPacket(uint8_t type) {
     return (type & HELLO_P) == HELLO_P;
 }
 
@@ -83,6 +87,10 @@ bool PacketService::isDataControlPacket(uint8_t type) {
     return (isHelloPacket(type) || isAckPacket(type) || isLostPacket(type) || isLostPacket(type));
 }
 
+bool PacketService::isAggregatedPacket(uint8_t type) {
+    return (type & AGGREGATED_P) == AGGREGATED_P;
+}
+
 uint8_t PacketService::getHeaderLength(uint8_t type) {
     if (isControlPacket(type))
         return sizeof(ControlPacket);
@@ -93,19 +101,190 @@ uint8_t PacketService::getHeaderLength(uint8_t type) {
     return 0;
 }
 
-RoutePacket* PacketService::createRoutingPacket(uint16_t localAddress, NetworkNode* nodes, size_t numOfNodes, uint8_t nodeRole) {
+RoutePacket* PacketService::createRoutingPacket(uint16_t localAddress, uint8_t* nodes, size_t nodesLength, uint8_t nodeRole,
+    uint8_t advertisementSeq, uint8_t flags, LinkQuality* links, size_t numOfLinks) {
+    size_t linksSizeInBytes = numOfLinks * sizeof(LinkQuality);
+
+    //The link qualities go after the network nodes, only if they fit inside the packet
+    if (sizeof(RoutePacket) + nodesLength + linksSizeInBytes > PacketFactory::getMaxPacketSize()) {
+        numOfLinks = 0;
+        linksSizeInBytes = 0;
+    }
+
+    RoutePacket* routePacket = reinterpret_cast<RoutePacket*>(createEmptyPacket(sizeof(RoutePacket) + nodesLength + linksSizeInBytes));
+    if (routePacket == nullptr)
+        return nullptr;
+
+    routePacket->dst = BROADCAST_ADDR;
+    routePacket->src = localAddress;
+    routePacket->type = ROUTING_P;
+    routePacket->packetSize = sizeof(RoutePacket) + nodesLength + linksSizeInBytes;
+    routePacket->nodeRole = nodeRole;
+    routePacket->advertisementSeq = advertisementSeq;
+    routePacket->flags = flags;
+    routePacket->numberOfLinks = numOfLinks;
+
+    if (nodesLength > 0)
+        memcpy(routePacket->networkNodes, nodes, nodesLength);
+    if (linksSizeInBytes > 0)
+        memcpy(routePacket->getLinkQualities(), links, linksSizeInBytes);
+
+    return routePacket;
+}
+
+LegacyRoutePacket* PacketService::createLegacyRoutingPacket(uint16_t localAddress, NetworkNode* nodes, size_t numOfNodes, uint8_t nodeRole) {
     size_t routingSizeInBytes = numOfNodes * sizeof(NetworkNode);
 
-    RoutePacket* routePacket = PacketFactory::createPacket<RoutePacket>(reinterpret_cast<uint8_t*>(nodes), routingSizeInBytes);
+    LegacyRoutePacket* routePacket = reinterpret_cast<LegacyRoutePacket*>(createEmptyPacket(sizeof(LegacyRoutePacket) + routingSizeInBytes));
+    if (routePacket == nullptr)
+        return nullptr;
+
     routePacket->dst = BROADCAST_ADDR;
     routePacket->src = localAddress;
     routePacket->type = HELLO_P;
-    routePacket->packetSize = routingSizeInBytes + sizeof(RoutePacket);
+    routePacket->packetSize = sizeof(LegacyRoutePacket) + routingSizeInBytes;
     routePacket->nodeRole = nodeRole;
 
+    if (routingSizeInBytes > 0)
+        memcpy(routePacket->networkNodes, nodes, routingSizeInBytes);
+
     return routePacket;
 }
 
+size_t PacketService::encodeRoutes(NetworkNode* nodes, size_t numOfNodes, uint8_t* buffer, size_t maxLength, size_t& length) {
+    uint8_t encoded[MAX_ENCODED_ROUTE_LENGTH - 1];
+    uint16_t previous = 0;
+    size_t numOfEncoded = 0;
+    length = 0;
+
+    while (numOfEncoded < numOfNodes) {
+        //Metric nibbles of the pair
+        uint8_t nibbles[2] = {0xF, 0xF};
+        size_t encodedLength = encodeRoute(&nodes[numOfEncoded], previous, encoded, nibbles[0]);
+        if (length + 1 + encodedLength > maxLength)
+            break;
+
+        size_t nibblesPosition = length++;
+        memcpy(buffer + length, encoded, encodedLength);
+        length += encodedLength;
+        previous = nodes[numOfEncoded++].address;
+
+        //The second node of the pair is decoded only if there are bytes left, the encoding ends without it
+        if (numOfEncoded < numOfNodes) {
+            encodedLength = encodeRoute(&nodes[numOfEncoded], previous, encoded, nibbles[1]);
+            if (length + encodedLength > maxLength) {
+                buffer[nibblesPosition] = nibbles[0] | 0xF0;
+                break;
+            }
+
+            memcpy(buffer + length, encoded, encodedLength);
+            length += encodedLength;
+            previous = nodes[numOfEncoded++].address;
+        }
+
+        buffer[nibblesPosition] = nibbles[0] | (nibbles[1] << 4);
+    }
+
+    return numOfEncoded;
+}
+
+NetworkNode* PacketService::decodeRoutes(uint8_t* buffer, size_t length, size_t& numOfNodes) {
+    NetworkNode node;
+    numOfNodes = 0;
+
+    //Count the nodes, validating the encoding
+    for (size_t position = 0; position < length;) {
+        uint8_t nibbles = buffer[position++];
+        for (uint8_t i = 0; i < 2 && (i == 0 || position < length); i++) {
+            if (!decodeRoute(buffer, length, position, (nibbles >> (i * 4)) & 0xF, node.address, node)) {
+                ESP_LOGW(LM_TAG, "Wrong encoding of the routes");
+                numOfNodes = 0;
+                return nullptr;
+            }
+
+            numOfNodes++;
+        }
+    }
+
+    if (numOfNodes == 0)
+        return nullptr;
+
+    NetworkNode* nodes = new NetworkNode[numOfNodes];
+    uint16_t previous = 0;
+    size_t index = 0;
+
+    for (size_t position = 0; position < length;) {
+        uint8_t nibbles = buffer[position++];
+        for (uint8_t i = 0; i < 2 && (i == 0 || position < length); i++) {
+            decodeRoute(buffer, length, position, (nibbles >> (i * 4)) & 0xF, previous, nodes[index]);
+            previous = nodes[index++].address;
+        }
+    }
+
+    return nodes;
+}
+
+size_t PacketService::encodeRoute(NetworkNode* node, uint16_t previous, uint8_t* buffer, uint8_t& nibble) {
+    size_t position = 0;
+    bool hasRole = node->role != ROLE_DEFAULT;
+
+    // Varint, 7 bits for each byte
+    uint32_t value = ((uint32_t) (uint16_t) (node->address - previous) << 1) | hasRole;
+    while (value >= 0x80) {
+        buffer[position++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[position++] = value;
+
+    if (hasRole)
+        buffer[position++] = node->role;
+
+    if (node->metric < 0xF)
+        nibble = node->metric;
+    else {
+        nibble = 0xF;
+        buffer[position++] = node->metric;
+    }
+
+    return position;
+}
+
+bool PacketService::decodeRoute(uint8_t* buffer, size_t length, size_t& position, uint8_t nibble, uint16_t previous, NetworkNode& node) {
+    // Varint, 7 bits for each byte
+    uint32_t value = 0;
+    for (uint8_t shift = 0; ; shift += 7) {
+        if (position >= length || shift > 14)
+            return false;
+
+        uint8_t byte = buffer[position++];
+        value |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+
+    if (value > 0x1FFFF)
+        return false;
+
+    node.address = previous + (value >> 1);
+    node.role = ROLE_DEFAULT;
+
+    if (value & 1) {
+        if (position >= length)
+            return false;
+        node.role = buffer[position++];
+    }
+
+    if (nibble < 0xF)
+        node.metric = nibble;
+    else {
+        if (position >= length)
+            return false;
+        node.metric = buffer[position++];
+    }
+
+    return true;
+}
+
 DataPacket* PacketService::dataPacket(Packet<uint8_t>* p) {
     return reinterpret_cast<DataPacket*>(p);
 }
@@ -146,6 +325,41 @@ DataPacket* PacketService::createDataPacket(uint16_t dst, uint16_t src, uint8_t
     return packet;
 }
 
+DataPacket* PacketService::createAggregatedPacket(uint16_t via, uint16_t src, DataPacket** packets, size_t numPackets) {
+    size_t payloadSize = 0;
+    for (size_t i = 0; i < numPackets; i++)
+        payloadSize += getAggregatedLength(packets[i]);
+
+    if (sizeof(DataPacket) + payloadSize > PacketFactory::getMaxPacketSize()) {
+        ESP_LOGE(LM_TAG, "Aggregated packet greater than %u bytes", (unsigned) PacketFactory::getMaxPacketSize());
+        return nullptr;
+    }
+
+    DataPacket* packet = reinterpret_cast<DataPacket*>(createEmptyPacket(sizeof(DataPacket) + payloadSize));
+    if (packet == nullptr)
+        return nullptr;
+
+    packet->dst = via;
+    packet->src = src;
+    packet->type = AGGREGATED_P;
+    packet->id = 0;
+    packet->via = via;
+    packet->packetSize = sizeof(DataPacket) + payloadSize;
+
+    uint8_t* position = packet->payload;
+    for (size_t i = 0; i < numPackets; i++) {
+        AggregatedPacket* aggregated = reinterpret_cast<AggregatedPacket*>(position);
+        aggregated->dst = packets[i]->dst;
+        aggregated->src = packets[i]->src;
+        aggregated->payloadSize = getPacketPayloadLength(packets[i]);
+        memcpy(aggregated->payload, packets[i]->payload, aggregated->payloadSize);
+
+        position += sizeof(AggregatedPacket) + aggregated->payloadSize;
+    }
+
+    return packet;
+}
+
 size_t PacketService::getPacketPayloadLength(Packet<uint8_t>* p) {
     return p->packetSize - getHeaderLength(p);
 }
@@ -187,4 +401,273 @@ ControlPacket* PacketService::getPacketHeader(Packet<uint8_t>* p) {
 
     memcpy(reinterpret_cast<void*>(ctrlPacket), reinterpret_cast<void*>(p), sizeof(PacketHeader));
     return ctrlPacket;
-}
\ No newline at end of file
+}
+// Types with a code inside the compact header, the index is the code
+static const uint8_t compactTypes[] = {
+    DATA_P, ROUTING_P, ACK_P, LOST_P, NEED_ACK_P | XL_DATA_P, SYNC_P | NEED_ACK_P | XL_DATA_P, AGGREGATED_P};
+
+#define LM_COMPACT_RAW_TYPE 0x0F
+#define LM_COMPACT_BROADCAST 0x20
+#define LM_COMPACT_VIA_IS_DST 0x10
+
+uint8_t PacketService::getMemoryHeaderLength(uint8_t type) {
+    uint8_t headerLength = getHeaderLength(type);
+    return headerLength == 0 ? sizeof(PacketHeader) : headerLength;
+}
+
+uint8_t PacketService::getCompactTypeCode(uint8_t type) {
+    for (uint8_t code = 0; code < sizeof(compactTypes); code++) {
+        if (compactTypes[code] == type)
+            return code;
+    }
+
+    return LM_COMPACT_RAW_TYPE;
+}
+
+uint8_t PacketService::getCompactFlags(Packet<uint8_t>* p) {
+    if (p->dst == BROADCAST_ADDR)
+        return LM_COMPACT_BROADCAST;
+
+    if (isDataPacket(p->type) && reinterpret_cast<DataPacket*>(p)->via == p->dst)
+        return LM_COMPACT_VIA_IS_DST;
+
+    return 0;
+}
+
+size_t PacketService::getCompactHeaderLength(Packet<uint8_t>* p) {
+    uint8_t flags = getCompactFlags(p);
+
+    size_t length = 1 + sizeof(p->src);
+
+    if (getCompactTypeCode(p->type) == LM_COMPACT_RAW_TYPE)
+        length++;
+
+    if (!(flags & LM_COMPACT_BROADCAST)) {
+        length += sizeof(p->dst);
+
+        if (isDataPacket(p->type) && !(flags & LM_COMPACT_VIA_IS_DST))
+            length += sizeof(DataPacket::via);
+    }
+
+    if (isControlPacket(p->type)) {
+        uint16_t number = reinterpret_cast<ControlPacket*>(p)->number;
+        length += 1 + (number < 0x80 ? 1 : number < 0x4000 ? 2 : 3);
+    }
+
+    return length;
+}
+
+size_t PacketService::getFrameLength(Packet<uint8_t>* p) {
+#ifdef LM_COMPACT_HEADER
+    return getCompactHeaderLength(p) + p->packetSize - getMemoryHeaderLength(p->type);
+#else
+    return p->packetSize;
+#endif
+}
+
+size_t PacketService::getMaxRouteLength() {
+#ifdef LM_COMPACT_ROUTES
+    return MAX_ENCODED_ROUTE_LENGTH;
+#else
+    return sizeof(NetworkNode);
+#endif
+}
+
+size_t PacketService::getMinPacketSize() {
+    return sizeof(RoutePacket) + getMaxRouteLength() + sizeof(LinkQuality);
+}
+
+size_t PacketService::encodeCompactPacket(Packet<uint8_t>* p, uint8_t* frame) {
+    uint8_t type = p->type;
+    uint8_t code = getCompactTypeCode(type);
+    uint8_t flags = getCompactFlags(p);
+    size_t position = 0;
+
+    frame[position++] = (LM_COMPACT_HEADER_VERSION << 6) | flags | code;
+
+    if (code == LM_COMPACT_RAW_TYPE)
+        frame[position++] = type;
+
+    if (!(flags & LM_COMPACT_BROADCAST)) {
+        frame[position++] = p->dst & 0xFF;
+        frame[position++] = p->dst >> 8;
+    }
+
+    frame[position++] = p->src & 0xFF;
+    frame[position++] = p->src >> 8;
+
+    if (isDataPacket(type) && !(flags & (LM_COMPACT_BROADCAST | LM_COMPACT_VIA_IS_DST))) {
+        uint16_t via = reinterpret_cast<DataPacket*>(p)->via;
+        frame[position++] = via & 0xFF;
+        frame[position++] = via >> 8;
+    }
+
+    if (isControlPacket(type)) {
+        ControlPacket* cPacket = reinterpret_cast<ControlPacket*>(p);
+        frame[position++] = cPacket->seq_id;
+
+        // Varint, 7 bits for each byte
+        uint16_t number = cPacket->number;
+        while (number >= 0x80) {
+            frame[position++] = (number & 0x7F) | 0x80;
+            number >>= 7;
+        }
+        frame[position++] = number;
+    }
+
+    uint8_t headerLength = getMemoryHeaderLength(type);
+    size_t payloadLength = p->packetSize - headerLength;
+    memcpy(frame + position, reinterpret_cast<uint8_t*>(p) + headerLength, payloadLength);
+
+    return position + payloadLength;
+}
+
+Packet<uint8_t>* PacketService::decodeCompactPacket(uint8_t* frame, size_t frameLength) {
+    size_t position = 0;
+
+    if (frameLength == 0)
+        return nullptr;
+
+    uint8_t first = frame[position++];
+    uint8_t version = first >> 6;
+    uint8_t flags = first & (LM_COMPACT_BROADCAST | LM_COMPACT_VIA_IS_DST);
+    uint8_t code = first & 0x0F;
+
+    if (version != LM_COMPACT_HEADER_VERSION) {
+        ESP_LOGW(LM_TAG, "Compact header version %d not supported", version);
+        return nullptr;
+    }
+
+    uint8_t type;
+    if (code == LM_COMPACT_RAW_TYPE) {
+        if (position >= frameLength)
+            return nullptr;
+        type = frame[position++];
+    }
+    else if (code < sizeof(compactTypes))
+        type = compactTypes[code];
+    else {
+        ESP_LOGW(LM_TAG, "Compact header type code %d not supported", code);
+        return nullptr;
+    }
+
+    bool broadcast = flags & LM_COMPACT_BROADCAST;
+    bool hasVia = isDataPacket(type);
+    bool hasControl = isControlPacket(type);
+
+    size_t fixedLength = (broadcast ? 0 : 2) + 2 + (hasVia && !broadcast && !(flags & LM_COMPACT_VIA_IS_DST) ? 2 : 0) + (hasControl ? 2 : 0);
+    if (position + fixedLength > frameLength) {
+        ESP_LOGW(LM_TAG, "Compact header longer than the frame");
+        return nullptr;
+    }
+
+    uint16_t dst = BROADCAST_ADDR;
+    if (!broadcast) {
+        dst = frame[position] | (frame[position + 1] << 8);
+        position += 2;
+    }
+
+    uint16_t src = frame[position] | (frame[position + 1] << 8);
+    position += 2;
+
+    uint16_t via = 0;
+    if (hasVia && !broadcast) {
+        if (flags & LM_COMPACT_VIA_IS_DST)
+            via = dst;
+        else {
+            via = frame[position] | (frame[position + 1] << 8);
+            position += 2;
+        }
+    }
+
+    uint8_t seq_id = 0;
+    uint16_t number = 0;
+    if (hasControl) {
+        seq_id = frame[position++];
+
+        // Varint, 7 bits for each byte
+        for (uint8_t shift = 0; ; shift += 7) {
+            if (position >= frameLength || shift > 14) {
+                ESP_LOGW(LM_TAG, "Wrong number in the compact header");
+                return nullptr;
+            }
+
+            uint8_t byte = frame[position++];
+            number |= (byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+    }
+
+    uint8_t headerLength = getMemoryHeaderLength(type);
+    size_t payloadLength = frameLength - position;
+    size_t packetSize = headerLength + payloadLength;
+
+    if (packetSize > PacketFactory::getMaxPacketSize()) {
+        ESP_LOGW(LM_TAG, "Decoded packet greater than %u bytes", (unsigned) PacketFactory::getMaxPacketSize());
+        return nullptr;
+    }
+
+    Packet<uint8_t>* p = createEmptyPacket(packetSize);
+    if (p == nullptr)
+        return nullptr;
+
+    p->dst = dst;
+    p->src = src;
+    p->type = type;
+    p->id = 0;
+    p->packetSize = packetSize;
+
+    if (hasVia)
+        reinterpret_cast<DataPacket*>(p)->via = via;
+
+    if (hasControl) {
+        reinterpret_cast<ControlPacket*>(p)->seq_id = seq_id;
+        reinterpret_cast<ControlPacket*>(p)->number = number;
+    }
+
+    memcpy(reinterpret_cast<uint8_t*>(p) + headerLength, frame + position, payloadLength);
+
+    return p;
+}
+
+bool PacketService::isTransitFrame(uint8_t* frame, size_t frameLength, uint16_t localAddress) {
+    uint8_t type;
+    uint16_t dst, via;
+
+#ifdef LM_COMPACT_HEADER
+    size_t position = 0;
+
+    if (frameLength == 0 || (frame[0] >> 6) != LM_COMPACT_HEADER_VERSION || (frame[0] & LM_COMPACT_BROADCAST))
+        return false;
+
+    uint8_t code = frame[position++] & 0x0F;
+    if (code == LM_COMPACT_RAW_TYPE) {
+        if (position >= frameLength)
+            return false;
+        type = frame[position++];
+    }
+    else if (code < sizeof(compactTypes))
+        type = compactTypes[code];
+    else
+        return false;
+
+    // Destination, source and via. When the via is the destination, the packet is not in transit
+    if ((frame[0] & LM_COMPACT_VIA_IS_DST) || position + 6 > frameLength)
+        return false;
+
+    dst = frame[position] | (frame[position + 1] << 8);
+    via = frame[position + 4] | (frame[position + 5] << 8);
+#else
+    if (frameLength < sizeof(DataPacket))
+        return false;
+
+    DataPacket* p = reinterpret_cast<DataPacket*>(frame);
+    type = p->type;
+    dst = p->dst;
+    via = p->via;
+#endif
+
+    return isDataPacket(type) && !isAggregatedPacket(type) &&
+        dst != BROADCAST_ADDR && dst != localAddress && via == localAddress;
+}
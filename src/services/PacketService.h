@@ -4,8 +4,10 @@
 #include "entities/packets/Packet.h"
 #include "entities/packets/ControlPacket.h"
 #include "entities/packets/DataPacket.h"
+#include "entities/packets/AggregatedPacket.h"
 #include "entities/packets/AppPacket.h"
 #include "entities/packets/RoutePacket.h"
+#include "entities/packets/LegacyRoutePacket.h"
 #include "services/RoleService.h"
 #include "BuildOptions.h"
 #include "PacketFactory.h"
@@ -65,6 +67,25 @@ public:
      */
     static DataPacket* createDataPacket(uint16_t dst, uint16_t src, uint8_t type, uint8_t* payload, uint8_t payloadSize);
 
+    /**
+     * @brief Create an Aggregated Packet with the data packets inside the payload
+     *
+     * @param via Next hop of all the data packets
+     * @param src Source address
+     * @param packets Data packets to be aggregated, they are not deleted
+     * @param numPackets Number of data packets
+     * @return DataPacket*
+     */
+    static DataPacket* createAggregatedPacket(uint16_t via, uint16_t src, DataPacket** packets, size_t numPackets);
+
+    /**
+     * @brief Get the length of a data packet inside an aggregated packet
+     *
+     * @param p Data packet
+     * @return size_t Length in bytes
+     */
+    static size_t getAggregatedLength(DataPacket* p) { return sizeof(AggregatedPacket) + getPacketPayloadLength(p); }
+
     /**
      * @brief Create an Empty Packet
      *
@@ -83,7 +104,7 @@ public:
      */
     template<class T>
     static Packet<uint8_t>* copyPacket(T* p, size_t packetLength) {
-        Packet<uint8_t>* cpPacket = static_cast<Packet<uint8_t>*>(pvPortMalloc(packetLength));
+        Packet<uint8_t>* cpPacket = static_cast<Packet<uint8_t>*>(LM_PacketPool::getInstance().allocate(packetLength));
 
         if (cpPacket) {
             memcpy(reinterpret_cast<void*>(cpPacket), reinterpret_cast<void*>(p), packetLength);
@@ -100,12 +121,61 @@ public:
      * @brief Create a Routing Packet object
      *
      * @param localAddress localAddress of the node
-     * @param nodes list of NetworkNodes
-     * @param numOfNodes Number of nodes
+     * @param nodes NetworkNodes, as they are in memory or encoded with encodeRoutes
+     * @param nodesLength Length of the network nodes in bytes
      * @param nodeRole Role of the node
+     * @param advertisementSeq Sequence number of the route packet
+     * @param flags Route advertisement flags
+     * @param links list of LinkQualities of the neighbors
+     * @param numOfLinks Number of link qualities
      * @return RoutePacket*
      */
-    static RoutePacket* createRoutingPacket(uint16_t localAddress, NetworkNode* nodes, size_t numOfNodes, uint8_t nodeRole);
+    static RoutePacket* createRoutingPacket(uint16_t localAddress, uint8_t* nodes, size_t nodesLength, uint8_t nodeRole,
+        uint8_t advertisementSeq, uint8_t flags, LinkQuality* links = nullptr, size_t numOfLinks = 0);
+
+    /**
+     * @brief Create a Routing Packet of the previous versions, HELLO_P
+     *
+     * @param localAddress localAddress of the node
+     * @param nodes NetworkNodes
+     * @param numOfNodes Number of network nodes
+     * @param nodeRole Role of the node
+     * @return LegacyRoutePacket*
+     */
+    static LegacyRoutePacket* createLegacyRoutingPacket(uint16_t localAddress, NetworkNode* nodes, size_t numOfNodes, uint8_t nodeRole);
+
+    /**
+     * @brief Encode the network nodes of a route packet, as many as fit inside the buffer.
+     * Every pair of nodes starts with a byte with their metrics in nibbles, 0xF when the metric is greater than 14.
+     * Then every node has a varint, 7 bits for each byte, with the address delta to the previous node and the role flag in the lowest bit,
+     * the role if the flag is set and the metric if it did not fit inside the nibble.
+     * Sort the nodes by address to get the shortest deltas.
+     *
+     * @param nodes Network nodes
+     * @param numOfNodes Number of network nodes
+     * @param buffer Buffer where the nodes are encoded
+     * @param maxLength Length of the buffer
+     * @param length Length of the encoded nodes in bytes
+     * @return size_t Number of nodes encoded
+     */
+    static size_t encodeRoutes(NetworkNode* nodes, size_t numOfNodes, uint8_t* buffer, size_t maxLength, size_t& length);
+
+    /**
+     * @brief Maximum length of a node encoded with encodeRoutes, including the byte with the metrics of the pair.
+     * 3 bytes of varint, the role and the metric
+     *
+     */
+    static constexpr size_t MAX_ENCODED_ROUTE_LENGTH = 6;
+
+    /**
+     * @brief Decode the network nodes encoded with encodeRoutes
+     *
+     * @param buffer Encoded nodes
+     * @param length Length of the encoded nodes in bytes
+     * @param numOfNodes Number of network nodes decoded
+     * @return NetworkNode* Network nodes, delete it after using it. nullptr if there are no nodes or the encoding is not valid
+     */
+    static NetworkNode* decodeRoutes(uint8_t* buffer, size_t length, size_t& numOfNodes);
 
     /**
      * @brief Create a Application Packet
@@ -219,7 +289,7 @@ public:
     static bool isControlPacket(uint8_t type);
 
     /**
-     * @brief Given a type returns if is a hello packet
+     * @brief Given a type returns if is a hello packet, a route packet of any version
      *
      * @param type type of the packet
      * @return true True if needed
@@ -227,6 +297,15 @@ public:
      */
     static bool isHelloPacket(uint8_t type);
 
+    /**
+     * @brief Given a type returns if is a route packet of the previous versions
+     *
+     * @param type type of the packet
+     * @return true True if needed
+     * @return false If not
+     */
+    static bool isLegacyHelloPacket(uint8_t type);
+
     /**
      * @brief Given a type returns if is a NeedAck packet
      *
@@ -281,6 +360,70 @@ public:
      */
     static bool isDataControlPacket(uint8_t type);
 
+    /**
+     * @brief Given a type returns if is an Aggregated packet
+     *
+     * @param type type of the packet
+     * @return true True if needed
+     * @return false If not
+     */
+    static bool isAggregatedPacket(uint8_t type);
+
+    /**
+     * @brief Get the length of the frame sent by the radio, with the compact header if LM_COMPACT_HEADER is defined
+     *
+     * @param p Packet
+     * @return size_t Length in bytes
+     */
+    static size_t getFrameLength(Packet<uint8_t>* p);
+
+    /**
+     * @brief Get the maximum length of a route inside a route packet, encoded with encodeRoutes if LM_COMPACT_ROUTES is defined
+     *
+     * @return size_t Length in bytes
+     */
+    static size_t getMaxRouteLength();
+
+    /**
+     * @brief Get the minimum max packet size, a hello packet with one route and one link quality
+     *
+     * @return size_t Length in bytes
+     */
+    static size_t getMinPacketSize();
+
+    /**
+     * @brief Encode the packet with the compact header.
+     * First byte: version (2 bits), broadcast flag, via is the destination flag and type code (4 bits).
+     * Then the raw type if it has no code, the destination if not broadcast, the source, the via if needed,
+     * the sequence id and the number as a varint for the control packets, and the payload.
+     *
+     * @param p Packet to be encoded
+     * @param frame Buffer of at least p->packetSize bytes
+     * @return size_t Length of the frame in bytes
+     */
+    static size_t encodeCompactPacket(Packet<uint8_t>* p, uint8_t* frame);
+
+    /**
+     * @brief Decode a frame with the compact header into a new packet
+     *
+     * @param frame Frame received
+     * @param frameLength Length of the frame in bytes
+     * @return Packet<uint8_t>* Packet or nullptr if the frame is not valid
+     */
+    static Packet<uint8_t>* decodeCompactPacket(uint8_t* frame, size_t frameLength);
+
+    /**
+     * @brief Check the header of a received frame, without copying it, to know if the local node only needs to forward it.
+     * Data packets with a destination other than the local node and the local node as via
+     *
+     * @param frame Frame received
+     * @param frameLength Length of the frame in bytes
+     * @param localAddress Local address
+     * @return true If the packet is in transit
+     * @return false If not
+     */
+    static bool isTransitFrame(uint8_t* frame, size_t frameLength, uint16_t localAddress);
+
     /**
      * @brief Get the Packet Header
      *
@@ -288,6 +431,64 @@ public:
      * @return ControlPacket*
      */
     static ControlPacket* getPacketHeader(Packet<uint8_t>* p);
+
+private:
+    /**
+     * @brief Get the length of the header in memory, including the header of the hello packets
+     *
+     * @param type type of the packet
+     * @return uint8_t Length in bytes
+     */
+    static uint8_t getMemoryHeaderLength(uint8_t type);
+
+    /**
+     * @brief Get the length of the compact header of the packet
+     *
+     * @param p Packet
+     * @return size_t Length in bytes
+     */
+    static size_t getCompactHeaderLength(Packet<uint8_t>* p);
+
+    /**
+     * @brief Get the code of the type inside the compact header
+     *
+     * @param type type of the packet
+     * @return uint8_t Code, LM_COMPACT_RAW_TYPE if the type has no code
+     */
+    static uint8_t getCompactTypeCode(uint8_t type);
+
+    /**
+     * @brief Get the flags of the compact header of the packet
+     *
+     * @param p Packet
+     * @return uint8_t Flags
+     */
+    static uint8_t getCompactFlags(Packet<uint8_t>* p);
+
+    /**
+     * @brief Encode a network node without the byte of the metric nibbles
+     *
+     * @param node Network node
+     * @param previous Address of the previous network node
+     * @param buffer Buffer of at least 5 bytes
+     * @param nibble Metric nibble of the node
+     * @return size_t Length in bytes
+     */
+    static size_t encodeRoute(NetworkNode* node, uint16_t previous, uint8_t* buffer, uint8_t& nibble);
+
+    /**
+     * @brief Decode a network node encoded with encodeRoute
+     *
+     * @param buffer Encoded nodes
+     * @param length Length of the encoded nodes in bytes
+     * @param position Position of the node, it is moved after the node
+     * @param nibble Metric nibble of the node
+     * @param previous Address of the previous network node
+     * @param node Network node decoded
+     * @return true If the node is valid
+     * @return false If not
+     */
+    static bool decodeRoute(uint8_t* buffer, size_t length, size_t& position, uint8_t nibble, uint16_t previous, NetworkNode& node);
 };
 
 #endif
\ No newline at end of file
@@ -1,138 +1,676 @@
 #include "RoutingTableService.h"
 
 size_t RoutingTableService::routingTableSize() {
-    return routingTableList->getLength();
+    return routingTable->size();
 }
 
-RouteNode* RoutingTableService::findNode(uint16_t address) {
-    routingTableList->setInUse();
+LM_LinkedList<RouteNode>* RoutingTableService::getRoutingTableListCopy() {
+    LM_LinkedList<RouteNode>* list = new LM_LinkedList<RouteNode>();
+    list->setOwnsElements(true);
 
-    if (routingTableList->moveToStart()) {
-        do {
-            RouteNode* node = routingTableList->getCurrent();
+    routingTable->setInRead();
 
-            if (node->networkNode.address == address) {
-                routingTableList->releaseInUse();
-                return node;
-            }
+    for (RouteNode& node : *routingTable)
+        list->Append(new RouteNode(node));
 
-        } while (routingTableList->next());
-    }
+    routingTable->releaseInRead();
 
-    routingTableList->releaseInUse();
-    return nullptr;
+    return list;
 }
 
-RouteNode* RoutingTableService::getBestNodeByRole(uint8_t role) {
-    RouteNode* bestNode = nullptr;
+RoutingTableSnapshot* RoutingTableService::getRoutingTableSnapshot() {
+    portENTER_CRITICAL(&snapshotMux);
 
-    routingTableList->setInUse();
+    RoutingTableSnapshot* current = snapshot;
+    if (current != nullptr && current->version == routingTableVersion.load()) {
+        current->acquire();
+        portEXIT_CRITICAL(&snapshotMux);
+        return current;
+    }
 
-    if (routingTableList->moveToStart()) {
-        do {
-            RouteNode* node = routingTableList->getCurrent();
+    portEXIT_CRITICAL(&snapshotMux);
 
-            if ((node->networkNode.role & role) == role &&
-                (bestNode == nullptr || node->networkNode.metric < bestNode->networkNode.metric)) {
-                bestNode = node;
-            }
+    routingTable->setInRead();
+
+    RoutingTableSnapshot* newSnapshot = new RoutingTableSnapshot(routingTableVersion.load(), routingTable->size());
+
+    for (size_t i = 0; i < newSnapshot->numberOfNodes; i++) {
+        newSnapshot->routeNodes[i] = *routingTable->at(i);
+        newSnapshot->networkNodes[i] = routingTable->at(i)->networkNode;
+    }
+
+    routingTable->releaseInRead();
+
+    // One reference for the service and another one for the caller
+    newSnapshot->acquire();
+
+    // Another task could have published a snapshot of the same or a newer version meanwhile
+    portENTER_CRITICAL(&snapshotMux);
+    RoutingTableSnapshot* previous = snapshot;
+    bool newer = previous == nullptr || newSnapshot->version > previous->version;
+    if (newer)
+        snapshot = newSnapshot;
+    portEXIT_CRITICAL(&snapshotMux);
+
+    if (!newer)
+        newSnapshot->release();
+    else if (previous != nullptr)
+        previous->release();
+
+    ESP_LOGV(LM_TAG, "Routing table snapshot created, version %d", newSnapshot->version);
+
+    return newSnapshot;
+}
+
+uint32_t RoutingTableService::getRoutingTableVersion() {
+    return routingTableVersion.load();
+}
+
+bool RoutingTableService::getBestNodeByRole(uint8_t role, RouteNode& bestNode) {
+    RouteNode* best = nullptr;
 
-        } while (routingTableList->next());
+    routingTable->setInRead();
+
+    for (RouteNode& node : *routingTable) {
+        if ((node.networkNode.role & role) == role &&
+            (best == nullptr || node.networkNode.metric < best->networkNode.metric)) {
+            best = &node;
+        }
     }
 
-    routingTableList->releaseInUse();
-    return bestNode;
+    if (best != nullptr)
+        bestNode = *best;
+
+    routingTable->releaseInRead();
+    return best != nullptr;
 }
 
 bool RoutingTableService::hasAddressRoutingTable(uint16_t address) {
-    RouteNode* node = findNode(address);
-    return node != nullptr;
+    routingTable->setInRead();
+
+    bool found = routingTable->find(address) != nullptr;
+
+    routingTable->releaseInRead();
+    return found;
+}
+
+bool RoutingTableService::isLegacyNode(uint16_t address) {
+    routingTable->setInRead();
+
+    RouteNode* node = routingTable->find(address);
+    bool legacy = node != nullptr && node->legacy;
+
+    routingTable->releaseInRead();
+    return legacy;
 }
 
 uint16_t RoutingTableService::getNextHop(uint16_t dst) {
-    RouteNode* node = findNode(dst);
+    routingTable->setInRead();
 
-    if (node == nullptr)
-        return 0;
+    RouteNode* node = routingTable->find(dst);
+    uint16_t via = node == nullptr ? 0 : node->via;
 
-    return node->via;
+    routingTable->releaseInRead();
+    return via;
 }
 
 uint8_t RoutingTableService::getNumberOfHops(uint16_t address) {
-    RouteNode* node = findNode(address);
+    routingTable->setInRead();
+
+    RouteNode* node = routingTable->find(address);
+    uint8_t metric = node == nullptr ? 0 : node->networkNode.metric;
+
+    routingTable->releaseInRead();
+    return metric;
+}
+
+bool RoutingTableService::getRTT(uint16_t address, uint8_t& metric, unsigned long& SRTT, unsigned long& RTTVAR) {
+    routingTable->setInRead();
+
+    RouteNode* node = routingTable->find(address);
+    if (node != nullptr) {
+        metric = node->networkNode.metric;
+        SRTT = node->SRTT;
+        RTTVAR = node->RTTVAR;
+    }
+
+    routingTable->releaseInRead();
+    return node != nullptr;
+}
+
+void RoutingTableService::updateRTT(uint16_t address, unsigned long RTT) {
+    routingTable->setInUse();
+
+    RouteNode* node = routingTable->find(address);
+    if (node == nullptr) {
+        routingTable->releaseInUse();
+        ESP_LOGW(LM_TAG, "Node not found in the routing table");
+        return;
+    }
+
+    // First time RTT is calculated for this node (RFC 6298)
+    if (node->SRTT == 0) {
+        node->SRTT = RTT;
+        node->RTTVAR = RTT / 2;
+    }
+    else {
+        unsigned long absRTT = (node->SRTT > RTT) ? (node->SRTT - RTT) : (RTT - node->SRTT);
+        node->RTTVAR = std::min((node->RTTVAR * 3 + absRTT) / 4, 100000UL);
+        node->SRTT = std::min((node->SRTT * 7 + RTT) / 8, 100000UL);
+    }
 
-    if (node == nullptr)
-        return 0;
+    ESP_LOGV(LM_TAG, "Updating RTT (%u ms), SRTT (%u), RTTVAR (%u) Src: %X",
+        (unsigned int) RTT, (unsigned int) node->SRTT, (unsigned int) node->RTTVAR, address);
 
-    return node->networkNode.metric;
+    routingTable->releaseInUse();
 }
 
-void RoutingTableService::processRoute(RoutePacket* p, int8_t receivedSNR) {
-    if ((p->packetSize - sizeof(RoutePacket)) % sizeof(NetworkNode) != 0) {
+bool RoutingTableService::processRoute(RoutePacket* p, int8_t receivedSNR) {
+    bool compact = p->flags & LM_ROUTE_COMPACT;
+
+    if (p->packetSize < sizeof(RoutePacket) + p->numberOfLinks * sizeof(LinkQuality) ||
+        (!compact && p->getNetworkNodesLength() % sizeof(NetworkNode) != 0)) {
+        ESP_LOGE(LM_TAG, "Invalid route packet size");
+        return false;
+    }
+
+    size_t numNodes = 0;
+    NetworkNode* networkNodes = p->networkNodes;
+
+    if (compact) {
+        networkNodes = PacketService::decodeRoutes(reinterpret_cast<uint8_t*>(p->networkNodes), p->getNetworkNodesLength(), numNodes);
+        if (networkNodes == nullptr && p->getNetworkNodesLength() > 0) {
+            ESP_LOGE(LM_TAG, "Invalid compact routes");
+            return false;
+        }
+    }
+    else
+        numNodes = p->getNetworkNodesSize();
+
+    ESP_LOGI(LM_TAG, "Route packet from %X with size %d, sequence %d, flags %d", p->src, numNodes, p->advertisementSeq, p->flags);
+
+    uint8_t linkCost = getLinkCost(p->src, receivedSNR);
+
+    NetworkNode* receivedNode = new NetworkNode(p->src, linkCost, p->nodeRole);
+    processRoute(p->src, receivedNode, linkCost);
+    delete receivedNode;
+
+    resetReceiveSNRRoutePacket(p->src, receivedSNR);
+    setLegacyNode(p->src, false);
+
+    //The SNR and the delivery ratio of our packets received by the source
+    LinkQuality* links = p->getLinkQualities();
+    for (size_t i = 0; i < p->numberOfLinks; i++) {
+        if (links[i].address == WiFiService::getLocalAddress())
+            resetSentSNRRoutePacket(p->src, links[i].snr, links[i].deliveryRatio);
+    }
+
+    //Only the routes inside the packet are refreshed, the others through the source expire or are removed after its next full advertisement
+    bool synced = processAdvertisementSequence(p);
+
+    for (size_t i = 0; i < numNodes; i++) {
+        NetworkNode* node = &networkNodes[i];
+        if (node->metric == LM_ROUTE_WITHDRAWN_METRIC) {
+            withdrawRoute(p->src, node->address);
+            continue;
+        }
+
+        if (node->metric + linkCost >= LM_ROUTE_WITHDRAWN_METRIC)
+            continue;
+
+        node->metric += linkCost;
+        processRoute(p->src, node, linkCost);
+    }
+
+    if (compact)
+        delete[] networkNodes;
+
+    //All the packets of the full advertisement have been received, the routes not advertised are no longer available via the source
+    if (synced && (p->flags & LM_ROUTE_FULL_LAST))
+        removeStaleRoutesVia(p->src);
+
+    printRoutingTable();
+
+    return !synced;
+}
+
+void RoutingTableService::processLegacyRoute(LegacyRoutePacket* p, int8_t receivedSNR) {
+    if (p->packetSize < sizeof(LegacyRoutePacket)) {
         ESP_LOGE(LM_TAG, "Invalid route packet size");
         return;
     }
 
     size_t numNodes = p->getNetworkNodesSize();
-    ESP_LOGI(LM_TAG, "Route packet from %X with size %d", p->src, numNodes);
 
-    NetworkNode* receivedNode = new NetworkNode(p->src, 1, p->nodeRole);
-    processRoute(p->src, receivedNode);
-    delete receivedNode;
+    ESP_LOGI(LM_TAG, "Legacy route packet from %X with size %d", p->src, numNodes);
+
+    uint8_t linkCost = getLinkCost(p->src, receivedSNR);
+
+    NetworkNode receivedNode(p->src, linkCost, p->nodeRole);
+    processRoute(p->src, &receivedNode, linkCost);
 
     resetReceiveSNRRoutePacket(p->src, receivedSNR);
+    setLegacyNode(p->src, true);
 
+    //The whole routing table of the source, without withdrawn routes. The routes not advertised anymore expire
     for (size_t i = 0; i < numNodes; i++) {
         NetworkNode* node = &p->networkNodes[i];
-        node->metric++;
-        processRoute(p->src, node);
+        if (node->metric + linkCost >= LM_ROUTE_WITHDRAWN_METRIC)
+            continue;
+
+        node->metric += linkCost;
+        processRoute(p->src, node, linkCost);
     }
 
     printRoutingTable();
 }
 
-void RoutingTableService::resetReceiveSNRRoutePacket(uint16_t src, int8_t receivedSNR) {
-    RouteNode* rNode = findNode(src);
-    if (rNode == nullptr)
+bool RoutingTableService::processAdvertisementSequence(RoutePacket* p) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(p->src);
+    if (rNode == nullptr) {
+        routingTable->releaseInUse();
+        return false;
+    }
+
+    uint8_t expectedSeq = rNode->advertisementSeq + 1;
+
+    //Moving average of the delivery ratio, with a weight of 1/8 for every route packet
+    if (rNode->hasAdvertisementSeq && p->advertisementSeq != rNode->advertisementSeq) {
+        uint8_t lost = p->advertisementSeq - expectedSeq;
+        if (lost > LM_MAX_LINK_COST * 2)
+            lost = LM_MAX_LINK_COST * 2;
+
+        for (uint8_t i = 0; i < lost; i++)
+            rNode->receivedRatio -= rNode->receivedRatio >> 3;
+
+        rNode->receivedRatio += (UINT8_MAX - rNode->receivedRatio + 7) >> 3;
+    }
+
+    rNode->hasAdvertisementSeq = true;
+
+    if (p->flags & LM_ROUTE_FULL_FIRST) {
+        rNode->advertisementSynced = true;
+        rNode->fullAdvertisementStart = millis();
+    }
+    else if (p->advertisementSeq != expectedSeq && p->advertisementSeq != rNode->advertisementSeq) {
+        if (rNode->advertisementSynced)
+            ESP_LOGW(LM_TAG, "Route packets lost from %X, expected %d received %d", p->src, expectedSeq, p->advertisementSeq);
+
+        rNode->advertisementSynced = false;
+    }
+
+    rNode->advertisementSeq = p->advertisementSeq;
+    bool synced = rNode->advertisementSynced;
+
+    routingTable->releaseInUse();
+    return synced;
+}
+
+void RoutingTableService::setLegacyNode(uint16_t address, bool legacy) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(address);
+    if (rNode != nullptr)
+        rNode->legacy = legacy;
+
+    routingTable->releaseInUse();
+}
+
+void RoutingTableService::removeStaleRoutesVia(uint16_t via) {
+    routingTable->setInUse();
+
+    RouteNode* neighbor = routingTable->find(via);
+    if (neighbor == nullptr) {
+        routingTable->releaseInUse();
         return;
+    }
+
+    //The routes advertised since the start of the full advertisement expire after this time
+    uint32_t refreshedTimeout = neighbor->fullAdvertisementStart + DEFAULT_TIMEOUT * 1000;
 
-    ESP_LOGI(LM_TAG, "Reset Receive SNR from %X: %d", src, receivedSNR);
+    // Iterate backwards, erasing an entry moves the last entry to its position
+    for (size_t position = routingTable->size(); position-- > 0;) {
+        RouteNode* node = routingTable->at(position);
+        if (node->networkNode.address == via)
+            continue;
 
-    rNode->receivedSNR = receivedSNR;
+        for (uint8_t i = 0; i < node->numberOfAlternatives; i++) {
+            if (node->alternatives[i].via == via && node->alternatives[i].timeout < refreshedTimeout) {
+                removeAlternative(node, via);
+                break;
+            }
+        }
+
+        if (node->via != via || node->timeout >= refreshedTimeout)
+            continue;
+
+        if (promoteAlternative(node)) {
+            ESP_LOGW(LM_TAG, "Route to %X not advertised by %X, using via %X", node->networkNode.address, via, node->via);
+            routingTableVersion++;
+        }
+        else {
+            ESP_LOGW(LM_TAG, "Route to %X not advertised by %X, removing it", node->networkNode.address, via);
+            eraseRoute(node);
+        }
+    }
+
+    routingTable->releaseInUse();
 }
 
-void RoutingTableService::processRoute(uint16_t via, NetworkNode* node) {
+void RoutingTableService::withdrawRoute(uint16_t via, uint16_t address) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(address);
+    if (rNode != nullptr && address != via) {
+        if (rNode->via != via)
+            removeAlternative(rNode, via);
+        else if (promoteAlternative(rNode)) {
+            ESP_LOGW(LM_TAG, "Route withdrawn %X via %X, using via %X", address, via, rNode->via);
+            routingTableVersion++;
+        }
+        else {
+            ESP_LOGW(LM_TAG, "Route withdrawn %X via %X", address, via);
+
+            eraseRoute(rNode);
+        }
+    }
+
+    routingTable->releaseInUse();
+}
+
+size_t RoutingTableService::failNextHop(uint16_t via) {
+    size_t numOfFailovers = 0;
+
+    routingTable->setInUse();
+
+    // Iterate backwards, erasing an entry moves the last entry to its position
+    for (size_t position = routingTable->size(); position-- > 0;) {
+        RouteNode* node = routingTable->at(position);
+
+        removeAlternative(node, via);
+
+        if (node->via != via)
+            continue;
+
+        if (promoteAlternative(node)) {
+            ESP_LOGW(LM_TAG, "Next hop %X dead, route to %X via %X", via, node->networkNode.address, node->via);
+            numOfFailovers++;
+        }
+        else {
+            ESP_LOGW(LM_TAG, "Next hop %X dead, removing route to %X", via, node->networkNode.address);
+            eraseRoute(node);
+            continue;
+        }
+
+        routingTableVersion++;
+    }
+
+    routingTable->releaseInUse();
+
+    return numOfFailovers;
+}
+
+void RoutingTableService::addAlternative(RouteNode* rNode, uint16_t via, uint8_t metric, uint32_t timeout) {
+    if (RouteNode::MAX_ALTERNATIVES == 0 || via == rNode->via)
+        return;
+
+    removeAlternative(rNode, via);
+
+    uint8_t position = rNode->numberOfAlternatives;
+    if (position == RouteNode::MAX_ALTERNATIVES) {
+        //Replace the worst alternative, only if it is worse
+        if (rNode->alternatives[position - 1].metric <= metric)
+            return;
+
+        position--;
+    }
+    else
+        rNode->numberOfAlternatives++;
+
+    //Keep the alternatives ordered by metric
+    while (position > 0 && rNode->alternatives[position - 1].metric > metric) {
+        rNode->alternatives[position] = rNode->alternatives[position - 1];
+        position--;
+    }
+
+    rNode->alternatives[position].via = via;
+    rNode->alternatives[position].metric = metric;
+    rNode->alternatives[position].timeout = timeout;
+
+    scheduleRouteTimeout(rNode);
+}
+
+void RoutingTableService::removeAlternative(RouteNode* rNode, uint16_t via) {
+    for (uint8_t i = 0; i < rNode->numberOfAlternatives; i++) {
+        if (rNode->alternatives[i].via != via)
+            continue;
+
+        rNode->numberOfAlternatives--;
+        for (uint8_t j = i; j < rNode->numberOfAlternatives; j++)
+            rNode->alternatives[j] = rNode->alternatives[j + 1];
+
+        scheduleRouteTimeout(rNode);
+        return;
+    }
+}
+
+bool RoutingTableService::promoteAlternative(RouteNode* rNode) {
+    if (rNode->numberOfAlternatives == 0)
+        return false;
+
+    RouteAlternative best = rNode->alternatives[0];
+    removeAlternative(rNode, best.via);
+
+    rNode->via = best.via;
+    rNode->networkNode.metric = best.metric;
+    rNode->timeout = best.timeout;
+
+    scheduleRouteTimeout(rNode);
+    return true;
+}
+
+NetworkNode* RoutingTableService::getRouteChanges(RoutingTableSnapshot* previous, RoutingTableSnapshot* current, size_t& numOfChanges) {
+    size_t numOfPrevious = previous == nullptr ? 0 : previous->numberOfNodes;
+    numOfChanges = 0;
+
+    if (numOfPrevious + current->numberOfNodes == 0)
+        return nullptr;
+
+    NetworkNode* changes = new NetworkNode[numOfPrevious + current->numberOfNodes];
+
+    //Added or changed routes
+    for (size_t i = 0; i < current->numberOfNodes; i++) {
+        NetworkNode* node = &current->networkNodes[i];
+        NetworkNode* previousNode = nullptr;
+
+        for (size_t j = 0; j < numOfPrevious && previousNode == nullptr; j++) {
+            if (previous->networkNodes[j].address == node->address)
+                previousNode = &previous->networkNodes[j];
+        }
+
+        if (previousNode == nullptr || previousNode->metric != node->metric || previousNode->role != node->role)
+            changes[numOfChanges++] = *node;
+    }
+
+    //Withdrawn routes
+    for (size_t j = 0; j < numOfPrevious; j++) {
+        NetworkNode* previousNode = &previous->networkNodes[j];
+        bool found = false;
+
+        for (size_t i = 0; i < current->numberOfNodes && !found; i++)
+            found = current->networkNodes[i].address == previousNode->address;
+
+        if (!found)
+            changes[numOfChanges++] = NetworkNode(previousNode->address, LM_ROUTE_WITHDRAWN_METRIC, previousNode->role);
+    }
+
+    if (numOfChanges == 0) {
+        delete[] changes;
+        return nullptr;
+    }
+
+    return changes;
+}
+
+void RoutingTableService::resetReceiveSNRRoutePacket(uint16_t src, int8_t receivedSNR) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(src);
+    if (rNode != nullptr) {
+        ESP_LOGI(LM_TAG, "Reset Receive SNR from %X: %d", src, receivedSNR);
+
+        rNode->receivedSNR = receivedSNR;
+    }
+
+    routingTable->releaseInUse();
+}
+
+void RoutingTableService::resetSentSNRRoutePacket(uint16_t src, int8_t sentSNR, uint8_t sentRatio) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(src);
+    if (rNode != nullptr) {
+        ESP_LOGI(LM_TAG, "Reset Sent SNR to %X: %d, delivery ratio %d", src, sentSNR, sentRatio);
+
+        rNode->sentSNR = sentSNR;
+        rNode->sentRatio = sentRatio;
+        rNode->hasSentSNR = true;
+    }
+
+    routingTable->releaseInUse();
+}
+
+void RoutingTableService::setRoutingMetric(uint8_t metric, uint8_t hysteresis, int8_t floor) {
+    routingMetric = metric;
+    routeHysteresis = hysteresis;
+    demodulationFloor = floor;
+}
+
+int8_t RoutingTableService::getDemodulationFloor() {
+    return demodulationFloor;
+}
+
+uint8_t RoutingTableService::getLinkCost(uint16_t address, int8_t receivedSNR) {
+    if (routingMetric == LM_HOP_COUNT_METRIC)
+        return 1;
+
+    //Copy the link quality, the route could be erased as soon as the lock is released
+    routingTable->setInRead();
+
+    RouteNode* rNode = routingTable->find(address);
+    bool found = rNode != nullptr;
+    bool hasSentSNR = found && rNode->hasSentSNR;
+    int8_t sentSNR = found ? rNode->sentSNR : 0;
+    uint8_t receivedRatio = found ? rNode->receivedRatio : 0;
+    uint8_t sentRatio = found ? rNode->sentRatio : 0;
+
+    routingTable->releaseInRead();
+
+    int16_t cost = 1;
+
+    if (routingMetric == LM_SNR_METRIC) {
+        //The worst direction of the link
+        int16_t snr = receivedSNR;
+        if (hasSentSNR && sentSNR < snr)
+            snr = sentSNR;
+
+        int16_t deficit = LM_SNR_COST_MARGIN - (snr - demodulationFloor);
+        if (deficit > 0)
+            cost += (deficit + LM_SNR_COST_STEP - 1) / LM_SNR_COST_STEP;
+    }
+    else if (routingMetric == LM_ETX_METRIC && found) {
+        //ETX = 1 / (forward delivery ratio * reverse delivery ratio)
+        uint16_t ratio = (uint16_t) receivedRatio * sentRatio / UINT8_MAX;
+        cost = ratio == 0 ? LM_MAX_LINK_COST : (UINT8_MAX + ratio / 2) / ratio;
+    }
+
+    if (cost < 1)
+        cost = 1;
+    else if (cost > LM_MAX_LINK_COST)
+        cost = LM_MAX_LINK_COST;
+
+    return cost;
+}
+
+void RoutingTableService::clearSentSNR(uint16_t address) {
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->find(address);
+    if (rNode != nullptr)
+        rNode->hasSentSNR = false;
+
+    routingTable->releaseInUse();
+}
+
+bool RoutingTableService::getSentSNR(uint16_t address, int8_t& sentSNR) {
+    routingTable->setInRead();
+
+    RouteNode* rNode = routingTable->find(address);
+    bool hasSentSNR = rNode != nullptr && rNode->via == address && rNode->hasSentSNR;
+    if (hasSentSNR)
+        sentSNR = rNode->sentSNR;
+
+    routingTable->releaseInRead();
+    return hasSentSNR;
+}
+
+void RoutingTableService::processRoute(uint16_t via, NetworkNode* node, uint8_t linkCost) {
     if (node->address != WiFiService::getLocalAddress()) {
+        routingTable->setInUse();
 
-        RouteNode* rNode = findNode(node->address);
+        RouteNode* rNode = routingTable->find(node->address);
         //If nullptr the node is not inside the routing table, then add it
         if (rNode == nullptr) {
+            routingTable->releaseInUse();
             addNodeToRoutingTable(node, via);
             return;
         }
 
+        uint8_t hysteresis = routingMetric == LM_HOP_COUNT_METRIC ? 0 : routeHysteresis;
+
         //Update the metric and restart timeout if needed
-        if (node->metric < rNode->networkNode.metric) {
+        if (node->metric + hysteresis < rNode->networkNode.metric) {
+            //The previous next hop could route through the local node, it is an alternative again only when it advertises a feasible metric
+            removeAlternative(rNode, via);
+
             rNode->networkNode.metric = node->metric;
             rNode->via = via;
             resetTimeoutRoutingNode(rNode);
+            routingTableVersion++;
             ESP_LOGI(LM_TAG, "Found better route for %X via %X metric %d", node->address, via, node->metric);
         }
-        else if (node->metric == rNode->networkNode.metric) {
-            //Reset the timeout, only when the metric is the same as the actual route.
+        else if (rNode->via == via) {
+            //The next hop changes the metric of the actual route, the link quality could be worse
+            if (node->metric != rNode->networkNode.metric) {
+                ESP_LOGI(LM_TAG, "Route metric for %X via %X changed from %d to %d", node->address, via, rNode->networkNode.metric, node->metric);
+                rNode->networkNode.metric = node->metric;
+                routingTableVersion++;
+            }
+
             resetTimeoutRoutingNode(rNode);
         }
+        else if (node->metric - linkCost < rNode->networkNode.metric) {
+            //Only the next hops closer to the destination than the local node are alternatives, they cannot create loops
+            addAlternative(rNode, via, node->metric, millis() + DEFAULT_TIMEOUT * 1000);
+        }
+        else
+            removeAlternative(rNode, via);
 
         // Update the Role only if the node that sent the packet is the next hop
-        if (getNextHop(node->address) == via && node->role != rNode->networkNode.role) {
+        if (rNode->via == via && node->role != rNode->networkNode.role) {
             ESP_LOGI(LM_TAG, "Updating role of %X to %d", node->address, node->role);
             rNode->networkNode.role = node->role;
+            routingTableVersion++;
         }
+
+        routingTable->releaseInUse();
     }
 }
 
 void RoutingTableService::addNodeToRoutingTable(NetworkNode* node, uint16_t via) {
-    if (routingTableList->getLength() >= RTMAXSIZE) {
+    if (routingTable->isFull()) {
         ESP_LOGW(LM_TAG, "Routing table max size reached, not adding route and deleting it");
         return;
     }
@@ -142,118 +680,199 @@ void RoutingTableService::addNodeToRoutingTable(NetworkNode* node, uint16_t via)
         return;
     }
 
-    RouteNode* rNode = new RouteNode(node->address, node->metric, node->role, via);
+    routingTable->setInUse();
+
+    RouteNode* rNode = routingTable->insert(node->address);
+    if (rNode == nullptr) {
+        routingTable->releaseInUse();
+        ESP_LOGW(LM_TAG, "Routing table max size reached, not adding route and deleting it");
+        return;
+    }
+
+    *rNode = RouteNode(node->address, node->metric, node->role, via);
 
     //Reset the timeout of the node
     resetTimeoutRoutingNode(rNode);
 
-    routingTableList->setInUse();
+    routingTableVersion++;
 
-    routingTableList->Append(rNode);
-
-    routingTableList->releaseInUse();
+    routingTable->releaseInUse();
 
     ESP_LOGI(LM_TAG, "New route added: %X via %X metric %d, role %d", node->address, via, node->metric, node->role);
 }
 
 NetworkNode* RoutingTableService::getAllNetworkNodes() {
-    routingTableList->setInUse();
+    routingTable->setInRead();
 
-    int routingSize = routingTableSize();
+    size_t routingSize = routingTableSize();
 
     // If the routing table is empty return nullptr
     if (routingSize == 0) {
-        routingTableList->releaseInUse();
+        routingTable->releaseInRead();
         return nullptr;
     }
 
     NetworkNode* payload = new NetworkNode[routingSize];
 
-    if (routingTableList->moveToStart()) {
-        for (int i = 0; i < routingSize; i++) {
-            RouteNode* currentNode = routingTableList->getCurrent();
-            payload[i] = currentNode->networkNode;
-
-            if (!routingTableList->next())
-                break;
-        }
-    }
+    for (size_t i = 0; i < routingSize; i++)
+        payload[i] = routingTable->at(i)->networkNode;
 
-    routingTableList->releaseInUse();
+    routingTable->releaseInRead();
 
     return payload;
 }
 
 void RoutingTableService::resetTimeoutRoutingNode(RouteNode* node) {
     node->timeout = millis() + DEFAULT_TIMEOUT * 1000;
+    scheduleRouteTimeout(node);
 }
 
-void RoutingTableService::printRoutingTable() {
-    ESP_LOGI(LM_TAG, "Current routing table:");
+void RoutingTableService::scheduleRouteTimeout(RouteNode* rNode) {
+    if (!routeTimeouts->push(rNode))
+        ESP_LOGE(LM_TAG, "Route timeouts full, route to %X", rNode->networkNode.address);
+}
+
+void RoutingTableService::eraseRoute(RouteNode* rNode) {
+    uint16_t address = rNode->networkNode.address;
 
-    routingTableList->setInUse();
+    routeTimeouts->remove(rNode);
+    routingTable->erase(address);
+    routingTableVersion++;
 
-    if (routingTableList->moveToStart()) {
-        size_t position = 0;
+    for (size_t i = 0; i < numRemovedRoutes; i++) {
+        if (removedRoutes[i] == address)
+            return;
+    }
+
+    if (numRemovedRoutes < RTMAXSIZE)
+        removedRoutes[numRemovedRoutes++] = address;
+    else
+        ESP_LOGW(LM_TAG, "Too many removed routes waiting, not dispatching %X", address);
+}
+
+void RoutingTableService::setRouteRemovedCallback(void (*callback)(uint16_t)) {
+    routeRemovedCallback = callback;
+}
+
+bool RoutingTableService::hasRemovedRoutes() {
+    return numRemovedRoutes > 0;
+}
 
-        do {
-            RouteNode* node = routingTableList->getCurrent();
+void RoutingTableService::dispatchRemovedRoutes() {
+    uint16_t addresses[RTMAXSIZE];
 
-            ESP_LOGI(LM_TAG, "%d - %X via %X metric %d Role %d", position,
-                node->networkNode.address,
-                node->via,
-                node->networkNode.metric,
-                node->networkNode.role);
+    routingTable->setInUse();
 
-            position++;
-        } while (routingTableList->next());
+    size_t numAddresses = numRemovedRoutes;
+    for (size_t i = 0; i < numAddresses; i++)
+        addresses[i] = removedRoutes[i];
+
+    numRemovedRoutes = 0;
+
+    routingTable->releaseInUse();
+
+    if (routeRemovedCallback == nullptr)
+        return;
+
+    for (size_t i = 0; i < numAddresses; i++)
+        routeRemovedCallback(addresses[i]);
+}
+
+void RoutingTableService::printRoutingTable() {
+    ESP_LOGI(LM_TAG, "Current routing table:");
+
+    routingTable->setInRead();
+
+    for (size_t position = 0; position < routingTable->size(); position++) {
+        RouteNode* node = routingTable->at(position);
+
+        ESP_LOGI(LM_TAG, "%d - %X via %X metric %d Role %d Alternatives %d", position,
+            node->networkNode.address,
+            node->via,
+            node->networkNode.metric,
+            node->networkNode.role,
+            node->numberOfAlternatives);
     }
 
-    routingTableList->releaseInUse();
+    routingTable->releaseInRead();
 }
 
-void RoutingTableService::manageTimeoutRoutingTable() {
-    ESP_LOGI(LM_TAG, "Checking routes timeout");
+uint32_t RoutingTableService::manageTimeoutRoutingTable() {
+    ESP_LOGV(LM_TAG, "Checking routes timeout");
 
-    routingTableList->setInUse();
+    uint32_t routingTableVersionBefore = routingTableVersion.load();
 
-    if (routingTableList->moveToStart()) {
-        do {
-            RouteNode* node = routingTableList->getCurrent();
+    routingTable->setInUse();
 
-            if (node->timeout < millis()) {
-                ESP_LOGW(LM_TAG, "Route timeout %X via %X", node->networkNode.address, node->via);
+    uint32_t now = millis();
 
-                delete node;
-                routingTableList->DeleteCurrent();
-            }
+    // Only the routes with an expired next hop are visited, every iteration removes at least one of them
+    RouteNode* node;
+    while ((node = routeTimeouts->top()) != nullptr && node->getHeapKey() <= now) {
+        for (uint8_t i = node->numberOfAlternatives; i-- > 0;) {
+            if (node->alternatives[i].timeout <= now)
+                removeAlternative(node, node->alternatives[i].via);
+        }
+
+        if (node->timeout > now)
+            continue;
+
+        if (promoteAlternative(node)) {
+            ESP_LOGW(LM_TAG, "Route timeout %X, using via %X", node->networkNode.address, node->via);
+            routingTableVersion++;
+            continue;
+        }
 
-        } while (routingTableList->next());
+        ESP_LOGW(LM_TAG, "Route timeout %X via %X", node->networkNode.address, node->via);
+
+        eraseRoute(node);
     }
 
-    routingTableList->releaseInUse();
+    node = routeTimeouts->top();
+    uint32_t nextTimeout = node == nullptr ? 0 : node->getHeapKey();
 
-    printRoutingTable();
+    routingTable->releaseInUse();
+
+    if (routingTableVersionBefore != routingTableVersion.load())
+        printRoutingTable();
+
+    return nextTimeout;
 }
 
 uint8_t RoutingTableService::calculateMaximumMetricOfRoutingTable() {
-    routingTableList->setInUse();
+    routingTable->setInRead();
 
     uint8_t maximumMetricOfRoutingTable = 0;
 
-    if (routingTableList->moveToStart()) {
-        do {
-            RouteNode* node = routingTableList->getCurrent();
-
-            if (node->networkNode.metric > maximumMetricOfRoutingTable)
-                maximumMetricOfRoutingTable = node->networkNode.metric;
-
-        } while (routingTableList->next());
+    for (RouteNode& node : *routingTable) {
+        if (node.networkNode.metric > maximumMetricOfRoutingTable)
+            maximumMetricOfRoutingTable = node.networkNode.metric;
     }
 
-    routingTableList->releaseInUse();
+    routingTable->releaseInRead();
 
-    return maximumMetricOfRoutingTable + 1;
+    uint16_t maximumMetric = maximumMetricOfRoutingTable + (routingMetric == LM_HOP_COUNT_METRIC ? 1 : LM_MAX_LINK_COST);
+    return maximumMetric > UINT8_MAX ? UINT8_MAX : maximumMetric;
 }
 
-LM_LinkedList<RouteNode>* RoutingTableService::routingTableList = new LM_LinkedList<RouteNode>();
\ No newline at end of file
+std::atomic<uint32_t> RoutingTableService::routingTableVersion{0};
+
+RoutingTableSnapshot* RoutingTableService::snapshot = nullptr;
+
+uint16_t RoutingTableService::removedRoutes[RTMAXSIZE];
+
+size_t RoutingTableService::numRemovedRoutes = 0;
+
+void (*RoutingTableService::routeRemovedCallback)(uint16_t) = nullptr;
+
+uint8_t RoutingTableService::routingMetric = LM_ROUTING_METRIC;
+
+uint8_t RoutingTableService::routeHysteresis = LM_ROUTE_HYSTERESIS;
+
+int8_t RoutingTableService::demodulationFloor = -7;
+
+portMUX_TYPE RoutingTableService::snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+
+LM_HashTable<uint16_t, RouteNode, RTMAXSIZE>* RoutingTableService::routingTable = new LM_HashTable<uint16_t, RouteNode, RTMAXSIZE>();
+
+LM_MinHeap<RouteNode, RTMAXSIZE>* RoutingTableService::routeTimeouts = new LM_MinHeap<RouteNode, RTMAXSIZE>();
\ No newline at end of file
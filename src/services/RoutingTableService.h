@@ -3,10 +3,16 @@
 
 #include "utilities/LinkedQueue.hpp"
 
+#include "utilities/HashTable.hpp"
+
+#include "utilities/MinHeap.hpp"
+
 #include "entities/routingTable/RouteNode.h"
 
 #include "entities/routingTable/NetworkNode.h"
 
+#include "entities/routingTable/RoutingTableSnapshot.h"
+
 #include "entities/packets/RoutePacket.h"
 
 #include "BuildOptions.h"
@@ -15,6 +21,8 @@
 
 #include "services/RoleService.h"
 
+#include "services/PacketService.h"
+
 /**
  * @brief Routing Table Service
  *
@@ -23,10 +31,32 @@ class RoutingTableService {
 public:
 
 	/**
-	 * @brief Routing table List
+	 * @brief Routing table, the route nodes are indexed by address
+	 *
+	 */
+	static LM_HashTable<uint16_t, RouteNode, RTMAXSIZE>* routingTable;
+
+	/**
+	 * @brief Get a copy of the routing table in a list. Delete it after using the list.
+	 *
+	 * @return LM_LinkedList<RouteNode>* List with a copy of the route nodes
+	 */
+	static LM_LinkedList<RouteNode>* getRoutingTableListCopy();
+
+	/**
+	 * @brief Get the snapshot of the actual routing table. It is only rebuilt when the routing table has changed.
+	 * Call release() of the snapshot after using it.
+	 *
+	 * @return RoutingTableSnapshot* Snapshot of the routing table
+	 */
+	static RoutingTableSnapshot* getRoutingTableSnapshot();
+
+	/**
+	 * @brief Get the version of the routing table. It changes every time a route is added, removed or modified.
 	 *
+	 * @return uint32_t version
 	 */
-	static LM_LinkedList<RouteNode>* routingTableList;
+	static uint32_t getRoutingTableVersion();
 
 	/**
 	 * @brief Prints the actual routing table in the log
@@ -42,20 +72,14 @@ public:
 	static NetworkNode* getAllNetworkNodes();
 
 	/**
-	 * @brief Find the node that contains the address
-	 *
-	 * @param address address to be found
-	 * @return RouteNode* pointer to the RouteNode or nullptr
-	 */
-	static RouteNode* findNode(uint16_t address);
-
-	/**
-	 * @brief Get the best node that contains a role, the nearest
+	 * @brief Get a copy of the best node that contains a role, the nearest
 	 *
 	 * @param role role to be found
-	 * @return RouteNode* pointer to the RouteNode or nullptr
+	 * @param bestNode Copy of the RouteNode, the routes of the routing table can be removed at any time
+	 * @return true If a node with the role has been found
+	 * @return false If not
 	 */
-	static RouteNode* getBestNodeByRole(uint8_t role);
+	static bool getBestNodeByRole(uint8_t role, RouteNode& bestNode);
 
 	/**
 	 * @brief Returns if address is inside the routing table
@@ -66,6 +90,15 @@ public:
 	 */
 	static bool hasAddressRoutingTable(uint16_t address);
 
+	/**
+	 * @brief Check if the neighbor sends the route packets of the previous versions
+	 *
+	 * @param address Address of the neighbor
+	 * @return true If its route packets are HELLO_P
+	 * @return false If not, or it is not inside the routing table
+	 */
+	static bool isLegacyNode(uint16_t address);
+
 	/**
 	 * @brief Get the Next Hop address
 	 *
@@ -75,13 +108,34 @@ public:
 	static uint16_t getNextHop(uint16_t dst);
 
 	/**
-	 * @brief Get the Number Of Hops of the address inside the routing table
+	 * @brief Get the Number Of Hops of the address inside the routing table.
+	 * It is the metric of the route, with the SNR and ETX metrics it is greater or equal than the number of hops
 	 *
 	 * @param address Address of the number of hops you want to know
 	 * @return uint8_t Number of Hops or 0 if address not found in routing table.
 	 */
 	static uint8_t getNumberOfHops(uint16_t address);
 
+	/**
+	 * @brief Get the metric and the round-trip time of the route to the address, read under the routing table lock
+	 *
+	 * @param address Address of the node
+	 * @param metric Metric of the route
+	 * @param SRTT Smoothed round-trip time in ms, 0 if it has not been measured
+	 * @param RTTVAR Round-trip time variation in ms
+	 * @return true If the address is inside the routing table
+	 * @return false If not
+	 */
+	static bool getRTT(uint16_t address, uint8_t& metric, unsigned long& SRTT, unsigned long& RTTVAR);
+
+	/**
+	 * @brief Update the smoothed round-trip time of the route to the address with a new measure (RFC 6298)
+	 *
+	 * @param address Address of the node
+	 * @param RTT Measured round-trip time in ms
+	 */
+	static void updateRTT(uint16_t address, unsigned long RTT);
+
 	/**
 	 * @brief Returns the routing table size
 	 *
@@ -100,8 +154,29 @@ public:
 	  *
 	  * @param p Route Packet
 	  * @param receivedSNR Received SNR
+	  * @return true If route packets of the source have been lost since its last advertisement of the whole routing table
+	  * @return false If not
 	  */
-	static void processRoute(RoutePacket* p, int8_t receivedSNR);
+	static bool processRoute(RoutePacket* p, int8_t receivedSNR);
+
+	/**
+	 * @brief Process the route packet of a node of the previous versions, with its whole routing table
+	 *
+	 * @param p Legacy Route Packet
+	 * @param receivedSNR Received SNR
+	 */
+	static void processLegacyRoute(LegacyRoutePacket* p, int8_t receivedSNR);
+
+	/**
+	 * @brief Get the routes added, changed or withdrawn between two snapshots of the routing table.
+	 * The withdrawn routes have the metric LM_ROUTE_WITHDRAWN_METRIC
+	 *
+	 * @param previous Previous snapshot, nullptr if there is no previous snapshot
+	 * @param current Current snapshot
+	 * @param numOfChanges Number of changes
+	 * @return NetworkNode* Array of changes, delete it after using it. nullptr if there are no changes
+	 */
+	static NetworkNode* getRouteChanges(RoutingTableSnapshot* previous, RoutingTableSnapshot* current, size_t& numOfChanges);
 
 	/**
 	 * @brief Reset the SNR from the Route Node received
@@ -116,24 +191,176 @@ public:
 	 *
 	 * @param src Source address
 	 * @param sentSNR Sent SNR
+	 * @param sentRatio Ratio of our route packets received by the source
+	 */
+	static void resetSentSNRRoutePacket(uint16_t src, int8_t sentSNR, uint8_t sentRatio);
+
+	/**
+	 * @brief Set the routing metric
+	 *
+	 * @param metric LM_HOP_COUNT_METRIC, LM_SNR_METRIC or LM_ETX_METRIC
+	 * @param hysteresis Minimum improvement of the metric to change the next hop of a route, with the SNR and ETX metrics
+	 * @param demodulationFloor SNR in dB needed to receive the packets with the actual spreading factor
+	 */
+	static void setRoutingMetric(uint8_t metric, uint8_t hysteresis, int8_t demodulationFloor);
+
+	/**
+	 * @brief Get the demodulation floor set with the routing metric
+	 *
+	 * @return int8_t SNR in dB needed to receive the packets with the actual spreading factor
+	 */
+	static int8_t getDemodulationFloor();
+
+	/**
+	 * @brief Forget the SNR from the Route Node Sent, the packets to the node are sent with the configured power
+	 *
+	 * @param address Address of the node
 	 */
-	static void resetSentSNRRoutePacket(uint16_t src, int8_t sentSNR);
+	static void clearSentSNR(uint16_t address);
 
 	/**
-	 * @brief Checks all the routing entries for a route timeout and remove the entry.
+	 * @brief Get the SNR of our packets reported by a neighbor, read under the routing table lock
 	 *
+	 * @param address Address of the neighbor
+	 * @param sentSNR SNR in dB of our packets received by the neighbor
+	 * @return true If the neighbor is a direct route and it has reported the SNR
+	 * @return false If not
 	 */
-	static void manageTimeoutRoutingTable();
+	static bool getSentSNR(uint16_t address, int8_t& sentSNR);
+
+	/**
+	 * @brief Remove the routes and the alternative next hops whose timeout has been reached, in order of deadline
+	 *
+	 * @return uint32_t Next timeout of the routing table, 0 if the routing table is empty
+	 */
+	static uint32_t manageTimeoutRoutingTable();
+
+	/**
+	 * @brief Set the function called with the address of every route removed from the routing table.
+	 * It is called by dispatchRemovedRoutes, without holding the routing table
+	 *
+	 * @param callback Function called with the address of the removed route
+	 */
+	static void setRouteRemovedCallback(void (*callback)(uint16_t));
+
+	/**
+	 * @brief Returns if there are removed routes waiting to be dispatched
+	 *
+	 * @return true If there are removed routes
+	 * @return false If not
+	 */
+	static bool hasRemovedRoutes();
+
+	/**
+	 * @brief Call the route removed callback with the routes removed since the last call
+	 *
+	 */
+	static void dispatchRemovedRoutes();
+
+	/**
+	 * @brief Declare a next hop dead. The routes through it change to their best alternative next hop, or are removed without alternatives
+	 *
+	 * @param via Next hop
+	 * @return size_t Number of routes changed to an alternative next hop
+	 */
+	static size_t failNextHop(uint16_t via);
 
 private:
 
+	/**
+	 * @brief Version of the routing table, modified while holding the routing table in use
+	 *
+	 */
+	static std::atomic<uint32_t> routingTableVersion;
+
+	/**
+	 * @brief Routes ordered by their next timeout, modified while holding the routing table in use
+	 *
+	 */
+	static LM_MinHeap<RouteNode, RTMAXSIZE>* routeTimeouts;
+
+	/**
+	 * @brief Addresses of the routes removed and not dispatched yet, modified while holding the routing table in use
+	 *
+	 */
+	static uint16_t removedRoutes[RTMAXSIZE];
+
+	/**
+	 * @brief Number of removed routes not dispatched yet
+	 *
+	 */
+	static size_t numRemovedRoutes;
+
+	/**
+	 * @brief Function called with the address of every removed route
+	 *
+	 */
+	static void (*routeRemovedCallback)(uint16_t);
+
+	/**
+	 * @brief Remove the route from the routing table and its timeouts, and keep its address to dispatch it.
+	 * The routing table needs to be in use
+	 *
+	 * @param rNode Route node to be removed
+	 */
+	static void eraseRoute(RouteNode* rNode);
+
+	/**
+	 * @brief Update the position of the route inside the route timeouts, after changing the timeout of any of its next hops.
+	 * The routing table needs to be in use
+	 *
+	 * @param rNode Route node
+	 */
+	static void scheduleRouteTimeout(RouteNode* rNode);
+
+	/**
+	 * @brief Last snapshot of the routing table
+	 *
+	 */
+	static RoutingTableSnapshot* snapshot;
+
+	/**
+	 * @brief Protects the replacement of the snapshot
+	 *
+	 */
+	static portMUX_TYPE snapshotMux;
+
 	/**
 	 * @brief process the network node, adds the node in the routing table if can
 	 *
 	 * @param via via address
 	 * @param node NetworkNode
+	 * @param linkCost Cost of the link with the via, node->metric - linkCost is the metric advertised by the via
 	 */
-	static void processRoute(uint16_t via, NetworkNode* node);
+	static void processRoute(uint16_t via, NetworkNode* node, uint8_t linkCost);
+
+	/**
+	 * @brief Add or update an alternative next hop of the route, keeping them ordered by metric.
+	 * When there is no space, it replaces the worst alternative if it is better
+	 *
+	 * @param rNode Route node
+	 * @param via Next hop
+	 * @param metric Metric through the next hop
+	 * @param timeout Timeout of the route through the next hop
+	 */
+	static void addAlternative(RouteNode* rNode, uint16_t via, uint8_t metric, uint32_t timeout);
+
+	/**
+	 * @brief Remove an alternative next hop of the route
+	 *
+	 * @param rNode Route node
+	 * @param via Next hop
+	 */
+	static void removeAlternative(RouteNode* rNode, uint16_t via);
+
+	/**
+	 * @brief Replace the next hop of the route with its best alternative
+	 *
+	 * @param rNode Route node
+	 * @return true If the route has changed to the alternative
+	 * @return false If there are no alternatives
+	 */
+	static bool promoteAlternative(RouteNode* rNode);
 
 	/**
 	 * @brief process the network node, adds the node in the routing table if can
@@ -151,6 +378,66 @@ private:
 	 */
 	static void resetTimeoutRoutingNode(RouteNode* node);
 
+	/**
+	 * @brief Routing metric, LM_HOP_COUNT_METRIC, LM_SNR_METRIC or LM_ETX_METRIC
+	 *
+	 */
+	static uint8_t routingMetric;
+
+	/**
+	 * @brief Minimum improvement of the metric to change the next hop of a route, with the SNR and ETX metrics
+	 *
+	 */
+	static uint8_t routeHysteresis;
+
+	/**
+	 * @brief SNR in dB needed to receive the packets with the actual spreading factor
+	 *
+	 */
+	static int8_t demodulationFloor;
+
+	/**
+	 * @brief Get the cost of the link with a neighbor, between 1 and LM_MAX_LINK_COST
+	 *
+	 * @param address Address of the neighbor
+	 * @param receivedSNR SNR of the last packet received from the neighbor
+	 * @return uint8_t Cost of the link
+	 */
+	static uint8_t getLinkCost(uint16_t address, int8_t receivedSNR);
+
+	/**
+	 * @brief Remove the routes and alternatives through the next hop that its last advertisement of the whole routing table
+	 * did not contain. Their withdrawal could have been lost.
+	 *
+	 * @param via Next hop
+	 */
+	static void removeStaleRoutesVia(uint16_t via);
+
+	/**
+	 * @brief Remove the route to the address, only if its next hop is the node that withdraws it
+	 *
+	 * @param via Node that withdraws the route
+	 * @param address Address of the route
+	 */
+	static void withdrawRoute(uint16_t via, uint16_t address);
+
+	/**
+	 * @brief Check the sequence number of the route packet with the last one received from its source
+	 *
+	 * @param p Route Packet
+	 * @return true If all the route packets of the source have been received since its last advertisement of the whole routing table
+	 * @return false If not
+	 */
+	static bool processAdvertisementSequence(RoutePacket* p);
+
+	/**
+	 * @brief Set if the neighbor sends the route packets of the previous versions
+	 *
+	 * @param address Address of the neighbor
+	 * @param legacy True if the route packets are HELLO_P
+	 */
+	static void setLegacyNode(uint16_t address, bool legacy);
+
 	/**
 	 * @brief Add node to the routing table
 	 *
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Airtime used per frequency over a sliding window of one hour, split in buckets of one minute.
+ * The airtime of a bucket leaves the window when the whole bucket is older than one hour, so the budget is never exceeded.
+ *
+ */
+class LM_AirtimeLedger {
+public:
+    static constexpr uint32_t WINDOW_MS = 3600000;
+    static constexpr uint8_t NUM_BUCKETS = 60;
+    static constexpr uint32_t BUCKET_MS = WINDOW_MS / NUM_BUCKETS;
+    static constexpr uint32_t UNLIMITED = 0xFFFFFFFF;
+
+    /**
+     * @brief Set the duty cycle
+     *
+     * @param dutyCycle Percentage of the window that can be used to transmit. 100 or more disables the limit
+     */
+    void setDutyCycle(float dutyCycle) {
+        budget = dutyCycle >= 100 ? UNLIMITED : (uint32_t) (WINDOW_MS * dutyCycle / 100);
+    }
+
+    /**
+     * @brief Get the airtime that can be used in the window
+     *
+     * @return uint32_t budget in ms, UNLIMITED if there is no limit
+     */
+    uint32_t getBudget() { return budget; }
+
+    /**
+     * @brief Add the airtime of a sent frame
+     *
+     * @param freq Frequency of the frame
+     * @param airtime Time on air of the frame in ms
+     * @param now Actual time in ms
+     */
+    void record(float freq, uint32_t airtime, unsigned long now) {
+        uint32_t minute = getMinute(now);
+
+        portENTER_CRITICAL(&mux);
+
+        SubBand* subBand = getSubBand(freq, minute);
+        uint8_t bucket = minute % NUM_BUCKETS;
+
+        if (subBand->minutes[bucket] != minute) {
+            subBand->minutes[bucket] = minute;
+            subBand->airtime[bucket] = 0;
+        }
+
+        subBand->airtime[bucket] += airtime;
+        subBand->lastMinute = minute;
+
+        portEXIT_CRITICAL(&mux);
+    }
+
+    /**
+     * @brief Get the airtime used inside the window
+     *
+     * @param freq Frequency
+     * @param now Actual time in ms
+     * @return uint32_t used airtime in ms
+     */
+    uint32_t getUsed(float freq, unsigned long now) {
+        uint32_t minute = getMinute(now);
+
+        portENTER_CRITICAL(&mux);
+
+        uint32_t used = 0;
+        SubBand* subBand = findSubBand(freq);
+        if (subBand != nullptr) {
+            for (uint8_t i = 0; i < NUM_BUCKETS; i++) {
+                if (isInWindow(subBand->minutes[i], minute))
+                    used += subBand->airtime[i];
+            }
+        }
+
+        portEXIT_CRITICAL(&mux);
+
+        return used;
+    }
+
+    /**
+     * @brief Get the airtime that can still be used inside the window
+     *
+     * @param freq Frequency
+     * @param now Actual time in ms
+     * @return uint32_t remaining airtime in ms, UNLIMITED if there is no limit
+     */
+    uint32_t getRemaining(float freq, unsigned long now) {
+        if (budget == UNLIMITED)
+            return UNLIMITED;
+
+        uint32_t used = getUsed(freq, now);
+        return used >= budget ? 0 : budget - used;
+    }
+
+    /**
+     * @brief Get the earliest time a frame can be sent without exceeding the budget
+     *
+     * @param freq Frequency of the frame
+     * @param airtime Time on air of the frame in ms
+     * @param now Actual time in ms
+     * @return unsigned long time in ms, now if it can be sent immediately
+     */
+    unsigned long getEarliestSendTime(float freq, uint32_t airtime, unsigned long now) {
+        if (budget == UNLIMITED)
+            return now;
+
+        uint32_t used = getUsed(freq, now);
+        if (used + airtime <= budget)
+            return now;
+
+        uint32_t excess = used + airtime - budget;
+        uint32_t minute = getMinute(now);
+
+        portENTER_CRITICAL(&mux);
+
+        SubBand* subBand = findSubBand(freq);
+        uint32_t freed = 0;
+        uint32_t lastMinute = minute;
+
+        // Free the oldest buckets until the frame fits
+        for (uint32_t m = minute - NUM_BUCKETS + 1; subBand != nullptr && m <= minute; m++) {
+            uint8_t bucket = m % NUM_BUCKETS;
+            if (subBand->minutes[bucket] != m)
+                continue;
+
+            freed += subBand->airtime[bucket];
+            if (freed >= excess) {
+                lastMinute = m;
+                break;
+            }
+        }
+
+        portEXIT_CRITICAL(&mux);
+
+        // The bucket leaves the window when the actual minute is NUM_BUCKETS minutes later
+        return (unsigned long) lastMinute * BUCKET_MS;
+    }
+
+private:
+    struct SubBand {
+        float freq = 0;
+        uint32_t lastMinute = 0;
+        uint32_t minutes[NUM_BUCKETS] = {0};
+        uint16_t airtime[NUM_BUCKETS] = {0};
+    };
+
+    SubBand subBands[LM_MAX_SUB_BANDS];
+    uint8_t numSubBands = 0;
+    uint32_t budget = UNLIMITED;
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    // Minute 0 is reserved for the empty buckets
+    static uint32_t getMinute(unsigned long now) { return now / BUCKET_MS + NUM_BUCKETS; }
+
+    static bool isInWindow(uint32_t bucketMinute, uint32_t minute) {
+        return bucketMinute != 0 && bucketMinute + NUM_BUCKETS > minute;
+    }
+
+    SubBand* findSubBand(float freq) {
+        for (uint8_t i = 0; i < numSubBands; i++) {
+            if (subBands[i].freq == freq)
+                return &subBands[i];
+        }
+
+        return nullptr;
+    }
+
+    SubBand* getSubBand(float freq, uint32_t minute) {
+        SubBand* subBand = findSubBand(freq);
+        if (subBand != nullptr)
+            return subBand;
+
+        if (numSubBands < LM_MAX_SUB_BANDS)
+            subBand = &subBands[numSubBands++];
+        else {
+            // Reuse the sub-band used longest ago
+            subBand = &subBands[0];
+            for (uint8_t i = 1; i < numSubBands; i++) {
+                if (subBands[i].lastMinute < subBand->lastMinute)
+                    subBand = &subBands[i];
+            }
+        }
+
+        *subBand = SubBand();
+        subBand->freq = freq;
+        subBand->lastMinute = minute;
+        return subBand;
+    }
+};
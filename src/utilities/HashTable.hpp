@@ -0,0 +1,212 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+#include "RWLock.hpp"
+
+/**
+ * @brief Fixed capacity hash table. The elements are stored in a contiguous array and indexed by key
+ * with open addressing (linear probing and backward shift deletion).
+ * The elements never move inside the storage while they are in the table, the pointers remain valid until erased.
+ *
+ * @tparam K Type of the key, an unsigned integer
+ * @tparam T Type of the element, it needs a default constructor
+ * @tparam N Maximum number of elements
+ */
+template <typename K, class T, size_t N>
+class LM_HashTable {
+private:
+    static constexpr uint16_t EMPTY = 0xFFFF;
+    static_assert(N < EMPTY, "LM_HashTable capacity must be lower than 0xFFFF");
+
+    static constexpr uint8_t calculateIndexBits() {
+        uint8_t bits = 1;
+        while ((size_t(1) << bits) < N * 2)
+            bits++;
+        return bits;
+    }
+
+    // The index has at least twice the slots of the capacity, to maintain short probe sequences
+    static constexpr uint8_t INDEX_BITS = calculateIndexBits();
+    static constexpr size_t INDEX_SIZE = size_t(1) << INDEX_BITS;
+    static constexpr size_t INDEX_MASK = INDEX_SIZE - 1;
+
+    K keys[INDEX_SIZE];
+    uint16_t slots[INDEX_SIZE];
+
+    T items[N];
+    K itemKeys[N];
+
+    // Dense list of the used storage positions, used to iterate the elements
+    uint16_t dense[N];
+    uint16_t densePosition[N];
+    size_t length = 0;
+
+    uint16_t freeStack[N];
+    size_t numFree = N;
+
+    LM_RWLock lock;
+
+    static size_t hash(K key) {
+        return (uint32_t(key) * 2654435761u) >> (32 - INDEX_BITS);
+    }
+
+    size_t findBucket(K key) const {
+        size_t i = hash(key);
+        while (slots[i] != EMPTY) {
+            if (keys[i] == key)
+                return i;
+            i = (i + 1) & INDEX_MASK;
+        }
+        return INDEX_SIZE;
+    }
+
+public:
+    class Iterator {
+    public:
+        Iterator(LM_HashTable* table, size_t position): table(table), position(position) {}
+        T& operator*() const { return *table->at(position); }
+        T* operator->() const { return table->at(position); }
+        Iterator& operator++() { position++; return *this; }
+        bool operator!=(const Iterator& other) const { return position != other.position; }
+    private:
+        LM_HashTable* table;
+        size_t position;
+    };
+
+    LM_HashTable() {
+        for (size_t i = 0; i < INDEX_SIZE; i++)
+            slots[i] = EMPTY;
+
+        for (size_t i = 0; i < N; i++)
+            freeStack[i] = N - 1 - i;
+    }
+
+    /**
+     * @brief Find the element with the key
+     *
+     * @param key Key of the element
+     * @return T* element or nullptr if not found
+     */
+    T* find(K key) {
+        size_t bucket = findBucket(key);
+        if (bucket == INDEX_SIZE)
+            return nullptr;
+
+        return &items[slots[bucket]];
+    }
+
+    /**
+     * @brief Insert a default element with the key. If the key already exists, returns the existing element
+     *
+     * @param key Key of the element
+     * @return T* element or nullptr if the table is full
+     */
+    T* insert(K key) {
+        size_t i = hash(key);
+        while (slots[i] != EMPTY) {
+            if (keys[i] == key)
+                return &items[slots[i]];
+            i = (i + 1) & INDEX_MASK;
+        }
+
+        if (numFree == 0)
+            return nullptr;
+
+        uint16_t position = freeStack[--numFree];
+        keys[i] = key;
+        slots[i] = position;
+
+        itemKeys[position] = key;
+        items[position] = T();
+
+        densePosition[position] = length;
+        dense[length++] = position;
+
+        return &items[position];
+    }
+
+    /**
+     * @brief Erase the element with the key. It will move the last element of the iteration order to the erased position
+     *
+     * @param key Key of the element
+     * @return true If the element has been erased
+     */
+    bool erase(K key) {
+        size_t i = findBucket(key);
+        if (i == INDEX_SIZE)
+            return false;
+
+        uint16_t position = slots[i];
+
+        // Backward shift the following entries of the probe sequence
+        size_t j = i;
+        for (;;) {
+            j = (j + 1) & INDEX_MASK;
+            if (slots[j] == EMPTY)
+                break;
+
+            size_t home = hash(keys[j]);
+            if (((j - home) & INDEX_MASK) >= ((j - i) & INDEX_MASK)) {
+                keys[i] = keys[j];
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = EMPTY;
+
+        // Remove it from the dense list
+        uint16_t densePos = densePosition[position];
+        uint16_t last = dense[--length];
+        dense[densePos] = last;
+        densePosition[last] = densePos;
+
+        items[position] = T();
+        freeStack[numFree++] = position;
+
+        return true;
+    }
+
+    /**
+     * @brief Get the element in the iteration position
+     *
+     * @param position Position from 0 to size() - 1
+     * @return T* element
+     */
+    T* at(size_t position) { return &items[dense[position]]; }
+
+    /**
+     * @brief Get the key of the element in the iteration position
+     *
+     * @param position Position from 0 to size() - 1
+     * @return K key
+     */
+    K keyAt(size_t position) const { return itemKeys[dense[position]]; }
+
+    size_t size() const { return length; }
+
+    size_t capacity() const { return N; }
+
+    bool isFull() const { return numFree == 0; }
+
+    void clear() {
+        while (length > 0)
+            erase(keyAt(length - 1));
+    }
+
+    Iterator begin() { return Iterator(this, 0); }
+
+    Iterator end() { return Iterator(this, length); }
+
+    void setInUse() { lock.writeLock(); }
+
+    void releaseInUse() { lock.writeUnlock(); }
+
+    /**
+     * @brief Hold the table shared with other readers, it cannot be modified while it is held
+     *
+     */
+    void setInRead() { lock.readLock(); }
+
+    void releaseInRead() { lock.readUnlock(); }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Histogram of latencies in ms with buckets of powers of two.
+ * The bucket i counts the latencies lower than 2^i ms, the last bucket counts the rest.
+ *
+ */
+class LM_LatencyHistogram {
+public:
+    static constexpr uint8_t NUM_BUCKETS = 16;
+
+    /**
+     * @brief Add a latency
+     *
+     * @param latency Latency in ms
+     */
+    void record(uint32_t latency) {
+        uint8_t bucket = 0;
+        while (bucket < NUM_BUCKETS - 1 && latency >= getBucketLimit(bucket))
+            bucket++;
+
+        portENTER_CRITICAL(&mux);
+
+        counts[bucket]++;
+        total++;
+        sum += latency;
+        if (latency > max)
+            max = latency;
+
+        portEXIT_CRITICAL(&mux);
+    }
+
+    /**
+     * @brief Get the number of latencies inside a bucket
+     *
+     * @param bucket Bucket, between 0 and NUM_BUCKETS - 1
+     * @return uint32_t
+     */
+    uint32_t getCount(uint8_t bucket) const { return bucket < NUM_BUCKETS ? counts[bucket] : 0; }
+
+    /**
+     * @brief Get the upper limit, not included, of the latencies inside a bucket
+     *
+     * @param bucket Bucket, the last one has no limit
+     * @return uint32_t limit in ms
+     */
+    static uint32_t getBucketLimit(uint8_t bucket) { return bucket < NUM_BUCKETS - 1 ? (uint32_t) 1 << bucket : UINT32_MAX; }
+
+    /**
+     * @brief Get the number of latencies
+     *
+     * @return uint32_t
+     */
+    uint32_t getTotal() const { return total; }
+
+    /**
+     * @brief Get the average latency
+     *
+     * @return uint32_t average in ms, 0 if there are no latencies
+     */
+    uint32_t getAverage() const { return total == 0 ? 0 : (uint32_t) (sum / total); }
+
+    /**
+     * @brief Get the maximum latency
+     *
+     * @return uint32_t maximum in ms
+     */
+    uint32_t getMax() const { return max; }
+
+    /**
+     * @brief Get the upper limit of the bucket that contains the percentile
+     *
+     * @param percentile Percentile, between 0 and 100
+     * @return uint32_t limit in ms, 0 if there are no latencies
+     */
+    uint32_t getPercentile(float percentile) const {
+        if (total == 0)
+            return 0;
+
+        uint32_t target = (uint32_t) (total * percentile / 100);
+        uint32_t accumulated = 0;
+
+        for (uint8_t i = 0; i < NUM_BUCKETS; i++) {
+            accumulated += counts[i];
+            if (accumulated > target || accumulated == total)
+                return i < NUM_BUCKETS - 1 ? getBucketLimit(i) : max;
+        }
+
+        return max;
+    }
+
+    /**
+     * @brief Remove all the latencies
+     *
+     */
+    void reset() {
+        portENTER_CRITICAL(&mux);
+
+        for (uint8_t i = 0; i < NUM_BUCKETS; i++)
+            counts[i] = 0;
+        total = 0;
+        sum = 0;
+        max = 0;
+
+        portEXIT_CRITICAL(&mux);
+    }
+
+private:
+    uint32_t counts[NUM_BUCKETS] = {0};
+    uint32_t total = 0;
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
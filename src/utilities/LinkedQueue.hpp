@@ -2,8 +2,12 @@
 
 //Inspired by: https://stackoverflow.com/questions/9986591/vectors-in-arduino#:~:text=You%20can%20write%20this%20LinkedList%20template%20class%20and%20simply%20call%20it%20wherever%20you%20want%20%3A
 
+#include <type_traits>
+
 #include "BuildOptions.h"
 
+#include "RWLock.hpp"
+
 template <class T>
 class LM_ListNode {
 public:
@@ -16,15 +20,101 @@ public:
     };
 };
 
+/**
+ * @brief Inherit from this class to store the list links inside the element itself.
+ * The lists will not allocate any node for these elements, but an element can only be inside one list at a time.
+ *
+ * @tparam T Type of the element
+ */
+template <class T>
+class LM_IntrusiveListNode {
+public:
+    T* prev = nullptr;
+    T* next = nullptr;
+};
+
+/**
+ * @brief Selects the node used by the lists. Elements that inherit from LM_IntrusiveListNode are their own node,
+ * other elements are wrapped inside a LM_ListNode allocated in the heap.
+ *
+ * @tparam T Type of the element
+ */
+template <class T>
+class LM_ListNodeTraits {
+public:
+    static constexpr bool isIntrusive = std::is_base_of<LM_IntrusiveListNode<T>, T>::value;
+
+    using Node = typename std::conditional<isIntrusive, T, LM_ListNode<T>>::type;
+
+    static Node* createNode(T* element, Node* prev, Node* next) {
+        if constexpr (isIntrusive) {
+            element->prev = prev;
+            element->next = next;
+            return element;
+        }
+        else
+            return new LM_ListNode<T>(element, prev, next);
+    }
+
+    static T* getElement(Node* node) {
+        if constexpr (isIntrusive)
+            return node;
+        else
+            return node->element;
+    }
+
+    static void deleteNode(Node* node) {
+        if constexpr (isIntrusive) {
+            node->prev = nullptr;
+            node->next = nullptr;
+        }
+        else
+            delete node;
+    }
+};
+
 template <class T>
 class LM_LinkedList {
 private:
+    using Traits = LM_ListNodeTraits<T>;
+    using Node = typename Traits::Node;
+
     size_t length;
-    LM_ListNode<T>* head;
-    LM_ListNode<T>* tail;
-    LM_ListNode<T>* curr;
-    SemaphoreHandle_t xSemaphore;
+    Node* head;
+    Node* tail;
+    Node* curr;
+    LM_RWLock lock;
+
+    /**
+     * @brief Intrusive lists created with the copy constructor own a copy of the elements,
+     * they are deleted with the list. It can be set with setOwnsElements.
+     *
+     */
+    bool ownsElements = false;
+
+    /**
+     * @brief Remove the current node from the list without deleting its element
+     *
+     * @return T* Element of the removed node, nullptr if the list is empty
+     */
+    T* detachCurrent();
 public:
+    /**
+     * @brief Iterator of the list. It is independent of the list cursor, so different tasks can iterate at the same time
+     * holding the list with setInRead.
+     *
+     */
+    class Iterator {
+    public:
+        Iterator(Node* node): node(node) {}
+        T& operator*() const { return *Traits::getElement(node); }
+        T* operator->() const { return Traits::getElement(node); }
+        Iterator& operator++() { node = node->next; return *this; }
+        bool operator!=(const Iterator& other) const { return node != other.node; }
+    private:
+        Node* node;
+    };
+
     LM_LinkedList();
     LM_LinkedList(LM_LinkedList<T>& list);
     ~LM_LinkedList();
@@ -34,6 +124,12 @@ public:
     T* operator[](int);
     size_t getLength();
     void Append(T*);
+
+    /**
+     * @brief Remove the first element of the list. It is not deleted even if the list owns the elements, the caller owns it
+     *
+     * @return T* First element, nullptr if the list is empty
+     */
     T* Pop();
     void addCurrent(T*);
     bool Search(T*);
@@ -44,7 +140,20 @@ public:
     void Clear();
     void setInUse();
     void releaseInUse();
+    void setInRead();
+    void releaseInRead();
     void each(void (*func)(T*));
+
+    Iterator begin() const { return Iterator(head); }
+
+    Iterator end() const { return Iterator(nullptr); }
+
+    /**
+     * @brief Set if the list owns the elements, the owned elements are deleted when they are removed from the list
+     *
+     * @param owns true if the list owns the elements
+     */
+    void setOwnsElements(bool owns) { ownsElements = owns; }
 };
 
 template <class T>
@@ -53,13 +162,6 @@ LM_LinkedList<T>::LM_LinkedList() {
     head = nullptr;
     tail = nullptr;
     curr = nullptr;
-
-    /* Attempt to create a semaphore. */
-    xSemaphore = xSemaphoreCreateMutex();
-
-    if (xSemaphore == NULL) {
-        ESP_LOGE(LM_TAG, "Semaphore in Linked List not created");
-    }
 }
 
 template<class T>
@@ -69,58 +171,51 @@ inline LM_LinkedList<T>::LM_LinkedList(LM_LinkedList<T>& list) {
     tail = nullptr;
     curr = nullptr;
 
-    /* Attempt to create a semaphore. */
-    xSemaphore = xSemaphoreCreateMutex();
-
-    if (xSemaphore == NULL) {
-        ESP_LOGE(LM_TAG, "Semaphore in Linked List not created");
-    }
 
+    list.setInRead();
 
-    list.setInUse();
+    // The elements of an intrusive list cannot be inside two lists, copy them
+    ownsElements = Traits::isIntrusive;
 
-    if (list.moveToStart()) {
-        do {
-            Append(list.getCurrent());
-        } while (list.next());
+    for (T& element : list) {
+        if constexpr (Traits::isIntrusive)
+            Append(new T(element));
+        else
+            Append(&element);
     }
 
-    list.releaseInUse();
+    list.releaseInRead();
 }
 
 
 template <class T>
 LM_LinkedList<T>::~LM_LinkedList() {
     Clear();
-    vSemaphoreDelete(xSemaphore);
 }
 
 template<class T>
 T* LM_LinkedList<T>::getCurrent() {
-    return curr ? curr->element : nullptr;
+    return curr ? Traits::getElement(curr) : nullptr;
 }
 
 template<class T>
 T* LM_LinkedList<T>::First() const {
-    return head ? head->element : nullptr;
+    return head ? Traits::getElement(head) : nullptr;
 }
 
 template<class T>
 T* LM_LinkedList<T>::Last() const {
-    return tail ? tail->element : nullptr;
+    return tail ? Traits::getElement(tail) : nullptr;
 }
 
 template <class T>
 T* LM_LinkedList<T>::operator[](int position) {
-    if (position < length && moveToStart()) {
-        int i = 0;
-        do {
-            if (i == position) {
-                return curr->element;
-            }
-
-            i++;
-        } while (next());
+    int i = 0;
+    for (T& element : *this) {
+        if (i == position)
+            return &element;
+
+        i++;
     }
 
     return NULL;
@@ -133,7 +228,7 @@ size_t LM_LinkedList<T>::getLength() {
 
 template <class T>
 void LM_LinkedList<T>::Append(T* element) {
-    LM_ListNode<T>* node = new LM_ListNode<T>(element, tail, nullptr);
+    Node* node = Traits::createNode(element, tail, nullptr);
 
     if (length == 0)
         curr = tail = head = node;
@@ -157,7 +252,7 @@ void LM_LinkedList<T>::addCurrent(T* element) {
 
     }
 
-    LM_ListNode<T>* node = new LM_ListNode<T>(element, curr->prev, curr);
+    Node* node = Traits::createNode(element, curr->prev, curr);
 
     if (curr->prev != nullptr) {
         curr->prev->next = node;
@@ -176,18 +271,14 @@ void LM_LinkedList<T>::addCurrent(T* element) {
 template<class T>
 T* LM_LinkedList<T>::Pop() {
     moveToStart();
-    T* element = getCurrent();
-    DeleteCurrent();
-    return element;
+    return detachCurrent();
 }
 
 template <class T>
 bool LM_LinkedList<T>::Search(T* elem) {
-    if (moveToStart()) {
-        do {
-            if (curr->element == elem)
-                return true;
-        } while (next());
+    for (T& element : *this) {
+        if (&element == elem)
+            return true;
     }
 
     return false;
@@ -225,10 +316,18 @@ bool LM_LinkedList<T>::prev() {
 
 template <class T>
 void LM_LinkedList<T>::DeleteCurrent() {
+    T* element = detachCurrent();
+
+    if (ownsElements)
+        delete element;
+}
+
+template <class T>
+T* LM_LinkedList<T>::detachCurrent() {
     if (length == 0)
-        return;
+        return nullptr;
     length--;
-    LM_ListNode<T>* temp = curr;
+    Node* temp = curr;
 
     if (temp->prev != nullptr)
         temp->prev->next = temp->next;
@@ -247,18 +346,29 @@ void LM_LinkedList<T>::DeleteCurrent() {
     else
         curr = curr->next;
 
-    delete temp;
+    T* element = Traits::getElement(temp);
+
+    Traits::deleteNode(temp);
+
+    return element;
 }
 
 template <class T>
 void LM_LinkedList<T>::Clear() {
     if (length == 0)
         return;
-    LM_ListNode<T>* temp = head;
+    Node* temp = head;
 
     while (temp != nullptr) {
         head = head->next;
-        delete temp;
+
+        T* element = Traits::getElement(temp);
+
+        Traits::deleteNode(temp);
+
+        if (ownsElements)
+            delete element;
+
         temp = head;
     }
 
@@ -269,25 +379,30 @@ void LM_LinkedList<T>::Clear() {
 
 template <class T>
 void LM_LinkedList<T>::setInUse() {
-    while (xSemaphoreTake(xSemaphore, (TickType_t) 10) != pdTRUE) {
-        ESP_LOGW(LM_TAG, "List in Use Alert");
-    }
+    lock.writeLock();
 }
 
 template <class T>
 void LM_LinkedList<T>::releaseInUse() {
-    xSemaphoreGive(xSemaphore);
+    lock.writeUnlock();
+}
+
+template <class T>
+void LM_LinkedList<T>::setInRead() {
+    lock.readLock();
+}
+
+template <class T>
+void LM_LinkedList<T>::releaseInRead() {
+    lock.readUnlock();
 }
 
 template <class T>
 void LM_LinkedList<T>::each(void (*func)(T*)) {
-    setInUse();
+    setInRead();
 
-    if (moveToStart()) {
-        do {
-            func(curr->element);
-        } while (next());
-    }
+    for (T& element : *this)
+        func(&element);
 
-    releaseInUse();
+    releaseInRead();
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Inherit from this class to store the position of the element inside a LM_MinHeap.
+ * An element can only be inside one heap at a time.
+ *
+ */
+class LM_HeapNode {
+public:
+    static constexpr uint16_t NOT_IN_HEAP = 0xFFFF;
+
+    uint16_t heapIndex = NOT_IN_HEAP;
+};
+
+/**
+ * @brief Fixed capacity indexed binary min-heap. The elements know their position inside the heap,
+ * so they can be updated or removed in O(log n) without searching them.
+ *
+ * @tparam T Type of the element, it needs to inherit from LM_HeapNode and have a getHeapKey() function
+ * @tparam N Maximum number of elements
+ */
+template <class T, size_t N>
+class LM_MinHeap {
+private:
+    static_assert(N < LM_HeapNode::NOT_IN_HEAP, "LM_MinHeap capacity must be lower than 0xFFFF");
+
+    T* elements[N];
+    size_t length = 0;
+    SemaphoreHandle_t xSemaphore;
+
+    bool isLower(size_t i, size_t j) const {
+        return elements[i]->getHeapKey() < elements[j]->getHeapKey();
+    }
+
+    void swap(size_t i, size_t j) {
+        T* temp = elements[i];
+        elements[i] = elements[j];
+        elements[j] = temp;
+        elements[i]->heapIndex = i;
+        elements[j]->heapIndex = j;
+    }
+
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!isLower(i, parent))
+                break;
+
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i) {
+        for (;;) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+
+            if (left < length && isLower(left, smallest))
+                smallest = left;
+            if (right < length && isLower(right, smallest))
+                smallest = right;
+
+            if (smallest == i)
+                break;
+
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+public:
+    LM_MinHeap() {
+        /* Attempt to create a semaphore. */
+        xSemaphore = xSemaphoreCreateMutex();
+
+        if (xSemaphore == NULL) {
+            ESP_LOGE(LM_TAG, "Semaphore in Min Heap not created");
+        }
+    }
+
+    ~LM_MinHeap() {
+        vSemaphoreDelete(xSemaphore);
+    }
+
+    /**
+     * @brief Add the element to the heap. If the element is already inside the heap, its position is updated with the actual key
+     *
+     * @param element Element to be added
+     * @return true If the element is inside the heap
+     * @return false If the heap is full
+     */
+    bool push(T* element) {
+        if (element->heapIndex != LM_HeapNode::NOT_IN_HEAP) {
+            siftUp(element->heapIndex);
+            siftDown(element->heapIndex);
+            return true;
+        }
+
+        if (length == N)
+            return false;
+
+        element->heapIndex = length;
+        elements[length++] = element;
+        siftUp(element->heapIndex);
+        return true;
+    }
+
+    /**
+     * @brief Remove the element from the heap, if it is inside
+     *
+     * @param element Element to be removed
+     */
+    void remove(T* element) {
+        size_t i = element->heapIndex;
+        if (i == LM_HeapNode::NOT_IN_HEAP)
+            return;
+
+        length--;
+        if (i != length) {
+            swap(i, length);
+            siftUp(i);
+            siftDown(i);
+        }
+
+        element->heapIndex = LM_HeapNode::NOT_IN_HEAP;
+    }
+
+    /**
+     * @brief Get the element with the lowest key
+     *
+     * @return T* element or nullptr if the heap is empty
+     */
+    T* top() const {
+        return length > 0 ? elements[0] : nullptr;
+    }
+
+    /**
+     * @brief Remove and return the element with the lowest key
+     *
+     * @return T* element or nullptr if the heap is empty
+     */
+    T* pop() {
+        T* element = top();
+        if (element != nullptr)
+            remove(element);
+
+        return element;
+    }
+
+    size_t size() const { return length; }
+
+    void setInUse() {
+        while (xSemaphoreTake(xSemaphore, (TickType_t) 10) != pdTRUE) {
+            ESP_LOGW(LM_TAG, "Min Heap in Use Alert");
+        }
+    }
+
+    void releaseInUse() {
+        xSemaphoreGive(xSemaphore);
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Pool of fixed-size packet buffers, preallocated in a single slab.
+ * Allocate and release are O(1) and lock-free, the free buffers are kept inside a tagged index stack.
+ * When the pool is exhausted or the requested size is greater than the buffer size it falls back to the heap.
+ *
+ */
+class LM_PacketPool {
+public:
+    /**
+     * @brief Get the Instance of the Packet Pool
+     *
+     * @return LM_PacketPool&
+     */
+    static LM_PacketPool& getInstance() {
+        static LM_PacketPool instance;
+        return instance;
+    }
+
+    /**
+     * @brief Allocate the slab of the pool. If there are buffers in use, the previous slab is maintained.
+     *
+     * @param size Size of every buffer in bytes, normally the max packet size
+     * @param numberOfBuffers Number of buffers of the pool
+     */
+    void init(size_t size, size_t numberOfBuffers) {
+        // Round the size to keep the buffers aligned
+        size = (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+
+        if (numberOfBuffers > MAX_BUFFERS)
+            numberOfBuffers = MAX_BUFFERS;
+
+        if (slab != nullptr) {
+            if (size == bufferSize && numberOfBuffers == numBuffers)
+                return;
+
+            if (used.load() != 0) {
+                ESP_LOGW(LM_TAG, "Packet pool has buffers in use, maintaining the previous pool");
+                return;
+            }
+
+            vPortFree(slab);
+            vPortFree(nextFree);
+            slab = nullptr;
+            nextFree = nullptr;
+            numBuffers = 0;
+            freeHead.store(EMPTY);
+        }
+
+        if (numberOfBuffers == 0)
+            return;
+
+        uint8_t* newSlab = static_cast<uint8_t*>(pvPortMalloc(size * numberOfBuffers));
+        std::atomic<uint16_t>* newNextFree = static_cast<std::atomic<uint16_t>*>(pvPortMalloc(sizeof(std::atomic<uint16_t>) * numberOfBuffers));
+
+        if (newSlab == nullptr || newNextFree == nullptr) {
+            ESP_LOGE(LM_TAG, "Packet pool not allocated");
+            vPortFree(newSlab);
+            vPortFree(newNextFree);
+            return;
+        }
+
+        for (size_t i = 0; i < numberOfBuffers; i++)
+            new (&newNextFree[i]) std::atomic<uint16_t>(i + 1 < numberOfBuffers ? i + 1 : EMPTY);
+
+        bufferSize = size;
+        numBuffers = numberOfBuffers;
+        nextFree = newNextFree;
+        slab = newSlab;
+        freeHead.store(0);
+
+        ESP_LOGI(LM_TAG, "Packet pool created with %d buffers of %d bytes", (int) numBuffers, (int) bufferSize);
+    }
+
+    /**
+     * @brief Allocate a buffer of the pool, or from the heap if the pool is exhausted or the size is greater than the buffer size
+     *
+     * @param size Size in bytes
+     * @return void* Buffer or nullptr if it cannot be allocated
+     */
+    void* allocate(size_t size) {
+        if (slab != nullptr && size > bufferSize) {
+            oversized.fetch_add(1, std::memory_order_relaxed);
+            return pvPortMalloc(size);
+        }
+
+        if (slab != nullptr) {
+            uint32_t head = freeHead.load(std::memory_order_acquire);
+            uint16_t index;
+            uint32_t newHead;
+
+            do {
+                index = head & EMPTY;
+                if (index == EMPTY)
+                    break;
+
+                newHead = (((head >> 16) + 1) << 16) | nextFree[index].load(std::memory_order_relaxed);
+            } while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire));
+
+            if (index != EMPTY) {
+                updatePeak(used.fetch_add(1, std::memory_order_relaxed) + 1);
+                return slab + index * bufferSize;
+            }
+        }
+
+        fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return pvPortMalloc(size);
+    }
+
+    /**
+     * @brief Release a buffer, returning it to the pool or to the heap
+     *
+     * @param p Buffer to release
+     */
+    void release(void* p) {
+        if (p == nullptr)
+            return;
+
+        if (!isFromPool(p)) {
+            vPortFree(p);
+            return;
+        }
+
+        // Before returning the buffer, so the buffers in use never exceed the size of the pool
+        used.fetch_sub(1, std::memory_order_relaxed);
+
+        uint16_t index = (static_cast<uint8_t*>(p) - slab) / bufferSize;
+        uint32_t head = freeHead.load(std::memory_order_relaxed);
+        uint32_t newHead;
+
+        do {
+            nextFree[index].store(head & EMPTY, std::memory_order_relaxed);
+            newHead = (((head >> 16) + 1) << 16) | index;
+        } while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Returns if the buffer is inside the slab of the pool
+     *
+     * @param p Buffer
+     * @return true If the buffer is from the pool
+     */
+    bool isFromPool(void* p) {
+        uint8_t* b = static_cast<uint8_t*>(p);
+        return slab != nullptr && b >= slab && b < slab + bufferSize * numBuffers;
+    }
+
+    /**
+     * @brief Get the number of buffers of the pool
+     *
+     * @return size_t
+     */
+    size_t getSize() { return numBuffers; }
+
+    /**
+     * @brief Get the size of every buffer in bytes
+     *
+     * @return size_t
+     */
+    size_t getBufferSize() { return bufferSize; }
+
+    /**
+     * @brief Get the number of buffers in use
+     *
+     * @return uint32_t
+     */
+    uint32_t getUsed() { return used.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the maximum number of buffers used at the same time
+     *
+     * @return uint32_t
+     */
+    uint32_t getPeak() { return peak.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the number of allocations that have been done in the heap because the pool was exhausted or not created
+     *
+     * @return uint32_t
+     */
+    uint32_t getFallbacks() { return fallbacks.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the number of allocations that have been done in the heap because the size was greater than the buffer size
+     *
+     * @return uint32_t
+     */
+    uint32_t getOversized() { return oversized.load(std::memory_order_relaxed); }
+
+private:
+    LM_PacketPool() {}
+
+    static constexpr uint16_t EMPTY = 0xFFFF;
+    static constexpr size_t MAX_BUFFERS = EMPTY;
+
+    uint8_t* slab = nullptr;
+    std::atomic<uint16_t>* nextFree = nullptr;
+    size_t bufferSize = 0;
+    size_t numBuffers = 0;
+
+    /**
+     * @brief Head of the free stack. Lower 16 bits are the index of the buffer, upper 16 bits a tag to prevent ABA
+     *
+     */
+    std::atomic<uint32_t> freeHead{EMPTY};
+
+    std::atomic<uint32_t> used{0};
+    std::atomic<uint32_t> peak{0};
+    std::atomic<uint32_t> fallbacks{0};
+    std::atomic<uint32_t> oversized{0};
+
+    void updatePeak(uint32_t current) {
+        uint32_t previous = peak.load(std::memory_order_relaxed);
+        while (current > previous && !peak.compare_exchange_weak(previous, current, std::memory_order_relaxed)) {}
+    }
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+#include "LinkedQueue.hpp"
+
+static_assert(MAX_PRIORITY < 64, "LM_PriorityQueue uses a 64 bit mask, MAX_PRIORITY must be lower than 64");
+
+/**
+ * @brief Priority queue with one FIFO per priority level, from 0 to MAX_PRIORITY.
+ * The element with the greatest priority is popped first. Elements with the same priority keep the FIFO order.
+ * Push and Pop are O(1), the non-empty levels are tracked inside a bit mask.
+ * Elements that inherit from LM_IntrusiveListNode are linked without allocating any node.
+ *
+ * @tparam T Type of the element, it needs a priority field
+ */
+template <class T>
+class LM_PriorityQueue {
+private:
+    using Traits = LM_ListNodeTraits<T>;
+    using Node = typename Traits::Node;
+
+    struct Bucket {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+    };
+
+    Bucket buckets[MAX_PRIORITY + 1];
+    uint64_t nonEmptyMask;
+    size_t length;
+    SemaphoreHandle_t xSemaphore;
+
+    static uint8_t getBucketIndex(T* element) {
+        return element->priority > MAX_PRIORITY ? MAX_PRIORITY : element->priority;
+    }
+
+    int8_t getHighestBucket() const {
+        if (nonEmptyMask == 0)
+            return -1;
+
+        return 63 - __builtin_clzll(nonEmptyMask);
+    }
+
+public:
+    LM_PriorityQueue();
+    ~LM_PriorityQueue();
+    size_t getLength();
+    void Push(T*);
+    T* Pop();
+    T* First() const;
+    template <class Predicate>
+    T* Extract(Predicate match);
+    void Clear();
+    void setInUse();
+    void releaseInUse();
+};
+
+template <class T>
+LM_PriorityQueue<T>::LM_PriorityQueue() {
+    length = 0;
+    nonEmptyMask = 0;
+
+    /* Attempt to create a semaphore. */
+    xSemaphore = xSemaphoreCreateMutex();
+
+    if (xSemaphore == NULL) {
+        ESP_LOGE(LM_TAG, "Semaphore in Priority Queue not created");
+    }
+}
+
+template <class T>
+LM_PriorityQueue<T>::~LM_PriorityQueue() {
+    Clear();
+    vSemaphoreDelete(xSemaphore);
+}
+
+template <class T>
+size_t LM_PriorityQueue<T>::getLength() {
+    return length;
+}
+
+template <class T>
+void LM_PriorityQueue<T>::Push(T* element) {
+    uint8_t index = getBucketIndex(element);
+    Bucket* bucket = &buckets[index];
+
+    Node* node = Traits::createNode(element, bucket->tail, nullptr);
+
+    if (bucket->tail == nullptr)
+        bucket->head = node;
+    else
+        bucket->tail->next = node;
+
+    bucket->tail = node;
+    nonEmptyMask |= (1ULL << index);
+
+    length++;
+}
+
+template <class T>
+T* LM_PriorityQueue<T>::Pop() {
+    int8_t index = getHighestBucket();
+    if (index < 0)
+        return nullptr;
+
+    Bucket* bucket = &buckets[index];
+    Node* node = bucket->head;
+
+    bucket->head = node->next;
+    if (bucket->head == nullptr) {
+        bucket->tail = nullptr;
+        nonEmptyMask &= ~(1ULL << index);
+    }
+    else
+        bucket->head->prev = nullptr;
+
+    length--;
+
+    T* element = Traits::getElement(node);
+    Traits::deleteNode(node);
+    return element;
+}
+
+template <class T>
+T* LM_PriorityQueue<T>::First() const {
+    int8_t index = getHighestBucket();
+    if (index < 0)
+        return nullptr;
+
+    return Traits::getElement(buckets[index].head);
+}
+
+/**
+ * @brief Remove and return the first element that matches, from the greatest priority to the lowest
+ *
+ * @param match Function that returns true for the element to be removed
+ * @return T* element or nullptr if no element matches
+ */
+template <class T>
+template <class Predicate>
+T* LM_PriorityQueue<T>::Extract(Predicate match) {
+    for (int8_t index = getHighestBucket(); index >= 0; index--) {
+        Bucket* bucket = &buckets[index];
+
+        for (Node* node = bucket->head; node != nullptr; node = node->next) {
+            T* element = Traits::getElement(node);
+            if (!match(element))
+                continue;
+
+            if (node->prev == nullptr)
+                bucket->head = node->next;
+            else
+                node->prev->next = node->next;
+
+            if (node->next == nullptr)
+                bucket->tail = node->prev;
+            else
+                node->next->prev = node->prev;
+
+            if (bucket->head == nullptr)
+                nonEmptyMask &= ~(1ULL << index);
+
+            length--;
+
+            Traits::deleteNode(node);
+            return element;
+        }
+    }
+
+    return nullptr;
+}
+
+template <class T>
+void LM_PriorityQueue<T>::Clear() {
+    for (uint8_t i = 0; i <= MAX_PRIORITY; i++) {
+        Node* temp = buckets[i].head;
+
+        while (temp != nullptr) {
+            Node* next = temp->next;
+            Traits::deleteNode(temp);
+            temp = next;
+        }
+
+        buckets[i].head = buckets[i].tail = nullptr;
+    }
+
+    nonEmptyMask = 0;
+    length = 0;
+}
+
+template <class T>
+void LM_PriorityQueue<T>::setInUse() {
+    while (xSemaphoreTake(xSemaphore, (TickType_t) 10) != pdTRUE) {
+        ESP_LOGW(LM_TAG, "Priority Queue in Use Alert");
+    }
+}
+
+template <class T>
+void LM_PriorityQueue<T>::releaseInUse() {
+    xSemaphoreGive(xSemaphore);
+}
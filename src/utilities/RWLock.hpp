@@ -0,0 +1,93 @@
+#pragma once
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Reader/writer lock. Many readers can hold the lock at the same time, writers hold it exclusively.
+ * A waiting writer closes the turnstile, so new readers wait behind it and the writers are not starved.
+ * The resource is a mutex only held by the writers and by the readers while they update the number of readers,
+ * so a writer inherits the priority of the tasks waiting for it.
+ * It is not recursive, a task holding the lock must not take it again, neither to read nor to write.
+ *
+ */
+class LM_RWLock {
+public:
+    LM_RWLock() {
+        turnstile = xSemaphoreCreateMutex();
+        resource = xSemaphoreCreateMutex();
+        // Given by the last reader, that could be a different task than the writer waiting for it
+        readersDone = xSemaphoreCreateBinary();
+
+        if (turnstile == NULL || resource == NULL || readersDone == NULL) {
+            ESP_LOGE(LM_TAG, "Semaphores in RW Lock not created");
+        }
+    }
+
+    ~LM_RWLock() {
+        vSemaphoreDelete(turnstile);
+        vSemaphoreDelete(resource);
+        vSemaphoreDelete(readersDone);
+    }
+
+    /**
+     * @brief Take the lock shared with other readers
+     *
+     */
+    void readLock() {
+        take(turnstile);
+        take(resource);
+        readers++;
+        xSemaphoreGive(resource);
+        xSemaphoreGive(turnstile);
+    }
+
+    /**
+     * @brief Release the shared lock
+     *
+     */
+    void readUnlock() {
+        take(resource);
+        if (--readers == 0)
+            xSemaphoreGive(readersDone);
+        xSemaphoreGive(resource);
+    }
+
+    /**
+     * @brief Take the lock exclusively
+     *
+     */
+    void writeLock() {
+        take(turnstile);
+        take(resource);
+
+        // Wait for the readers inside, the new ones wait in the turnstile
+        while (readers > 0) {
+            xSemaphoreGive(resource);
+            if (xSemaphoreTake(readersDone, (TickType_t) 10) != pdTRUE)
+                ESP_LOGW(LM_TAG, "Lock in Use Alert");
+            take(resource);
+        }
+
+        xSemaphoreGive(turnstile);
+    }
+
+    /**
+     * @brief Release the exclusive lock
+     *
+     */
+    void writeUnlock() {
+        xSemaphoreGive(resource);
+    }
+
+private:
+    SemaphoreHandle_t turnstile;
+    SemaphoreHandle_t resource;
+    SemaphoreHandle_t readersDone;
+    uint16_t readers = 0;
+
+    static void take(SemaphoreHandle_t semaphore) {
+        while (xSemaphoreTake(semaphore, (TickType_t) 10) != pdTRUE) {
+            ESP_LOGW(LM_TAG, "Lock in Use Alert");
+        }
+    }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+
+#include "BuildOptions.h"
+
+/**
+ * @brief Slot of the received frames ring. It contains the raw frame and the radio metrics of the frame.
+ *
+ */
+class LM_ReceivedFrame {
+public:
+    size_t length = 0;
+    int8_t rssi = 0;
+    int8_t snr = 0;
+    unsigned long receivedTime = 0;
+    uint8_t data[];
+};
+
+/**
+ * @brief Single producer single consumer ring of preallocated received frames.
+ * The producer and the consumer only synchronize through the atomic indexes, it never allocates nor locks.
+ *
+ */
+class LM_ReceivedFrameRing {
+public:
+    /**
+     * @brief Construct a new ring with the capacity rounded up to a power of two
+     *
+     * @param capacity Number of slots of the ring
+     * @param frameSize Maximum size in bytes of every frame
+     */
+    LM_ReceivedFrameRing(size_t capacity, size_t frameSize) {
+        size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+
+        // Round the slot size to keep the slots aligned
+        stride = (sizeof(LM_ReceivedFrame) + frameSize + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+        maxFrameSize = frameSize;
+
+        slots = static_cast<uint8_t*>(pvPortMalloc(stride * cap));
+        if (slots == nullptr) {
+            ESP_LOGE(LM_TAG, "Received frames ring not allocated");
+            cap = 0;
+        }
+
+        mask = cap - 1;
+        capacity_ = cap;
+    }
+
+    ~LM_ReceivedFrameRing() {
+        vPortFree(slots);
+    }
+
+    /**
+     * @brief Producer. Get the next free slot to write a frame
+     *
+     * @return LM_ReceivedFrame* free slot or nullptr if the ring is full
+     */
+    LM_ReceivedFrame* acquireWrite() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity_)
+            return nullptr;
+
+        return getSlot(h);
+    }
+
+    /**
+     * @brief Producer. Publish the slot returned by acquireWrite
+     *
+     */
+    void commitWrite() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Consumer. Get the oldest frame of the ring
+     *
+     * @return LM_ReceivedFrame* oldest frame or nullptr if the ring is empty
+     */
+    LM_ReceivedFrame* peekRead() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return nullptr;
+
+        return getSlot(t);
+    }
+
+    /**
+     * @brief Consumer. Release the slot returned by peekRead
+     *
+     */
+    void commitRead() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Get the number of frames inside the ring
+     *
+     * @return size_t
+     */
+    size_t getLength() {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the capacity of the ring
+     *
+     * @return size_t
+     */
+    size_t getCapacity() { return capacity_; }
+
+    /**
+     * @brief Get the maximum frame size of every slot
+     *
+     * @return size_t
+     */
+    size_t getMaxFrameSize() { return maxFrameSize; }
+
+private:
+    uint8_t* slots = nullptr;
+    size_t stride = 0;
+    size_t mask = 0;
+    size_t capacity_ = 0;
+    size_t maxFrameSize = 0;
+
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+
+    LM_ReceivedFrame* getSlot(size_t index) {
+        return reinterpret_cast<LM_ReceivedFrame*>(slots + (index & mask) * stride);
+    }
+};
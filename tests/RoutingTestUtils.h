@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <esp_timer.h>
+
+#include "services/PacketService.h"
+#include "services/RoutingTableService.h"
+
+// Helpers to feed route packets of fake neighbors to the routing table of the local node, address 1
+
+/**
+ * @brief Create and process a route packet of a neighbor
+ *
+ * @param src Address of the neighbor
+ * @param seq Advertisement sequence number
+ * @param flags Route advertisement flags
+ * @param nodes Routes of the packet, as they are in memory
+ * @param snr SNR of the received packet
+ * @param links Link qualities of the packet
+ * @return true If route packets of the neighbor have been lost
+ */
+inline bool lmReceiveRoutes(uint16_t src, uint8_t seq, uint8_t flags, std::vector<NetworkNode> nodes = {}, int8_t snr = 10,
+    std::vector<LinkQuality> links = {}) {
+    RoutePacket* p = PacketService::createRoutingPacket(src, reinterpret_cast<uint8_t*>(nodes.data()), nodes.size() * sizeof(NetworkNode),
+        ROLE_DEFAULT, seq, flags, links.data(), links.size());
+
+    bool lost = RoutingTableService::processRoute(p, snr);
+
+    LM_PacketPool::getInstance().release(p);
+    return lost;
+}
+
+/**
+ * @brief Advance the clock and remove the expired routes
+ *
+ * @param ms Milliseconds
+ */
+inline void lmAdvanceRoutes(uint32_t ms) {
+    lmShimAdvanceTime(ms);
+    RoutingTableService::manageTimeoutRoutingTable();
+    RoutingTableService::dispatchRemovedRoutes();
+}
+
+/**
+ * @brief Expire all the routes, the next scenario starts with an empty routing table
+ *
+ */
+inline void lmClearRoutes() {
+    lmAdvanceRoutes(2 * DEFAULT_TIMEOUT * 1000);
+}
+
+/**
+ * @brief Get the metric of the route to the address
+ *
+ * @param address Address of the route
+ * @return uint8_t Metric, 0 if there is no route
+ */
+inline uint8_t lmRouteMetric(uint16_t address) {
+    return RoutingTableService::getNumberOfHops(address);
+}
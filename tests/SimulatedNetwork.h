@@ -0,0 +1,235 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <RadioLib.h>
+#include <esp_timer.h>
+#include <hal/efuse_hal.h>
+
+#include "LoraMesher.h"
+
+// Network of LoRaMesher nodes over the simulated radio of the RadioLib shim. LoRaMesher is a singleton, every node runs inside its
+// own process and this process relays the frames between the nodes with a link, dropping them with the loss ratio of the link.
+// The Results are shared by all the processes, the nodes write them and the checks read them.
+
+template <class Results>
+class LmSimulatedNetwork {
+public:
+    /**
+     * @brief Create a network without links, the nodes have the addresses from 1 to numOfNodes
+     *
+     * @param numOfNodes_ Number of nodes
+     * @param timeScale Speed of the clock of the nodes, the delays of LoRaMesher and the time on air wait the scaled time
+     */
+    LmSimulatedNetwork(size_t numOfNodes_, uint32_t timeScale = 10): numOfNodes(numOfNodes_), links(numOfNodes_ * numOfNodes_) {
+        lmShimSetTimeScale(timeScale);
+
+        void* shared = mmap(nullptr, sizeof(Results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        results = new (shared) Results();
+    }
+
+    ~LmSimulatedNetwork() {
+        results->~Results();
+        munmap(results, sizeof(Results));
+    }
+
+    /**
+     * @brief Link two nodes, in both directions
+     *
+     * @param a Address of a node
+     * @param b Address of the other node
+     * @param loss Ratio of the frames lost
+     * @param snr SNR of the received frames
+     */
+    void link(uint16_t a, uint16_t b, double loss = 0, int8_t snr = 10) {
+        links[index(a, b)] = Link{true, loss, snr};
+        links[index(b, a)] = Link{true, loss, snr};
+    }
+
+    /**
+     * @brief Run the network until finished returns true or the timeout. Every node runs node(address, results) inside its own
+     * process, the function can run forever. The processes are killed at the end
+     *
+     * @param node Function of the nodes
+     * @param finished Function called with the results until it returns true
+     * @param timeout Timeout in real ms
+     * @return true Finished before the timeout
+     */
+    bool run(std::function<void(uint16_t, Results&)> node, std::function<bool(Results&)> finished, uint32_t timeout) {
+        std::vector<int> sockets;
+        std::vector<pid_t> processes;
+
+        for (size_t i = 0; i < numOfNodes; i++) {
+            int pair[2];
+            socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair);
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                for (int socket : sockets)
+                    close(socket);
+                close(pair[0]);
+
+                uint16_t address = i + 1;
+                lmShimSetLocalAddress(address);
+                lmShimSetRadioSocket(pair[1]);
+
+                node(address, *results);
+                for (;;)
+                    pause();
+            }
+
+            close(pair[1]);
+            sockets.push_back(pair[0]);
+            processes.push_back(pid);
+        }
+
+        bool done = relay(sockets, finished, timeout);
+
+        for (pid_t pid : processes) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+
+        for (int socket : sockets)
+            close(socket);
+
+        return done;
+    }
+
+    Results* results;
+
+private:
+    struct Link {
+        bool connected = false;
+        double loss = 0;
+        int8_t snr = 0;
+    };
+
+    size_t numOfNodes;
+    std::vector<Link> links;
+    std::mt19937 rng{1};
+
+    size_t index(uint16_t from, uint16_t to) { return (from - 1) * numOfNodes + to - 1; }
+
+    bool relay(std::vector<int>& sockets, std::function<bool(Results&)>& finished, uint32_t timeout) {
+        std::vector<pollfd> fds(sockets.size());
+        for (size_t i = 0; i < sockets.size(); i++)
+            fds[i] = pollfd{sockets[i], POLLIN, 0};
+
+        std::uniform_real_distribution<double> random(0, 1);
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+        while (!finished(*results)) {
+            if (std::chrono::steady_clock::now() > end)
+                return false;
+
+            if (poll(fds.data(), fds.size(), 10) <= 0)
+                continue;
+
+            for (size_t from = 0; from < fds.size(); from++) {
+                if (!(fds[from].revents & POLLIN))
+                    continue;
+
+                // The SNR goes before the frame
+                uint8_t frame[257];
+                ssize_t len = recv(sockets[from], &frame[1], sizeof(frame) - 1, 0);
+                if (len <= 0)
+                    continue;
+
+                for (size_t to = 0; to < sockets.size(); to++) {
+                    Link& link = links[from * numOfNodes + to];
+                    if (!link.connected || random(rng) < link.loss)
+                        continue;
+
+                    frame[0] = (uint8_t) link.snr;
+                    send(sockets[to], frame, len + 1, 0);
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+/**
+ * @brief Start LoRaMesher on the node
+ *
+ * @param config Configuration
+ * @return LoraMesher& LoRaMesher of the node
+ */
+inline LoraMesher& lmStartNode(LoraMesher::LoraMesherConfig config = LoraMesher::LoraMesherConfig()) {
+    LoraMesher& radio = LoraMesher::getInstance();
+    radio.begin(config);
+    radio.start();
+    return radio;
+}
+
+/**
+ * @brief Wait until the node has a route to the destination
+ *
+ * @param dst Destination
+ */
+inline void lmWaitRoute(uint16_t dst) {
+    while (!RoutingTableService::hasAddressRoutingTable(dst))
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+}
+
+/**
+ * @brief Call the function with every packet received by the application of the node, from a new task
+ *
+ * @param onReceive Function, the packet is deleted after it
+ */
+inline void lmReceiveAppPackets(void (*onReceive)(AppPacket<uint8_t>*)) {
+    TaskHandle_t handle = nullptr;
+    xTaskCreate([](void* function) {
+        LoraMesher& radio = LoraMesher::getInstance();
+        for (;;) {
+            ulTaskNotifyTake(pdPASS, portMAX_DELAY);
+
+            while (radio.getReceivedQueueSize() > 0) {
+                AppPacket<uint8_t>* packet = radio.getNextAppPacket<uint8_t>();
+                reinterpret_cast<void (*)(AppPacket<uint8_t>*)>(function)(packet);
+                radio.deletePacket(packet);
+            }
+        }
+    }, "Receive app packets", 4096, reinterpret_cast<void*>(onReceive), 2, &handle);
+
+    LoraMesher::getInstance().setReceiveAppDataTaskHandle(handle);
+}
+
+/**
+ * @brief Payload of the tests, every byte depends on its position
+ *
+ * @param size Size in bytes
+ * @return std::vector<uint8_t> Payload
+ */
+inline std::vector<uint8_t> lmTestPayload(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++)
+        payload[i] = i * 7 + 3;
+    return payload;
+}
+
+/**
+ * @brief Check that the packet has the payload of lmTestPayload
+ *
+ * @param packet Packet
+ * @param size Size in bytes
+ * @return true The packet has the whole payload
+ */
+inline bool lmIsTestPayload(AppPacket<uint8_t>* packet, size_t size) {
+    std::vector<uint8_t> payload = lmTestPayload(size);
+    return packet->payloadSize == size && memcmp(packet->payload, payload.data(), size) == 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Minimal checks for the host tests, every test executable returns the number of failed checks
+
+inline int lmTestFailures = 0;
+
+#define LM_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            lmTestFailures++; \
+        } \
+    } while (0)
+
+#define LM_TEST_RESULT() (lmTestFailures == 0 ? 0 : 1)
+
+/**
+ * @brief Run the function the given number of iterations and get the average time of an iteration
+ *
+ * @param iterations Number of iterations
+ * @param function Function called with the iteration index
+ * @return double Nanoseconds per iteration
+ */
+template <class Function>
+double lmBenchmark(size_t iterations, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        function(i);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
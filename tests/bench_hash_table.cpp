@@ -0,0 +1,57 @@
+#include <list>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "utilities/HashTable.hpp"
+
+#include "entities/routingTable/RouteNode.h"
+
+// Lookup of a route by address with a full routing table, against the linear search of a linked list
+
+static constexpr size_t ITERATIONS = 1000000;
+
+int main() {
+    std::mt19937 generator(3);
+    std::vector<uint16_t> addresses;
+
+    auto* table = new LM_HashTable<uint16_t, RouteNode, RTMAXSIZE>();
+    std::list<RouteNode> list;
+
+    while (addresses.size() < RTMAXSIZE) {
+        uint16_t address = generator();
+        if (table->find(address) != nullptr)
+            continue;
+
+        *table->insert(address) = RouteNode(address, 1, 0, address);
+        list.emplace_back(address, 1, 0, address);
+        addresses.push_back(address);
+    }
+
+    std::vector<uint16_t> lookups(4096);
+    for (uint16_t& address : lookups)
+        address = addresses[generator() % addresses.size()];
+
+    size_t found = 0;
+    double tableNs = lmBenchmark(ITERATIONS, [&](size_t i) {
+        found += table->find(lookups[i % lookups.size()]) != nullptr;
+    });
+
+    double listNs = lmBenchmark(ITERATIONS, [&](size_t i) {
+        uint16_t address = lookups[i % lookups.size()];
+        for (RouteNode& node : list) {
+            if (node.networkNode.address == address) {
+                found++;
+                break;
+            }
+        }
+    });
+
+    LM_CHECK(found == 2 * ITERATIONS);
+
+    printf("%d routes: hash table %.1f ns, linked list %.1f ns per lookup\n", RTMAXSIZE, tableNs, listNs);
+
+    delete table;
+    return LM_TEST_RESULT();
+}
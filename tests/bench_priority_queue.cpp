@@ -0,0 +1,64 @@
+#include <list>
+#include <random>
+
+#include "TestUtils.h"
+
+#include "utilities/PriorityQueue.hpp"
+
+#include "entities/packets/QueuePacket.h"
+
+// Push and pop of the send queue with N queued packets, against the ordered insertion into a linked list
+
+using Packet = QueuePacket<int>;
+
+static constexpr size_t ITERATIONS = 200000;
+
+int main() {
+    std::mt19937 generator(1);
+
+    for (size_t queued : {8, 64, 256}) {
+        std::vector<Packet> packets(queued);
+        for (Packet& p : packets)
+            p.priority = generator() % (MAX_PRIORITY + 1);
+
+        // Every popped packet is pushed again with a new priority
+        std::vector<uint8_t> priorities(1024);
+        for (uint8_t& priority : priorities)
+            priority = generator() % (MAX_PRIORITY + 1);
+
+        LM_PriorityQueue<Packet> queue;
+        for (size_t i = 0; i < queued; i++)
+            queue.Push(&packets[i]);
+
+        double queueNs = lmBenchmark(ITERATIONS, [&](size_t i) {
+            Packet* p = queue.Pop();
+            p->priority = priorities[i % priorities.size()];
+            queue.Push(p);
+        });
+
+        std::list<Packet*> list;
+        auto insertOrdered = [&](Packet* p) {
+            auto it = list.begin();
+            while (it != list.end() && (*it)->priority >= p->priority)
+                ++it;
+            list.insert(it, p);
+        };
+
+        for (size_t i = 0; i < queued; i++)
+            insertOrdered(&packets[i]);
+
+        double listNs = lmBenchmark(ITERATIONS, [&](size_t i) {
+            Packet* p = list.front();
+            list.pop_front();
+            p->priority = priorities[i % priorities.size()];
+            insertOrdered(p);
+        });
+
+        LM_CHECK(queue.getLength() == queued);
+        LM_CHECK(list.size() == queued);
+
+        printf("%3zu queued: priority queue %6.1f ns, ordered list %7.1f ns per pop and push\n", queued, queueNs, listNs);
+    }
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <cstdio>
+
+#include "TestUtils.h"
+#include "SimulatedNetwork.h"
+
+// Goodput of a reliable payload between two neighbors, with the selective repeat window of 1 (stop-and-wait) to 8 packets.
+// Without loss the delayed ACKs contend with the data packets of the window for the channel, the window pays off on lossy links
+
+static constexpr uint16_t SENDER = 1, RECEIVER = 2;
+static constexpr size_t PAYLOAD_SIZE = 2000;
+
+struct Results {
+    std::atomic<uint32_t> startTime{0};
+    std::atomic<uint32_t> endTime{0};
+    std::atomic<bool> received{false};
+    std::atomic<bool> intact{false};
+};
+
+static Results* results = nullptr;
+
+static void onReceive(AppPacket<uint8_t>* packet) {
+    results->endTime = millis();
+    results->intact = lmIsTestPayload(packet, PAYLOAD_SIZE);
+    results->received = true;
+}
+
+// Goodput in bytes per second of the simulated time, 0 if the payload is not received
+static double goodput(uint8_t window, double loss) {
+    LmSimulatedNetwork<Results> network(2);
+    network.link(SENDER, RECEIVER, loss);
+    results = network.results;
+
+    bool finished = network.run([window](uint16_t address, Results& r) {
+        LoraMesher::LoraMesherConfig config;
+        config.reliableWindowSize = window;
+        LoraMesher& radio = lmStartNode(config);
+
+        if (address == RECEIVER) {
+            lmReceiveAppPackets(onReceive);
+            return;
+        }
+
+        lmWaitRoute(RECEIVER);
+        std::vector<uint8_t> payload = lmTestPayload(PAYLOAD_SIZE);
+        r.startTime = millis();
+        radio.sendReliablePacket(RECEIVER, payload.data(), PAYLOAD_SIZE);
+    }, [](Results& r) { return r.received.load(); }, 60000);
+
+    LM_CHECK(finished);
+    LM_CHECK(results->intact);
+    if (!finished)
+        return 0;
+
+    return PAYLOAD_SIZE * 1000.0 / (results->endTime - results->startTime);
+}
+
+int main() {
+    // Goodput with the lossy link
+    double stopAndWait = 0, bestWindow = 0;
+    for (double loss : {0.0, 0.1}) {
+        for (uint8_t window : {1, 2, 4, 8}) {
+            double bytesPerSecond = goodput(window, loss);
+            printf("%-28s loss %3d%% window %d: %7.1f B/s\n", "reliable payload goodput", (int) (loss * 100), window, bytesPerSecond);
+
+            if (loss > 0 && window == 1)
+                stopAndWait = bytesPerSecond;
+            if (loss > 0 && window > 1 && bytesPerSecond > bestWindow)
+                bestWindow = bytesPerSecond;
+        }
+    }
+
+    LM_CHECK(bestWindow > stopAndWait);
+
+    return LM_TEST_RESULT();
+}
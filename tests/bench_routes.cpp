@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "services/PacketService.h"
+
+// Bytes per route and cost of the compact routes, compared with the routes as they are in memory.
+// The addresses are spread over the whole address space, or dense
+
+static constexpr size_t ITERATIONS = 100000;
+
+static std::vector<NetworkNode> randomNodes(std::mt19937& rng, size_t numOfNodes, uint16_t maxAddress) {
+    std::vector<NetworkNode> nodes;
+    std::uniform_int_distribution<uint32_t> address(1, maxAddress);
+
+    while (nodes.size() < numOfNodes) {
+        uint16_t nodeAddress = address(rng);
+        if (std::any_of(nodes.begin(), nodes.end(), [&](const NetworkNode& n) { return n.address == nodeAddress; }))
+            continue;
+
+        uint8_t nodeRole = rng() % 8 == 0 ? ROLE_GATEWAY : ROLE_DEFAULT;
+        nodes.push_back(NetworkNode(nodeAddress, 1 + rng() % 6, nodeRole));
+    }
+
+    std::sort(nodes.begin(), nodes.end(), [](const NetworkNode& a, const NetworkNode& b) { return a.address < b.address; });
+    return nodes;
+}
+
+static void benchmark(const char* name, std::vector<NetworkNode> nodes) {
+    std::vector<uint8_t> buffer(nodes.size() * PacketService::MAX_ENCODED_ROUTE_LENGTH);
+    size_t length = 0;
+    size_t numOfEncoded = PacketService::encodeRoutes(nodes.data(), nodes.size(), buffer.data(), buffer.size(), length);
+    LM_CHECK(numOfEncoded == nodes.size());
+
+    double encodeNs = lmBenchmark(ITERATIONS, [&](size_t) {
+        PacketService::encodeRoutes(nodes.data(), nodes.size(), buffer.data(), buffer.size(), length);
+    });
+
+    double decodeNs = lmBenchmark(ITERATIONS, [&](size_t) {
+        size_t numOfDecoded = 0;
+        delete[] PacketService::decodeRoutes(buffer.data(), length, numOfDecoded);
+    });
+
+    printf("%s, %d routes: %.2f bytes per route (%d raw), encode %.1f ns, decode %.1f ns\n", name, (int) nodes.size(),
+        (double) length / nodes.size(), (int) sizeof(NetworkNode), encodeNs, decodeNs);
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    benchmark("Sparse addresses", randomNodes(rng, 32, UINT16_MAX));
+    benchmark("Dense addresses", randomNodes(rng, 32, 255));
+    benchmark("Sparse addresses", randomNodes(rng, 128, UINT16_MAX));
+
+    return LM_TEST_RESULT();
+}
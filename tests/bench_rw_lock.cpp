@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "utilities/RWLock.hpp"
+
+// Cost of the reader/writer lock without contention, and the reads done while a writer updates the table.
+// The same workload with an exclusive lock for the readers shows the gain of sharing it
+
+static constexpr size_t ITERATIONS = 200000;
+
+static uint32_t contendedReads(bool shared, std::chrono::milliseconds duration) {
+    static constexpr int READERS = 4;
+
+    LM_RWLock lock;
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> reads{0};
+    volatile uint32_t table[64] = {0};
+
+    auto read = [&]() {
+        uint32_t sum = 0;
+        for (uint32_t value : table)
+            sum += value;
+        return sum;
+    };
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < READERS; r++) {
+        threads.emplace_back([&]() {
+            while (running.load()) {
+                if (shared) {
+                    lock.readLock();
+                    read();
+                    lock.readUnlock();
+                }
+                else {
+                    lock.writeLock();
+                    read();
+                    lock.writeUnlock();
+                }
+                reads++;
+            }
+        });
+    }
+
+    threads.emplace_back([&]() {
+        while (running.load()) {
+            lock.writeLock();
+            for (volatile uint32_t& value : table)
+                value = value + 1;
+            lock.writeUnlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (std::thread& thread : threads)
+        thread.join();
+
+    return reads.load();
+}
+
+int main() {
+    LM_RWLock lock;
+
+    double readNs = lmBenchmark(ITERATIONS, [&](size_t) {
+        lock.readLock();
+        lock.readUnlock();
+    });
+
+    double writeNs = lmBenchmark(ITERATIONS, [&](size_t) {
+        lock.writeLock();
+        lock.writeUnlock();
+    });
+
+    printf("Uncontended: read lock %.1f ns, write lock %.1f ns\n", readNs, writeNs);
+
+    std::chrono::milliseconds duration(200);
+    uint32_t sharedReads = contendedReads(true, duration);
+    uint32_t exclusiveReads = contendedReads(false, duration);
+
+    LM_CHECK(sharedReads > 0 && exclusiveReads > 0);
+
+    printf("4 readers and a writer for %d ms: %u shared reads, %u exclusive reads\n", (int) duration.count(), sharedReads, exclusiveReads);
+
+    return LM_TEST_RESULT();
+}
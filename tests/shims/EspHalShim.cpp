@@ -0,0 +1,38 @@
+#include "EspHal.h"
+
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+// Host shim of the ESP HAL, the simulated radio does not use the pins nor the SPI
+
+EspHal::EspHal(int8_t sck, int8_t miso, int8_t mosi): RadioLibHal(INPUT, OUTPUT, LOW, HIGH, RISING, FALLING),
+    spiSCK(sck), spiMISO(miso), spiMOSI(mosi), _handle(nullptr) {}
+
+void EspHal::init() {}
+
+void EspHal::term() {}
+
+void EspHal::pinMode(uint32_t, uint32_t) {}
+
+void EspHal::digitalWrite(uint32_t, uint32_t) {}
+
+uint32_t EspHal::digitalRead(uint32_t) { return 0; }
+
+void EspHal::attachInterrupt(uint32_t, void (*)(void), uint32_t) {}
+
+void EspHal::detachInterrupt(uint32_t) {}
+
+void EspHal::delay(unsigned long ms) { vTaskDelay(ms / portTICK_PERIOD_MS); }
+
+void EspHal::delayMicroseconds(unsigned long us) { vTaskDelay(us / 1000 / portTICK_PERIOD_MS); }
+
+unsigned long EspHal::millis() { return (unsigned long) (esp_timer_get_time() / 1000ULL); }
+
+unsigned long EspHal::micros() { return (unsigned long) esp_timer_get_time(); }
+
+long EspHal::pulseIn(uint32_t, uint32_t, unsigned long) { return 0; }
+
+void EspHal::spiTransfer(uint8_t*, size_t len, uint8_t* in) {
+    for (size_t i = 0; i < len; i++)
+        in[i] = 0;
+}
@@ -0,0 +1,272 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "BuildOptions.h"
+
+#include <esp_timer.h>
+#include <hal/efuse_hal.h>
+
+namespace {
+    // Counting semaphore, the mutexes and the binary semaphores have a maximum count of 1
+    struct Semaphore {
+        std::mutex mutex;
+        std::condition_variable available;
+        UBaseType_t count;
+        UBaseType_t maxCount;
+
+        Semaphore(UBaseType_t maxCount_, UBaseType_t count_): count(count_), maxCount(maxCount_) {}
+    };
+
+    std::recursive_mutex criticalMutex;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::atomic<int64_t> advancedTime{0};
+
+    std::atomic<uint32_t> timeScale{1};
+
+    // Real time to wait the given ticks
+    std::chrono::microseconds realDuration(TickType_t ticks) {
+        return std::chrono::microseconds((int64_t) ticks * 1000 / timeScale.load());
+    }
+
+    enum class NotifyState { NOT_WAITING, WAITING, RECEIVED };
+
+    // FreeRTOS task, a detached thread with its notification value
+    struct Task {
+        std::mutex mutex;
+        std::condition_variable changed;
+        uint32_t notifiedValue = 0;
+        NotifyState notifyState = NotifyState::NOT_WAITING;
+        bool suspended = false;
+        UBaseType_t priority;
+
+        Task(UBaseType_t priority_): priority(priority_) {}
+    };
+
+    thread_local Task* currentTask = nullptr;
+
+    // The threads that are not FreeRTOS tasks, like the main thread of the tests, get their task on first use
+    Task* getTask(TaskHandle_t handle) {
+        if (handle != nullptr)
+            return static_cast<Task*>(handle);
+        if (currentTask == nullptr)
+            currentTask = new Task(1);
+        return currentTask;
+    }
+
+    BaseType_t notify(TaskHandle_t handle, uint32_t value, eNotifyAction action) {
+        Task* task = getTask(handle);
+        BaseType_t result = pdPASS;
+
+        std::lock_guard<std::mutex> lock(task->mutex);
+
+        NotifyState previousState = task->notifyState;
+        task->notifyState = NotifyState::RECEIVED;
+
+        switch (action) {
+            case eSetBits:
+                task->notifiedValue |= value;
+                break;
+            case eIncrement:
+                task->notifiedValue++;
+                break;
+            case eSetValueWithOverwrite:
+                task->notifiedValue = value;
+                break;
+            case eSetValueWithoutOverwrite:
+                if (previousState != NotifyState::RECEIVED)
+                    task->notifiedValue = value;
+                else
+                    result = pdFAIL;
+                break;
+            case eNoAction:
+                break;
+        }
+
+        if (previousState == NotifyState::WAITING)
+            task->changed.notify_all();
+
+        return result;
+    }
+
+    // Wait until the task is notified, with the lock of the task
+    void waitNotification(Task* task, std::unique_lock<std::mutex>& lock, TickType_t ticksToWait) {
+        auto isNotified = [task] { return task->notifyState == NotifyState::RECEIVED; };
+        if (ticksToWait == portMAX_DELAY)
+            task->changed.wait(lock, isNotified);
+        else if (ticksToWait > 0)
+            task->changed.wait_for(lock, realDuration(ticksToWait), isNotified);
+    }
+
+    uint16_t localAddress = 1;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new Semaphore(1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new Semaphore(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return new Semaphore(maxCount, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    Semaphore* s = static_cast<Semaphore*>(semaphore);
+    std::unique_lock<std::mutex> lock(s->mutex);
+
+    auto isAvailable = [s] { return s->count > 0; };
+    if (ticksToWait == portMAX_DELAY)
+        s->available.wait(lock, isAvailable);
+    else if (!s->available.wait_for(lock, realDuration(ticksToWait), isAvailable))
+        return pdFALSE;
+
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    Semaphore* s = static_cast<Semaphore*>(semaphore);
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->count >= s->maxCount)
+            return pdFALSE;
+        s->count++;
+    }
+    s->available.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken != nullptr)
+        *higherPriorityTaskWoken = pdFALSE;
+    return xSemaphoreGive(semaphore);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete static_cast<Semaphore*>(semaphore); }
+
+void* pvPortMalloc(size_t size) { return malloc(size); }
+
+void vPortFree(void* p) { free(p); }
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(realDuration(ticks)); }
+
+void taskYIELD() { std::this_thread::yield(); }
+
+TickType_t xTaskGetTickCount() { return esp_timer_get_time() / 1000; }
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char*, uint32_t, void* parameters, UBaseType_t priority, TaskHandle_t* createdTask) {
+    Task* task = new Task(priority);
+    if (createdTask != nullptr)
+        *createdTask = task;
+
+    std::thread([task, function, parameters] {
+        currentTask = task;
+        function(parameters);
+    }).detach();
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+void vTaskSuspend(TaskHandle_t handle) {
+    Task* task = getTask(handle);
+    if (task != currentTask)
+        return;
+
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->suspended = true;
+    task->changed.wait(lock, [task] { return !task->suspended; });
+}
+
+void vTaskResume(TaskHandle_t handle) {
+    Task* task = getTask(handle);
+
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->suspended = false;
+    task->changed.notify_all();
+}
+
+void vTaskPrioritySet(TaskHandle_t handle, UBaseType_t priority) { getTask(handle)->priority = priority; }
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t handle) { return getTask(handle)->priority; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) { return notify(task, value, action); }
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken != nullptr)
+        *higherPriorityTaskWoken = pdFALSE;
+    return notify(task, value, action);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return notify(task, 0, eIncrement); }
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit, uint32_t* notificationValue, TickType_t ticksToWait) {
+    Task* task = getTask(nullptr);
+    std::unique_lock<std::mutex> lock(task->mutex);
+
+    if (task->notifyState != NotifyState::RECEIVED) {
+        task->notifiedValue &= ~bitsToClearOnEntry;
+        task->notifyState = NotifyState::WAITING;
+        waitNotification(task, lock, ticksToWait);
+    }
+
+    if (notificationValue != nullptr)
+        *notificationValue = task->notifiedValue;
+
+    BaseType_t result = pdFALSE;
+    if (task->notifyState == NotifyState::RECEIVED) {
+        task->notifiedValue &= ~bitsToClearOnExit;
+        result = pdTRUE;
+    }
+
+    task->notifyState = NotifyState::NOT_WAITING;
+    return result;
+}
+
+// Like FreeRTOS, a notification that does not increase the value only wakes the task if it is already waiting
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    Task* task = getTask(nullptr);
+    std::unique_lock<std::mutex> lock(task->mutex);
+
+    if (task->notifiedValue == 0) {
+        task->notifyState = NotifyState::WAITING;
+        waitNotification(task, lock, ticksToWait);
+    }
+
+    uint32_t value = task->notifiedValue;
+    if (value != 0)
+        task->notifiedValue = clearCountOnExit ? 0 : value - 1;
+
+    task->notifyState = NotifyState::NOT_WAITING;
+    return value;
+}
+
+void lmShimEnterCritical() { criticalMutex.lock(); }
+
+void lmShimExitCritical() { criticalMutex.unlock(); }
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() * timeScale.load() +
+        advancedTime.load();
+}
+
+void lmShimAdvanceTime(uint32_t ms) { advancedTime += (int64_t) ms * 1000; }
+
+void lmShimSetTimeScale(uint32_t scale) { timeScale = scale; }
+
+void efuse_hal_get_mac(uint8_t* mac) {
+    for (int i = 0; i < 4; i++)
+        mac[i] = 0;
+    mac[4] = localAddress >> 8;
+    mac[5] = localAddress & 0xFF;
+}
+
+void lmShimSetLocalAddress(uint16_t address) { localAddress = address; }
+
+size_t heap_caps_get_free_size(int) { return 0; }
@@ -0,0 +1,172 @@
+#pragma once
+
+// Host shim of RadioLib. All the modules are the same simulated LoRa radio, wired like the SX127x: DIO0 signals the received packets.
+// The frames are exchanged with the other nodes through a socket when their transmission starts, one frame per message with the SNR
+// in the first byte. A frame is received after its time on air, if the radio has been receiving during all of it and no other frame
+// overlaps it. The channel scan detects the frames on the air.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define RADIOLIB_NC (0xFFFFFFFF)
+
+#define RADIOLIB_ERR_NONE (0)
+#define RADIOLIB_ERR_UNKNOWN (-1)
+#define RADIOLIB_ERR_PACKET_TOO_LONG (-4)
+#define RADIOLIB_ERR_TX_TIMEOUT (-5)
+#define RADIOLIB_ERR_CRC_MISMATCH (-7)
+#define RADIOLIB_PREAMBLE_DETECTED (-14)
+#define RADIOLIB_CHANNEL_FREE (-15)
+#define RADIOLIB_ERR_SPI_WRITE_FAILED (-16)
+#define RADIOLIB_LORA_DETECTED (-702)
+
+class RadioLibHal {
+public:
+    const uint32_t GpioModeInput;
+    const uint32_t GpioModeOutput;
+    const uint32_t GpioLevelLow;
+    const uint32_t GpioLevelHigh;
+    const uint32_t GpioInterruptRising;
+    const uint32_t GpioInterruptFalling;
+
+    RadioLibHal(const uint32_t input, const uint32_t output, const uint32_t low, const uint32_t high, const uint32_t rising,
+        const uint32_t falling): GpioModeInput(input), GpioModeOutput(output), GpioLevelLow(low), GpioLevelHigh(high),
+        GpioInterruptRising(rising), GpioInterruptFalling(falling) {}
+
+    virtual ~RadioLibHal() {}
+
+    virtual void init() {}
+    virtual void term() {}
+    virtual void pinMode(uint32_t pin, uint32_t mode) = 0;
+    virtual void digitalWrite(uint32_t pin, uint32_t value) = 0;
+    virtual uint32_t digitalRead(uint32_t pin) = 0;
+    virtual void attachInterrupt(uint32_t interruptNum, void (*interruptCb)(void), uint32_t mode) = 0;
+    virtual void detachInterrupt(uint32_t interruptNum) = 0;
+    virtual void delay(unsigned long ms) = 0;
+    virtual void delayMicroseconds(unsigned long us) = 0;
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;
+    virtual long pulseIn(uint32_t pin, uint32_t state, unsigned long timeout) = 0;
+    virtual void spiBegin() = 0;
+    virtual void spiBeginTransaction() = 0;
+    virtual void spiTransfer(uint8_t* out, size_t len, uint8_t* in) = 0;
+    virtual void spiEndTransaction() = 0;
+    virtual void spiEnd() = 0;
+};
+
+class Module {
+public:
+    Module(RadioLibHal* hal_, uint32_t cs, uint32_t irq, uint32_t rst, uint32_t gpio = RADIOLIB_NC): hal(hal_) {}
+
+    RadioLibHal* hal;
+};
+
+/**
+ * @brief Simulated LoRa radio, with the methods of the RadioLib modules used by LoRaMesher
+ *
+ */
+class LmShimRadio {
+public:
+    LmShimRadio(Module* module_): module(module_) {}
+
+    virtual ~LmShimRadio() {}
+
+    int16_t begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power, uint16_t preambleLength, float tcxoVoltage = 0);
+
+    int16_t receive(uint8_t* data, size_t len);
+    int16_t startReceive();
+    int16_t scanChannel();
+    int16_t startChannelScan();
+    int16_t standby();
+    void reset();
+    int16_t setCRC(uint8_t crc);
+    size_t getPacketLength(bool update = true);
+    float getRSSI();
+    float getSNR();
+    int16_t readData(uint8_t* data, size_t len);
+    int16_t transmit(uint8_t* data, size_t len, uint8_t addr = 0);
+    int16_t startTransmit(uint8_t* data, size_t len, uint8_t addr = 0);
+    int16_t finishTransmit();
+    uint32_t getTimeOnAir(size_t len);
+
+    void setDio0Action(void (*action)(), uint32_t dir = 0x01);
+    void setDio1Action(void (*action)(), uint32_t dir = 0x01);
+    void clearDio0Action();
+    void clearDio1Action();
+    void setPacketReceivedAction(void (*action)());
+    void setPacketSentAction(void (*action)());
+
+    int16_t setFrequency(float freq);
+    int16_t setBandwidth(float bw);
+    int16_t setSpreadingFactor(uint8_t sf);
+    int16_t setCodingRate(uint8_t cr);
+    int16_t setSyncWord(uint8_t syncWord);
+    int16_t setOutputPower(int8_t power);
+    int16_t setOutputPower(int8_t power, int8_t useRfo);
+    int16_t setPreambleLength(uint16_t preambleLength);
+    int16_t setGain(uint8_t gain);
+
+    /**
+     * @brief Start the reception of a frame from the socket, called by the receive thread
+     *
+     * @param data Frame
+     * @param len Length of the frame
+     * @param snr SNR of the frame
+     */
+    void deliver(const uint8_t* data, size_t len, int8_t snr);
+
+private:
+    enum class Mode { STANDBY, RECEIVE, TRANSMIT };
+
+    Module* module;
+
+    std::mutex mutex;
+    Mode mode = Mode::STANDBY;
+
+    float bandwidth = 125;
+    uint8_t spreadingFactor = 7;
+    uint8_t codingRate = 7;
+    uint16_t preamble = 8;
+    bool crc = true;
+
+    uint8_t received[256];
+    size_t receivedLength = 0;
+    int8_t receivedSNR = 0;
+
+    // Frame on the air, corrupted by a collision or by leaving the receive mode
+    struct Reception {
+        std::vector<uint8_t> frame;
+        int8_t snr;
+        bool corrupted;
+    };
+
+    std::vector<std::shared_ptr<Reception>> receptions;
+
+    // Time in ms until the channel is busy
+    uint64_t busyUntil = 0;
+
+    void (*dio0Action)() = nullptr;
+    void (*dio1Action)() = nullptr;
+    void (*sentAction)() = nullptr;
+
+    // Set the mode with the lock, the frames on the air are lost if the radio stops receiving
+    void setMode(Mode newMode);
+
+    // Receive the frame at the end of its time on air
+    void finishReception(std::shared_ptr<Reception> reception);
+
+    // Send the frame to the other nodes and wait its time on air
+    void sendFrame(const uint8_t* data, size_t len);
+};
+
+class SX1276: public LmShimRadio { public: using LmShimRadio::LmShimRadio; };
+class SX1278: public LmShimRadio { public: using LmShimRadio::LmShimRadio; };
+class SX1262: public LmShimRadio { public: using LmShimRadio::LmShimRadio; };
+class SX1268: public LmShimRadio { public: using LmShimRadio::LmShimRadio; };
+class SX1280: public LmShimRadio { public: using LmShimRadio::LmShimRadio; };
+
+// Connect the simulated radio of the process to the other nodes. Call it before creating the radio
+void lmShimSetRadioSocket(int socket);
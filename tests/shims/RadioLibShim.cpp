@@ -0,0 +1,286 @@
+#include <RadioLib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "BuildOptions.h"
+
+namespace {
+    int radioSocket = -1;
+
+    LmShimRadio* activeRadio = nullptr;
+
+    bool receiving = false;
+
+    // Receive thread, the interrupts of the radio are called from it
+    void receiveFrames(int socket) {
+        uint8_t buffer[257];
+        for (;;) {
+            ssize_t len = recv(socket, buffer, sizeof(buffer), 0);
+            if (len <= 0)
+                return;
+
+            if (len > 1 && activeRadio != nullptr)
+                activeRadio->deliver(&buffer[1], len - 1, (int8_t) buffer[0]);
+        }
+    }
+}
+
+void lmShimSetRadioSocket(int socket) { radioSocket = socket; }
+
+int16_t LmShimRadio::begin(float, float bw, uint8_t sf, uint8_t cr, uint8_t, int8_t, uint16_t preambleLength, float) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bandwidth = bw;
+        spreadingFactor = sf;
+        codingRate = cr;
+        preamble = preambleLength;
+    }
+
+    setMode(Mode::STANDBY);
+
+    activeRadio = this;
+
+    if (!receiving && radioSocket >= 0) {
+        receiving = true;
+        std::thread(receiveFrames, radioSocket).detach();
+    }
+
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::receive(uint8_t*, size_t) {
+    // Only the interrupt driven reception is simulated
+    return RADIOLIB_ERR_UNKNOWN;
+}
+
+int16_t LmShimRadio::startReceive() {
+    setMode(Mode::RECEIVE);
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::scanChannel() {
+    setMode(Mode::STANDBY);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return millis() < busyUntil ? RADIOLIB_LORA_DETECTED : RADIOLIB_CHANNEL_FREE;
+}
+
+int16_t LmShimRadio::startChannelScan() {
+    setMode(Mode::STANDBY);
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::standby() {
+    setMode(Mode::STANDBY);
+    return RADIOLIB_ERR_NONE;
+}
+
+void LmShimRadio::reset() {
+    standby();
+}
+
+int16_t LmShimRadio::setCRC(uint8_t crc_) {
+    crc = crc_ != 0;
+    return RADIOLIB_ERR_NONE;
+}
+
+size_t LmShimRadio::getPacketLength(bool) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return receivedLength;
+}
+
+float LmShimRadio::getRSSI() {
+    return -60;
+}
+
+float LmShimRadio::getSNR() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return receivedSNR;
+}
+
+int16_t LmShimRadio::readData(uint8_t* data, size_t len) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memcpy(data, received, std::min(len, receivedLength));
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::transmit(uint8_t* data, size_t len, uint8_t) {
+    if (len > UINT8_MAX)
+        return RADIOLIB_ERR_PACKET_TOO_LONG;
+
+    setMode(Mode::TRANSMIT);
+    sendFrame(data, len);
+    setMode(Mode::STANDBY);
+
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::startTransmit(uint8_t* data, size_t len, uint8_t) {
+    if (len > UINT8_MAX)
+        return RADIOLIB_ERR_PACKET_TOO_LONG;
+
+    setMode(Mode::TRANSMIT);
+
+    // The frame is copied, like inside the FIFO of the radio
+    std::vector<uint8_t> frame(data, data + len);
+    std::thread([this, frame] {
+        sendFrame(frame.data(), frame.size());
+
+        void (*action)() = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (mode == Mode::TRANSMIT)
+                mode = Mode::STANDBY;
+            action = sentAction;
+        }
+
+        if (action != nullptr)
+            action();
+    }).detach();
+
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::finishTransmit() {
+    return standby();
+}
+
+uint32_t LmShimRadio::getTimeOnAir(size_t len) {
+    // Semtech LoRa time on air, with the explicit header. The low data rate optimization is enabled with symbols longer than 16 ms
+    double symbolTime = (1 << spreadingFactor) / (double) bandwidth;
+    int lowDataRate = symbolTime > 16 ? 1 : 0;
+
+    double payloadSymbols = ceil((8.0 * len - 4 * spreadingFactor + 28 + (crc ? 16 : 0)) / (4 * (spreadingFactor - 2 * lowDataRate)));
+    payloadSymbols = 8 + std::max(payloadSymbols * codingRate, 0.0);
+
+    return (uint32_t) ((preamble + 4.25 + payloadSymbols) * symbolTime * 1000);
+}
+
+void LmShimRadio::setDio0Action(void (*action)(), uint32_t) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dio0Action = action;
+}
+
+void LmShimRadio::setDio1Action(void (*action)(), uint32_t) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dio1Action = action;
+}
+
+void LmShimRadio::clearDio0Action() {
+    setDio0Action(nullptr);
+}
+
+void LmShimRadio::clearDio1Action() {
+    setDio1Action(nullptr);
+}
+
+void LmShimRadio::setPacketReceivedAction(void (*action)()) {
+    setDio0Action(action);
+}
+
+void LmShimRadio::setPacketSentAction(void (*action)()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sentAction = action;
+}
+
+int16_t LmShimRadio::setFrequency(float) { return RADIOLIB_ERR_NONE; }
+
+int16_t LmShimRadio::setBandwidth(float bw) {
+    bandwidth = bw;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::setSpreadingFactor(uint8_t sf) {
+    spreadingFactor = sf;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::setCodingRate(uint8_t cr) {
+    codingRate = cr;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::setSyncWord(uint8_t) { return RADIOLIB_ERR_NONE; }
+
+int16_t LmShimRadio::setOutputPower(int8_t) { return RADIOLIB_ERR_NONE; }
+
+int16_t LmShimRadio::setOutputPower(int8_t, int8_t) { return RADIOLIB_ERR_NONE; }
+
+int16_t LmShimRadio::setPreambleLength(uint16_t preambleLength) {
+    preamble = preambleLength;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t LmShimRadio::setGain(uint8_t) { return RADIOLIB_ERR_NONE; }
+
+void LmShimRadio::deliver(const uint8_t* data, size_t len, int8_t snr) {
+    std::shared_ptr<Reception> reception(new Reception{std::vector<uint8_t>(data, data + len), snr, false});
+    uint32_t timeOnAir = getTimeOnAir(len);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        uint64_t end = millis() + timeOnAir / 1000;
+        if (end > busyUntil)
+            busyUntil = end;
+
+        // Without receiving the preamble the frame is lost, only the channel scan detects it
+        if (mode != Mode::RECEIVE)
+            return;
+
+        // The frames that overlap collide
+        reception->corrupted = !receptions.empty();
+        for (auto& other : receptions)
+            other->corrupted = true;
+
+        receptions.push_back(reception);
+    }
+
+    std::thread([this, reception, timeOnAir] {
+        vTaskDelay((timeOnAir + 500) / 1000);
+        finishReception(reception);
+    }).detach();
+}
+
+void LmShimRadio::setMode(Mode newMode) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (newMode != Mode::RECEIVE) {
+        for (auto& reception : receptions)
+            reception->corrupted = true;
+    }
+
+    mode = newMode;
+}
+
+void LmShimRadio::finishReception(std::shared_ptr<Reception> reception) {
+    void (*action)() = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        receptions.erase(std::find(receptions.begin(), receptions.end(), reception));
+
+        if (reception->corrupted || mode != Mode::RECEIVE)
+            return;
+
+        // A new frame overwrites the previous one, like the FIFO of the radio
+        memcpy(received, reception->frame.data(), reception->frame.size());
+        receivedLength = reception->frame.size();
+        receivedSNR = reception->snr;
+        action = dio0Action;
+    }
+
+    if (action != nullptr)
+        action();
+}
+
+void LmShimRadio::sendFrame(const uint8_t* data, size_t len) {
+    if (radioSocket >= 0)
+        send(radioSocket, data, len, 0);
+
+    vTaskDelay((getTimeOnAir(len) + 500) / 1000);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host shim of the ESP-IDF SPI master driver, the simulated radio does not use the SPI
+
+typedef void* spi_device_handle_t;
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+#define MALLOC_CAP_INTERNAL 0
+
+size_t heap_caps_get_free_size(int caps);
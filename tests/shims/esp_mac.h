@@ -0,0 +1,3 @@
+#pragma once
+
+// Host shim of the ESP-IDF MAC API, efuse_hal_get_mac is inside hal/efuse_hal.h
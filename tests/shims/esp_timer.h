@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
+
+// Move the clock forward without waiting, for the timeouts of the tests
+void lmShimAdvanceTime(uint32_t ms);
+
+// Run the clock faster than the real time. The delays and the timeouts of the FreeRTOS shim wait the scaled time
+void lmShimSetTimeScale(uint32_t scale);
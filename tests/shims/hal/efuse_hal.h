@@ -0,0 +1,10 @@
+#pragma once
+
+// Host shim of the ESP-IDF efuse HAL, the MAC address gives the local address of the node
+
+#include <cstdint>
+
+void efuse_hal_get_mac(uint8_t* mac);
+
+// Set the local address of the node, before WiFiService reads it for the first time
+void lmShimSetLocalAddress(uint16_t address);
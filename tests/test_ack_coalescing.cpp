@@ -0,0 +1,64 @@
+#include <atomic>
+
+#include "TestUtils.h"
+#include "SimulatedNetwork.h"
+
+// Delayed ACKs of a reliable payload between two neighbors: one ACK every delayedAckCount packets, without losing the payload
+
+static constexpr uint16_t SENDER = 1, RECEIVER = 2;
+static constexpr size_t PAYLOAD_SIZE = 2000;
+
+struct Results {
+    std::atomic<uint32_t> acksSaved{0};
+    std::atomic<bool> received{false};
+    std::atomic<bool> intact{false};
+};
+
+static Results* results = nullptr;
+
+static void onReceive(AppPacket<uint8_t>* packet) {
+    results->acksSaved = LoraMesher::getInstance().getAcksSavedNum();
+    results->intact = lmIsTestPayload(packet, PAYLOAD_SIZE);
+    results->received = true;
+}
+
+// Send the payload and get the ACKs saved by the receiver
+static uint32_t sendPayload(uint8_t delayedAckCount, double loss) {
+    LmSimulatedNetwork<Results> network(2);
+    network.link(SENDER, RECEIVER, loss);
+    results = network.results;
+
+    bool finished = network.run([delayedAckCount](uint16_t address, Results&) {
+        LoraMesher::LoraMesherConfig config;
+        config.reliableWindowSize = 4;
+        config.delayedAckCount = delayedAckCount;
+        LoraMesher& radio = lmStartNode(config);
+
+        if (address == RECEIVER) {
+            lmReceiveAppPackets(onReceive);
+            return;
+        }
+
+        lmWaitRoute(RECEIVER);
+        std::vector<uint8_t> payload = lmTestPayload(PAYLOAD_SIZE);
+        radio.sendReliablePacket(RECEIVER, payload.data(), PAYLOAD_SIZE);
+    }, [](Results& r) { return r.received.load(); }, 60000);
+
+    LM_CHECK(finished);
+    LM_CHECK(results->intact);
+
+    return results->acksSaved;
+}
+
+int main() {
+    // Every packet is acknowledged
+    LM_CHECK(sendPayload(1, 0) == 0);
+
+    // One ACK every two packets
+    LM_CHECK(sendPayload(2, 0) > 0);
+
+    // The coalesced ACKs still recover the lost packets
+    LM_CHECK(sendPayload(2, 0.1) > 0);
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,154 @@
+#include <cstring>
+
+#include "TestUtils.h"
+
+#include "services/PacketService.h"
+
+static constexpr size_t MAX_PACKET_SIZE = 100;
+
+static uint8_t payload[MAX_PACKET_SIZE];
+
+static void release(Packet<uint8_t>* p) {
+    LM_PacketPool::getInstance().release(p);
+}
+
+// Encode the packet, decode the frame and compare both packets, except the id that is not sent
+static void checkRoundTrip(Packet<uint8_t>* p) {
+    uint8_t frame[UINT8_MAX];
+    size_t frameLength = PacketService::encodeCompactPacket(p, frame);
+    LM_CHECK(frameLength < p->packetSize);
+    LM_CHECK(frameLength == PacketService::getFrameLength(p));
+
+    Packet<uint8_t>* decoded = PacketService::decodeCompactPacket(frame, frameLength);
+    LM_CHECK(decoded != nullptr);
+    if (decoded == nullptr)
+        return;
+
+    LM_CHECK(decoded->dst == p->dst);
+    LM_CHECK(decoded->src == p->src);
+    LM_CHECK(decoded->type == p->type);
+    LM_CHECK(decoded->packetSize == p->packetSize);
+
+    size_t headerLength = sizeof(PacketHeader);
+    LM_CHECK(memcmp(reinterpret_cast<uint8_t*>(decoded) + headerLength, reinterpret_cast<uint8_t*>(p) + headerLength,
+        p->packetSize - headerLength) == 0);
+
+    release(decoded);
+
+    // Any truncated header is rejected
+    size_t headerEnd = frameLength - (p->packetSize - PacketService::getHeaderLength(p->type));
+    for (size_t length = 0; length < headerEnd; length++) {
+        Packet<uint8_t>* truncated = PacketService::decodeCompactPacket(frame, length);
+        LM_CHECK(truncated == nullptr);
+        if (truncated != nullptr)
+            release(truncated);
+    }
+}
+
+static void testDataPackets() {
+    DataPacket* unicast = PacketService::createDataPacket(0x1234, 0xABCD, DATA_P, payload, 20);
+    unicast->via = 0x5678;
+    checkRoundTrip(reinterpret_cast<Packet<uint8_t>*>(unicast));
+    size_t unicastLength = PacketService::getFrameLength(reinterpret_cast<Packet<uint8_t>*>(unicast));
+    release(reinterpret_cast<Packet<uint8_t>*>(unicast));
+
+    // The via is not sent when it is the destination
+    DataPacket* direct = PacketService::createDataPacket(0x1234, 0xABCD, DATA_P, payload, 20);
+    direct->via = 0x1234;
+    uint8_t frame[UINT8_MAX];
+    size_t directLength = PacketService::encodeCompactPacket(reinterpret_cast<Packet<uint8_t>*>(direct), frame);
+    LM_CHECK(directLength == unicastLength - 2);
+    checkRoundTrip(reinterpret_cast<Packet<uint8_t>*>(direct));
+    release(reinterpret_cast<Packet<uint8_t>*>(direct));
+
+    // Neither the destination nor the via of the broadcast packets, the via is decoded as 0
+    DataPacket* broadcast = PacketService::createDataPacket(BROADCAST_ADDR, 0xABCD, DATA_P, payload, 20);
+    broadcast->via = 0;
+    checkRoundTrip(reinterpret_cast<Packet<uint8_t>*>(broadcast));
+    release(reinterpret_cast<Packet<uint8_t>*>(broadcast));
+}
+
+static void testControlPackets() {
+    // Numbers of one, two and three varint bytes
+    uint16_t numbers[] = {0, 127, 128, 300, 16383, 16384, UINT16_MAX};
+    for (uint16_t number : numbers) {
+        ControlPacket* cPacket = PacketService::createControlPacket(0x1234, 0xABCD, NEED_ACK_P | XL_DATA_P, payload, 30);
+        cPacket->via = 0x5678;
+        cPacket->seq_id = 7;
+        cPacket->number = number;
+        checkRoundTrip(reinterpret_cast<Packet<uint8_t>*>(cPacket));
+        release(reinterpret_cast<Packet<uint8_t>*>(cPacket));
+    }
+
+    ControlPacket* ack = PacketService::createEmptyControlPacket(0x1234, 0xABCD, ACK_P, 3, 42);
+    ack->via = 0x1234;
+    checkRoundTrip(reinterpret_cast<Packet<uint8_t>*>(ack));
+    release(reinterpret_cast<Packet<uint8_t>*>(ack));
+}
+
+static void testInvalidFrames() {
+    DataPacket* p = PacketService::createDataPacket(0x1234, 0xABCD, DATA_P, payload, 20);
+    p->via = 0x5678;
+
+    uint8_t frame[UINT8_MAX];
+    size_t frameLength = PacketService::encodeCompactPacket(reinterpret_cast<Packet<uint8_t>*>(p), frame);
+    release(reinterpret_cast<Packet<uint8_t>*>(p));
+
+    // Other version
+    uint8_t first = frame[0];
+    frame[0] = (first & 0x3F) | (((LM_COMPACT_HEADER_VERSION + 1) & 0x03) << 6);
+    LM_CHECK(PacketService::decodeCompactPacket(frame, frameLength) == nullptr);
+    frame[0] = first;
+
+    // Type code without type
+    frame[0] = (first & 0xF0) | 0x0E;
+    LM_CHECK(PacketService::decodeCompactPacket(frame, frameLength) == nullptr);
+    frame[0] = first;
+
+    // Frames that decode into a packet greater than the maximum packet size
+    memset(frame + frameLength, 0, sizeof(frame) - frameLength);
+    LM_CHECK(PacketService::decodeCompactPacket(frame, sizeof(frame)) == nullptr);
+
+    size_t maxFrameLength = frameLength + MAX_PACKET_SIZE - (20 + sizeof(DataPacket));
+    Packet<uint8_t>* largest = PacketService::decodeCompactPacket(frame, maxFrameLength);
+    LM_CHECK(largest != nullptr && largest->packetSize == MAX_PACKET_SIZE);
+    if (largest != nullptr)
+        release(largest);
+    LM_CHECK(PacketService::decodeCompactPacket(frame, maxFrameLength + 1) == nullptr);
+}
+
+static void testTransitFrames() {
+    DataPacket* p = PacketService::createDataPacket(0x1234, 0xABCD, DATA_P, payload, 20);
+    p->via = 0x5678;
+
+    uint8_t frame[UINT8_MAX];
+    size_t frameLength = PacketService::encodeCompactPacket(reinterpret_cast<Packet<uint8_t>*>(p), frame);
+
+    LM_CHECK(PacketService::isTransitFrame(frame, frameLength, 0x5678));
+    LM_CHECK(!PacketService::isTransitFrame(frame, frameLength, 0x1234));
+    LM_CHECK(!PacketService::isTransitFrame(frame, frameLength, 0x1111));
+
+    // The destination is the next hop
+    p->via = 0x1234;
+    frameLength = PacketService::encodeCompactPacket(reinterpret_cast<Packet<uint8_t>*>(p), frame);
+    LM_CHECK(!PacketService::isTransitFrame(frame, frameLength, 0x1234));
+
+    release(reinterpret_cast<Packet<uint8_t>*>(p));
+}
+
+int main() {
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = i * 7 + 3;
+
+    PacketFactory::setMaxPacketSize(MAX_PACKET_SIZE);
+    LM_PacketPool::getInstance().init(MAX_PACKET_SIZE, 8);
+
+    testDataPackets();
+    testControlPackets();
+    testInvalidFrames();
+    testTransitFrames();
+
+    LM_CHECK(LM_PacketPool::getInstance().getUsed() == 0);
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,56 @@
+#include <atomic>
+
+#include "TestUtils.h"
+#include "SimulatedNetwork.h"
+
+// Reliable payload through a line of three nodes, the node in the middle forwards the packets from its receive routine
+
+static constexpr uint16_t SENDER = 1, FORWARDER = 2, RECEIVER = 3;
+static constexpr size_t PAYLOAD_SIZE = 500;
+
+struct Results {
+    std::atomic<uint32_t> fastForwarded{0};
+    std::atomic<bool> received{false};
+    std::atomic<bool> intact{false};
+};
+
+static Results* results = nullptr;
+
+static void onReceive(AppPacket<uint8_t>* packet) {
+    results->intact = lmIsTestPayload(packet, PAYLOAD_SIZE);
+    results->received = true;
+}
+
+int main() {
+    // The sender and the receiver do not hear each other
+    LmSimulatedNetwork<Results> network(3);
+    network.link(SENDER, FORWARDER);
+    network.link(FORWARDER, RECEIVER);
+    results = network.results;
+
+    bool finished = network.run([](uint16_t address, Results& r) {
+        LoraMesher& radio = lmStartNode();
+
+        if (address == RECEIVER) {
+            lmReceiveAppPackets(onReceive);
+            return;
+        }
+
+        if (address == FORWARDER) {
+            for (;;) {
+                r.fastForwarded = radio.getFastForwardedPacketsNum();
+                vTaskDelay(100 / portTICK_PERIOD_MS);
+            }
+        }
+
+        lmWaitRoute(RECEIVER);
+        std::vector<uint8_t> payload = lmTestPayload(PAYLOAD_SIZE);
+        radio.sendReliablePacket(RECEIVER, payload.data(), PAYLOAD_SIZE);
+    }, [](Results& r) { return r.received.load() && r.fastForwarded > 0; }, 120000);
+
+    LM_CHECK(finished);
+    LM_CHECK(results->intact);
+    LM_CHECK(results->fastForwarded > 0);
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+#include <map>
+#include <random>
+
+#include "TestUtils.h"
+
+#include "utilities/HashTable.hpp"
+
+struct Route {
+    uint16_t address = 0;
+    uint8_t metric = 0;
+};
+
+using Table = LM_HashTable<uint16_t, Route, 64>;
+
+static void testBasic() {
+    Table* table = new Table();
+
+    LM_CHECK(table->find(1) == nullptr);
+    LM_CHECK(!table->erase(1));
+
+    Route* route = table->insert(1);
+    LM_CHECK(route != nullptr);
+    route->address = 1;
+    route->metric = 3;
+
+    // Inserting an existing key returns the existing element
+    LM_CHECK(table->insert(1) == route);
+    LM_CHECK(table->find(1)->metric == 3);
+    LM_CHECK(table->size() == 1);
+
+    // Full table
+    for (uint16_t key = 2; key <= 64; key++)
+        LM_CHECK(table->insert(key) != nullptr);
+
+    LM_CHECK(table->isFull());
+    LM_CHECK(table->insert(1000) == nullptr);
+
+    // The elements do not move while they are inside the table
+    LM_CHECK(table->find(1) == route);
+    LM_CHECK(table->erase(2));
+    LM_CHECK(table->find(1) == route);
+    LM_CHECK(table->find(2) == nullptr);
+
+    // Iterate backwards while erasing, as the routing table does
+    for (size_t position = table->size(); position-- > 0;) {
+        if (table->keyAt(position) % 2 == 0)
+            table->erase(table->keyAt(position));
+    }
+
+    size_t count = 0;
+    for (Route& r : *table) {
+        (void) r;
+        count++;
+    }
+
+    LM_CHECK(count == 32);
+    LM_CHECK(table->size() == 32);
+
+    table->clear();
+    LM_CHECK(table->size() == 0);
+    LM_CHECK(table->find(1) == nullptr);
+
+    delete table;
+}
+
+// Random inserts and erases compared with std::map, the keys collide inside the index
+static void testRandom() {
+    Table* table = new Table();
+    std::map<uint16_t, uint8_t> reference;
+    std::mt19937 generator(5);
+
+    for (int operation = 0; operation < 200000; operation++) {
+        uint16_t key = generator() % 200;
+        if (generator() % 3 == 0) {
+            LM_CHECK(table->erase(key) == (reference.erase(key) == 1));
+            continue;
+        }
+
+        Route* route = table->insert(key);
+        if (route == nullptr) {
+            LM_CHECK(reference.size() == 64 && reference.count(key) == 0);
+            continue;
+        }
+
+        route->address = key;
+        route->metric = operation;
+        reference[key] = operation;
+    }
+
+    LM_CHECK(table->size() == reference.size());
+    for (auto& [key, metric] : reference) {
+        Route* route = table->find(key);
+        LM_CHECK(route != nullptr && route->address == key && route->metric == metric);
+    }
+
+    for (size_t position = 0; position < table->size(); position++)
+        LM_CHECK(reference.count(table->keyAt(position)) == 1 && table->at(position)->address == table->keyAt(position));
+
+    delete table;
+}
+
+int main() {
+    testBasic();
+    testRandom();
+
+    return LM_TEST_RESULT();
+}
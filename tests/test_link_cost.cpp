@@ -0,0 +1,119 @@
+#include "TestUtils.h"
+#include "RoutingTestUtils.h"
+
+static constexpr uint16_t LOCAL = 1;
+static constexpr uint16_t N1 = 0x10, N2 = 0x11;
+static constexpr uint16_t A = 0x20;
+static constexpr int8_t FLOOR = -7;
+
+static constexpr uint8_t FULL = LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST;
+
+// Every link costs 1, whatever its quality
+static void testHopCount() {
+    lmClearRoutes();
+    RoutingTableService::setRoutingMetric(LM_HOP_COUNT_METRIC, LM_ROUTE_HYSTERESIS, FLOOR);
+
+    lmReceiveRoutes(N1, 1, FULL, {{A, 1, 0}}, -20, {{LOCAL, -20, 10}});
+    lmReceiveRoutes(N1, 5, 0, {{A, 1, 0}}, -20);
+    LM_CHECK(lmRouteMetric(N1) == 1);
+    LM_CHECK(lmRouteMetric(A) == 2);
+}
+
+// The cost grows every LM_SNR_COST_STEP dB below LM_SNR_COST_MARGIN dB over the floor, with the worst direction of the link
+static void testSNR() {
+    lmClearRoutes();
+    RoutingTableService::setRoutingMetric(LM_SNR_METRIC, 0, FLOOR);
+
+    lmReceiveRoutes(N1, 1, FULL, {{A, 1, 0}}, FLOOR + LM_SNR_COST_MARGIN);
+    LM_CHECK(lmRouteMetric(N1) == 1);
+    LM_CHECK(lmRouteMetric(A) == 2);
+
+    lmReceiveRoutes(N1, 2, 0, {}, FLOOR + LM_SNR_COST_MARGIN - 1);
+    LM_CHECK(lmRouteMetric(N1) == 2);
+
+    lmReceiveRoutes(N1, 3, 0, {}, FLOOR + LM_SNR_COST_MARGIN - LM_SNR_COST_STEP - 1);
+    LM_CHECK(lmRouteMetric(N1) == 3);
+
+    lmReceiveRoutes(N1, 4, 0, {}, FLOOR - 20);
+    LM_CHECK(lmRouteMetric(N1) == LM_MAX_LINK_COST);
+
+    // Good SNR received, but N1 receives our packets near the floor. The SNR sent back is used from the next packet
+    lmReceiveRoutes(N1, 5, 0, {}, 10, {{LOCAL, FLOOR, UINT8_MAX}, {0x30, 10, UINT8_MAX}});
+    LM_CHECK(lmRouteMetric(N1) == 1);
+    lmReceiveRoutes(N1, 6, 0, {}, 10);
+    LM_CHECK(lmRouteMetric(N1) == 4);
+
+    // The link costs of other nodes do not change ours
+    lmReceiveRoutes(N1, 7, 0, {}, 10, {{LOCAL, 10, UINT8_MAX}, {0x30, FLOOR, UINT8_MAX}});
+    lmReceiveRoutes(N1, 8, 0, {}, 10);
+    LM_CHECK(lmRouteMetric(N1) == 1);
+}
+
+// The next hop only changes when the metric improves more than the hysteresis
+static void testHysteresis() {
+    lmClearRoutes();
+    RoutingTableService::setRoutingMetric(LM_SNR_METRIC, 1, FLOOR);
+
+    // Cost 2 via N1
+    lmReceiveRoutes(N1, 1, FULL, {{A, 1, 0}}, FLOOR + LM_SNR_COST_MARGIN - 1);
+    LM_CHECK(lmRouteMetric(A) == 3);
+
+    // Cost 1 via N2, only 1 better
+    lmReceiveRoutes(N2, 1, FULL, {{A, 1, 0}}, 10);
+    LM_CHECK(lmRouteMetric(A) == 3);
+    LM_CHECK(RoutingTableService::getNextHop(A) == N1);
+
+    // The link with N1 gets worse, the metric of the actual next hop changes at once
+    lmReceiveRoutes(N1, 2, 0, {{A, 1, 0}}, FLOOR);
+    LM_CHECK(lmRouteMetric(A) == 5);
+    LM_CHECK(RoutingTableService::getNextHop(A) == N1);
+
+    lmReceiveRoutes(N2, 2, 0, {{A, 1, 0}}, 10);
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(RoutingTableService::getNextHop(A) == N2);
+}
+
+// ETX from the route packets lost in both directions
+static void testETX() {
+    lmClearRoutes();
+    RoutingTableService::setRoutingMetric(LM_ETX_METRIC, 0, FLOOR);
+
+    lmReceiveRoutes(N1, 1, FULL, {{A, 1, 0}});
+    LM_CHECK(lmRouteMetric(N1) == 1);
+    lmReceiveRoutes(N1, 2, 0);
+    LM_CHECK(lmRouteMetric(N1) == 1);
+
+    // 4 route packets lost, a delivery ratio about 0.65
+    lmReceiveRoutes(N1, 7, 0);
+    lmReceiveRoutes(N1, 8, 0);
+    LM_CHECK(lmRouteMetric(N1) == 2);
+
+    // N1 receives a quarter of our route packets
+    lmReceiveRoutes(N1, 9, 0, {}, 10, {{LOCAL, 10, UINT8_MAX / 4}});
+    lmReceiveRoutes(N1, 10, 0);
+    LM_CHECK(lmRouteMetric(N1) == LM_MAX_LINK_COST);
+
+    // No route packets received by N1
+    lmReceiveRoutes(N1, 11, 0, {}, 10, {{LOCAL, 10, 0}});
+    lmReceiveRoutes(N1, 12, 0);
+    LM_CHECK(lmRouteMetric(N1) == LM_MAX_LINK_COST);
+
+    // All received again
+    lmReceiveRoutes(N1, 13, 0, {}, 10, {{LOCAL, 10, UINT8_MAX}});
+    for (uint8_t seq = 14; seq < 40; seq++)
+        lmReceiveRoutes(N1, seq, 0);
+    LM_CHECK(lmRouteMetric(N1) == 1);
+}
+
+int main() {
+    PacketFactory::setMaxPacketSize(LM_MAX_PACKET_SIZE);
+
+    testHopCount();
+    testSNR();
+    testHysteresis();
+    testETX();
+
+    RoutingTableService::setRoutingMetric(LM_ROUTING_METRIC, LM_ROUTE_HYSTERESIS, FLOOR);
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+#include "TestUtils.h"
+
+#include "utilities/LinkedQueue.hpp"
+
+// Counts the live elements, to find the elements deleted twice or never
+struct Element {
+    static inline int alive = 0;
+    int value;
+
+    Element(int value_): value(value_) { alive++; }
+    Element(const Element& other): value(other.value) { alive++; }
+    ~Element() { alive--; }
+};
+
+struct IntrusiveElement: public LM_IntrusiveListNode<IntrusiveElement> {
+    int value;
+
+    IntrusiveElement(int value_): value(value_) {}
+};
+
+static void testPopOwned() {
+    {
+        LM_LinkedList<Element> list;
+        list.setOwnsElements(true);
+
+        for (int i = 0; i < 4; i++)
+            list.Append(new Element(i));
+
+        // The popped element belongs to the caller, it is still alive
+        Element* first = list.Pop();
+        LM_CHECK(first != nullptr && first->value == 0);
+        LM_CHECK(Element::alive == 4);
+        LM_CHECK(list.getLength() == 3);
+        delete first;
+
+        // The deleted ones are deleted by the list
+        list.moveToStart();
+        list.DeleteCurrent();
+        LM_CHECK(Element::alive == 2);
+        LM_CHECK(list.First()->value == 2);
+    }
+
+    LM_CHECK(Element::alive == 0);
+}
+
+static void testPopEmpty() {
+    LM_LinkedList<Element> list;
+    LM_CHECK(list.Pop() == nullptr);
+    LM_CHECK(list.getLength() == 0);
+}
+
+static void testIntrusive() {
+    IntrusiveElement elements[3] = {IntrusiveElement(0), IntrusiveElement(1), IntrusiveElement(2)};
+
+    LM_LinkedList<IntrusiveElement> list;
+    for (IntrusiveElement& element : elements)
+        list.Append(&element);
+
+    int expected = 0;
+    for (IntrusiveElement& element : list)
+        LM_CHECK(element.value == expected++);
+    LM_CHECK(expected == 3);
+
+    // The popped element leaves the list and can be appended to another one
+    IntrusiveElement* first = list.Pop();
+    LM_CHECK(first == &elements[0] && first->next == nullptr && first->prev == nullptr);
+    LM_CHECK(list.First() == &elements[1]);
+
+    LM_LinkedList<IntrusiveElement> other;
+    other.Append(first);
+    LM_CHECK(other.getLength() == 1 && other.First() == first);
+
+    list.Clear();
+    other.Clear();
+}
+
+int main() {
+    testPopOwned();
+    testPopEmpty();
+    testIntrusive();
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,111 @@
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "utilities/PacketPool.hpp"
+
+static void testAllocate(LM_PacketPool& pool) {
+    // The buffer size is rounded to keep the buffers aligned
+    pool.init(98, 4);
+    LM_CHECK(pool.getSize() == 4);
+    LM_CHECK(pool.getBufferSize() == 100);
+
+    std::set<void*> buffers;
+    for (int i = 0; i < 4; i++) {
+        void* p = pool.allocate(100);
+        LM_CHECK(pool.isFromPool(p));
+        LM_CHECK(reinterpret_cast<uintptr_t>(p) % sizeof(uint32_t) == 0);
+        buffers.insert(p);
+    }
+
+    LM_CHECK(buffers.size() == 4);
+    LM_CHECK(pool.getUsed() == 4);
+    LM_CHECK(pool.getPeak() == 4);
+
+    // Exhausted pool
+    void* exhausted = pool.allocate(10);
+    LM_CHECK(exhausted != nullptr && !pool.isFromPool(exhausted));
+    LM_CHECK(pool.getFallbacks() == 1);
+
+    // Greater than the buffers, counted apart from the exhausted pool
+    void* oversized = pool.allocate(101);
+    LM_CHECK(oversized != nullptr && !pool.isFromPool(oversized));
+    LM_CHECK(pool.getOversized() == 1);
+    LM_CHECK(pool.getFallbacks() == 1);
+
+    pool.release(exhausted);
+    pool.release(oversized);
+    LM_CHECK(pool.getUsed() == 4);
+
+    // The pool cannot be replaced while its buffers are in use
+    pool.init(200, 8);
+    LM_CHECK(pool.getBufferSize() == 100);
+
+    void* released = *buffers.begin();
+    pool.release(released);
+    LM_CHECK(pool.getUsed() == 3);
+    LM_CHECK(pool.allocate(50) == released);
+
+    for (void* p : buffers)
+        pool.release(p);
+
+    LM_CHECK(pool.getUsed() == 0);
+    LM_CHECK(pool.getPeak() == 4);
+
+    pool.init(200, 8);
+    LM_CHECK(pool.getBufferSize() == 200);
+    LM_CHECK(pool.getSize() == 8);
+}
+
+static void testConcurrent(LM_PacketPool& pool) {
+    static constexpr int THREADS = 4;
+    static constexpr int ROUNDS = 20000;
+
+    pool.init(64, 8);
+    uint32_t fallbacksBefore = pool.getFallbacks();
+    std::atomic<int> corrupted{0};
+
+    // Every thread writes its id inside the buffers it owns, a buffer given to two threads is overwritten
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            uint8_t* owned[3];
+            for (int round = 0; round < ROUNDS; round++) {
+                for (uint8_t*& p : owned) {
+                    p = static_cast<uint8_t*>(pool.allocate(64));
+                    memset(p, t, 64);
+                }
+
+                for (uint8_t* p : owned) {
+                    for (int i = 0; i < 64; i++) {
+                        if (p[i] != t) {
+                            corrupted++;
+                            break;
+                        }
+                    }
+
+                    pool.release(p);
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    LM_CHECK(corrupted.load() == 0);
+    LM_CHECK(pool.getUsed() == 0);
+    LM_CHECK(pool.getPeak() <= 8);
+    printf("Concurrent allocations: %u fallbacks to the heap\n", (unsigned) (pool.getFallbacks() - fallbacksBefore));
+}
+
+int main() {
+    LM_PacketPool& pool = LM_PacketPool::getInstance();
+
+    testAllocate(pool);
+    testConcurrent(pool);
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,92 @@
+#include "TestUtils.h"
+
+#include "utilities/PriorityQueue.hpp"
+
+#include "entities/packets/QueuePacket.h"
+
+struct Element {
+    uint8_t priority;
+    int id;
+};
+
+using Packet = QueuePacket<int>;
+
+static void testOrder() {
+    LM_PriorityQueue<Element> queue;
+    Element elements[] = {{1, 0}, {5, 1}, {1, 2}, {MAX_PRIORITY + 10, 3}, {5, 4}, {0, 5}};
+
+    for (Element& e : elements)
+        queue.Push(&e);
+
+    LM_CHECK(queue.getLength() == 6);
+    LM_CHECK(queue.First()->id == 3);
+
+    // Greatest priority first, FIFO inside the same priority. Priorities over MAX_PRIORITY are clamped
+    int expected[] = {3, 1, 4, 0, 2, 5};
+    for (int id : expected) {
+        Element* e = queue.Pop();
+        LM_CHECK(e != nullptr && e->id == id);
+    }
+
+    LM_CHECK(queue.Pop() == nullptr);
+    LM_CHECK(queue.First() == nullptr);
+    LM_CHECK(queue.getLength() == 0);
+}
+
+static void testExtract() {
+    LM_PriorityQueue<Packet> queue;
+    Packet packets[6];
+
+    for (int i = 0; i < 6; i++) {
+        packets[i].priority = i % 2 == 0 ? 3 : 7;
+        packets[i].number = i;
+        queue.Push(&packets[i]);
+    }
+
+    // Highest priority match first
+    Packet* p = queue.Extract([](Packet* qp) { return qp->number >= 2; });
+    LM_CHECK(p == &packets[3]);
+
+    p = queue.Extract([](Packet* qp) { return qp->priority == 3 && qp->number == 2; });
+    LM_CHECK(p == &packets[2]);
+
+    LM_CHECK(queue.Extract([](Packet*) { return false; }) == nullptr);
+    LM_CHECK(queue.getLength() == 4);
+
+    // The remaining elements keep their order after removing from the middle, head and tail
+    int expected[] = {1, 5, 0, 4};
+    for (int number : expected) {
+        p = queue.Pop();
+        LM_CHECK(p != nullptr && p->number == number);
+    }
+
+    LM_CHECK(queue.getLength() == 0);
+
+    // Removing the only element of a level clears it
+    queue.Push(&packets[0]);
+    LM_CHECK(queue.Extract([](Packet*) { return true; }) == &packets[0]);
+    LM_CHECK(queue.First() == nullptr);
+}
+
+static void testClear() {
+    LM_PriorityQueue<Element> queue;
+    Element elements[4] = {{1, 0}, {2, 1}, {3, 2}, {4, 3}};
+
+    for (Element& e : elements)
+        queue.Push(&e);
+
+    queue.Clear();
+    LM_CHECK(queue.getLength() == 0);
+    LM_CHECK(queue.Pop() == nullptr);
+
+    queue.Push(&elements[0]);
+    LM_CHECK(queue.Pop() == &elements[0]);
+}
+
+int main() {
+    testOrder();
+    testExtract();
+    testClear();
+
+    return LM_TEST_RESULT();
+}
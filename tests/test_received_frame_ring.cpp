@@ -0,0 +1,95 @@
+#include <thread>
+
+#include "TestUtils.h"
+
+#include "utilities/RingBuffer.hpp"
+
+static void testSingleThread() {
+    // The capacity is rounded up to a power of two
+    LM_ReceivedFrameRing ring(5, 20);
+    LM_CHECK(ring.getCapacity() == 8);
+    LM_CHECK(ring.getMaxFrameSize() == 20);
+    LM_CHECK(ring.peekRead() == nullptr);
+
+    for (int i = 0; i < 8; i++) {
+        LM_ReceivedFrame* frame = ring.acquireWrite();
+        LM_CHECK(frame != nullptr);
+        frame->length = i;
+        memset(frame->data, i, 20);
+        ring.commitWrite();
+    }
+
+    LM_CHECK(ring.acquireWrite() == nullptr);
+    LM_CHECK(ring.getLength() == 8);
+
+    for (int i = 0; i < 8; i++) {
+        LM_ReceivedFrame* frame = ring.peekRead();
+        LM_CHECK(frame != nullptr && frame->length == (size_t) i && frame->data[19] == i);
+        ring.commitRead();
+    }
+
+    LM_CHECK(ring.peekRead() == nullptr);
+    LM_CHECK(ring.getLength() == 0);
+}
+
+// The producer writes numbered frames as fast as it can while the consumer checks that they arrive complete and in order
+static void testStress() {
+    static constexpr uint32_t FRAMES = 1000000;
+    static constexpr size_t FRAME_SIZE = 64;
+
+    LM_ReceivedFrameRing ring(16, FRAME_SIZE);
+    uint32_t full = 0;
+    uint32_t wrong = 0;
+
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < FRAMES;) {
+            LM_ReceivedFrame* frame = ring.acquireWrite();
+            if (frame == nullptr) {
+                full++;
+                std::this_thread::yield();
+                continue;
+            }
+
+            frame->length = 1 + n % FRAME_SIZE;
+            for (size_t i = 0; i < frame->length; i++)
+                frame->data[i] = (uint8_t) (n + i);
+            frame->receivedTime = n;
+            ring.commitWrite();
+            n++;
+        }
+    });
+
+    std::thread consumer([&]() {
+        for (uint32_t n = 0; n < FRAMES;) {
+            LM_ReceivedFrame* frame = ring.peekRead();
+            if (frame == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            bool valid = frame->receivedTime == n && frame->length == 1 + n % FRAME_SIZE;
+            for (size_t i = 0; valid && i < frame->length; i++)
+                valid = frame->data[i] == (uint8_t) (n + i);
+
+            if (!valid)
+                wrong++;
+
+            ring.commitRead();
+            n++;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    LM_CHECK(wrong == 0);
+    LM_CHECK(ring.getLength() == 0);
+    printf("%u frames through a ring of %zu slots, the producer found it full %u times\n", FRAMES, ring.getCapacity(), full);
+}
+
+int main() {
+    testSingleThread();
+    testStress();
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <vector>
+
+#include "TestUtils.h"
+#include "RoutingTestUtils.h"
+
+static constexpr uint16_t NEIGHBOR = 0x10;
+static constexpr uint16_t A = 0x20, B = 0x21, C = 0x22;
+
+static std::vector<uint16_t> removedRoutes;
+
+static void onRouteRemoved(uint16_t address) {
+    removedRoutes.push_back(address);
+}
+
+static bool wasRemoved(uint16_t address) {
+    return std::find(removedRoutes.begin(), removedRoutes.end(), address) != removedRoutes.end();
+}
+
+// A lost delta withdrawing a route leaves a stale route, the next full advertisement removes it
+static void testLostDeltaResync() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 1, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST, {{A, 1, 0}, {B, 1, 0}}));
+    LM_CHECK(lmRouteMetric(NEIGHBOR) == 1);
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(lmRouteMetric(B) == 2);
+
+    // The delta with sequence 2 withdrawing B is lost
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(lmReceiveRoutes(NEIGHBOR, 3, 0, {{C, 1, 0}}));
+    LM_CHECK(lmRouteMetric(B) == 2);
+    LM_CHECK(lmRouteMetric(C) == 2);
+
+    // Still out of sync until the start of a full advertisement
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(lmReceiveRoutes(NEIGHBOR, 4, 0));
+
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 5, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST, {{A, 1, 0}}));
+    LM_CHECK(lmRouteMetric(B) == 2);
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 6, LM_ROUTE_FULL | LM_ROUTE_FULL_LAST, {{C, 1, 0}}));
+
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(lmRouteMetric(NEIGHBOR) == 1);
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(lmRouteMetric(B) == 0);
+    LM_CHECK(lmRouteMetric(C) == 2);
+    LM_CHECK(wasRemoved(B));
+    LM_CHECK(!wasRemoved(A) && !wasRemoved(C));
+}
+
+// A full advertisement with a lost packet could miss any route, it does not remove them
+static void testLostFullAdvertisement() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 10, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST, {{A, 1, 0}, {B, 1, 0}}));
+
+    // The packet with sequence 12 advertising B is lost
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 11, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST, {{A, 1, 0}}));
+    LM_CHECK(lmReceiveRoutes(NEIGHBOR, 13, LM_ROUTE_FULL | LM_ROUTE_FULL_LAST, {{C, 1, 0}}));
+
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(lmRouteMetric(B) == 2);
+    LM_CHECK(lmRouteMetric(C) == 2);
+    LM_CHECK(removedRoutes.empty());
+
+    // The next complete full advertisement removes it
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 14, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST, {{A, 1, 0}, {C, 1, 0}}));
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(lmRouteMetric(B) == 0);
+    LM_CHECK(wasRemoved(B));
+}
+
+// The deltas only refresh the routes inside them, the withdrawn routes are removed at once
+static void testDeltas() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 20, LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST, {{A, 1, 0}, {B, 1, 0}, {C, 1, 0}}));
+
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(!lmReceiveRoutes(NEIGHBOR, 21, 0, {{C, LM_ROUTE_WITHDRAWN_METRIC, 0}}));
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(lmRouteMetric(C) == 0);
+    LM_CHECK(wasRemoved(C));
+
+    // A changes every advertisement, B is not advertised again until it expires
+    uint8_t seq = 22;
+    for (uint32_t elapsed = HELLO_PACKETS_DELAY; elapsed < DEFAULT_TIMEOUT; elapsed += HELLO_PACKETS_DELAY) {
+        LM_CHECK(lmRouteMetric(B) == 2);
+        lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+        LM_CHECK(!lmReceiveRoutes(NEIGHBOR, seq++, 0, {{A, (uint8_t) (seq % 2 + 1), 0}}));
+    }
+
+    lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+    LM_CHECK(lmRouteMetric(B) == 0);
+    LM_CHECK(wasRemoved(B));
+    LM_CHECK(lmRouteMetric(A) != 0);
+    LM_CHECK(lmRouteMetric(NEIGHBOR) == 1);
+}
+
+int main() {
+    PacketFactory::setMaxPacketSize(LM_MAX_PACKET_SIZE);
+
+    RoutingTableService::setRouteRemovedCallback(onRouteRemoved);
+
+    testLostDeltaResync();
+    testLostFullAdvertisement();
+    testDeltas();
+
+    return LM_TEST_RESULT();
+}
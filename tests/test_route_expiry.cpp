@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "RoutingTestUtils.h"
+
+static constexpr uint8_t FULL = LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST;
+
+static std::vector<uint16_t> removedRoutes;
+
+static void onRouteRemoved(uint16_t address) {
+    removedRoutes.push_back(address);
+}
+
+// Every route expires on its own deadline, not before and not later
+static void testDeadlines() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    uint32_t start = millis();
+    lmReceiveRoutes(0x10, 1, FULL, {{0x20, 1, 0}});
+    lmShimAdvanceTime(1000);
+    lmReceiveRoutes(0x11, 1, FULL);
+
+    uint32_t deadline = start + DEFAULT_TIMEOUT * 1000;
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == deadline);
+
+    lmShimAdvanceTime(DEFAULT_TIMEOUT * 1000 - 1000 - 1);
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == deadline);
+    LM_CHECK(!RoutingTableService::hasRemovedRoutes());
+    LM_CHECK(RoutingTableService::routingTableSize() == 3);
+
+    // 0x10 and 0x20 have the same deadline
+    lmShimAdvanceTime(1);
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == deadline + 1000);
+    LM_CHECK(RoutingTableService::hasRemovedRoutes());
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(!RoutingTableService::hasRemovedRoutes());
+    LM_CHECK(removedRoutes.size() == 2);
+    LM_CHECK(RoutingTableService::getNumberOfHops(0x10) == 0 && RoutingTableService::getNumberOfHops(0x20) == 0);
+    LM_CHECK(RoutingTableService::getNumberOfHops(0x11) == 1);
+
+    // A route packet moves the deadline of 0x11
+    lmShimAdvanceTime(500);
+    lmReceiveRoutes(0x11, 2, 0);
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == deadline + 500 + DEFAULT_TIMEOUT * 1000);
+
+    lmShimAdvanceTime(500);
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == deadline + 500 + DEFAULT_TIMEOUT * 1000);
+    LM_CHECK(RoutingTableService::getNumberOfHops(0x11) == 1);
+
+    lmShimAdvanceTime(DEFAULT_TIMEOUT * 1000 - 500);
+    LM_CHECK(RoutingTableService::manageTimeoutRoutingTable() == 0);
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(removedRoutes.size() == 3 && removedRoutes.back() == 0x11);
+    LM_CHECK(RoutingTableService::routingTableSize() == 0);
+}
+
+// Many neighbors heard at random times expire in the order of their deadlines
+static void testExpiryOrder() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    std::mt19937 rng(7);
+    std::vector<uint16_t> neighbors;
+    for (uint16_t address = 0x100; address < 0x100 + 100; address++)
+        neighbors.push_back(address);
+    std::shuffle(neighbors.begin(), neighbors.end(), rng);
+
+    for (uint16_t address : neighbors) {
+        lmReceiveRoutes(address, 1, FULL);
+        lmShimAdvanceTime(1 + rng() % 5000);
+    }
+
+    LM_CHECK(RoutingTableService::routingTableSize() == neighbors.size());
+
+    size_t expired = 0;
+    uint32_t nextTimeout;
+    while ((nextTimeout = RoutingTableService::manageTimeoutRoutingTable()) != 0) {
+        // Only the routes before the deadline have been removed
+        RoutingTableService::dispatchRemovedRoutes();
+        LM_CHECK(removedRoutes.size() == expired);
+
+        lmShimAdvanceTime(nextTimeout - millis());
+        expired++;
+    }
+
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(removedRoutes == neighbors);
+}
+
+int main() {
+    PacketFactory::setMaxPacketSize(LM_MAX_PACKET_SIZE);
+
+    RoutingTableService::setRouteRemovedCallback(onRouteRemoved);
+
+    testDeadlines();
+    testExpiryOrder();
+
+    return LM_TEST_RESULT();
+}
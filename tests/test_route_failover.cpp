@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <vector>
+
+#include "TestUtils.h"
+#include "RoutingTestUtils.h"
+
+static constexpr uint16_t N1 = 0x10, N2 = 0x11, N3 = 0x12;
+static constexpr uint16_t A = 0x20;
+
+static constexpr uint8_t FULL = LM_ROUTE_FULL | LM_ROUTE_FULL_FIRST | LM_ROUTE_FULL_LAST;
+
+static std::vector<uint16_t> removedRoutes;
+
+static void onRouteRemoved(uint16_t address) {
+    removedRoutes.push_back(address);
+}
+
+static bool wasRemoved(uint16_t address) {
+    return std::find(removedRoutes.begin(), removedRoutes.end(), address) != removedRoutes.end();
+}
+
+// Route to A via N1, N2 is an alternative. N3 is as far as the local node from A, it could route through it
+static void addRoutes() {
+    lmClearRoutes();
+    removedRoutes.clear();
+
+    lmReceiveRoutes(N1, 1, FULL, {{A, 1, 0}});
+    lmReceiveRoutes(N2, 1, FULL, {{A, 1, 0}});
+    lmReceiveRoutes(N3, 1, FULL, {{A, 2, 0}});
+
+    LM_CHECK(RoutingTableService::getNextHop(A) == N1);
+    LM_CHECK(lmRouteMetric(A) == 2);
+}
+
+static void testFailNextHop() {
+    addRoutes();
+
+    LM_CHECK(RoutingTableService::failNextHop(N1) == 1);
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(RoutingTableService::getNextHop(A) == N2);
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(lmRouteMetric(N1) == 0);
+    LM_CHECK(wasRemoved(N1));
+    LM_CHECK(!wasRemoved(A));
+
+    // N3 is not a feasible alternative
+    LM_CHECK(RoutingTableService::failNextHop(N2) == 0);
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(RoutingTableService::getNextHop(A) == 0);
+    LM_CHECK(wasRemoved(A));
+    LM_CHECK(lmRouteMetric(N3) == 1);
+}
+
+static void testWithdrawn() {
+    addRoutes();
+
+    lmReceiveRoutes(N1, 2, 0, {{A, LM_ROUTE_WITHDRAWN_METRIC, 0}});
+    RoutingTableService::dispatchRemovedRoutes();
+    LM_CHECK(RoutingTableService::getNextHop(A) == N2);
+    LM_CHECK(!wasRemoved(A));
+
+    // N1 advertises A again, it is an alternative of N2 with the same metric
+    lmReceiveRoutes(N1, 3, 0, {{A, 1, 0}});
+    LM_CHECK(RoutingTableService::getNextHop(A) == N2);
+    LM_CHECK(RoutingTableService::failNextHop(N2) == 1);
+    LM_CHECK(RoutingTableService::getNextHop(A) == N1);
+}
+
+// N1 stops sending route packets, the route to A changes to N2 when N1 times out
+static void testTimeout() {
+    addRoutes();
+
+    uint8_t seq = 2;
+    for (uint32_t elapsed = 0; elapsed < DEFAULT_TIMEOUT; elapsed += HELLO_PACKETS_DELAY) {
+        LM_CHECK(RoutingTableService::getNextHop(A) == N1);
+        lmAdvanceRoutes(HELLO_PACKETS_DELAY * 1000);
+        lmReceiveRoutes(N2, seq++, 0, {{A, 1, 0}});
+    }
+
+    LM_CHECK(lmRouteMetric(N1) == 0);
+    LM_CHECK(RoutingTableService::getNextHop(A) == N2);
+    LM_CHECK(lmRouteMetric(A) == 2);
+    LM_CHECK(wasRemoved(N1));
+    LM_CHECK(!wasRemoved(A));
+}
+
+int main() {
+    PacketFactory::setMaxPacketSize(LM_MAX_PACKET_SIZE);
+
+    RoutingTableService::setRouteRemovedCallback(onRouteRemoved);
+
+    testFailNextHop();
+    testWithdrawn();
+    testTimeout();
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "services/PacketService.h"
+
+static bool equal(const NetworkNode& a, const NetworkNode& b) {
+    return a.address == b.address && a.metric == b.metric && a.role == b.role;
+}
+
+static std::vector<NetworkNode> randomNodes(std::mt19937& rng, size_t numOfNodes, uint16_t maxAddress) {
+    std::vector<NetworkNode> nodes;
+    std::uniform_int_distribution<uint32_t> address(0, maxAddress), metric(0, 255), role(0, 3);
+
+    while (nodes.size() < numOfNodes) {
+        uint16_t nodeAddress = address(rng);
+        if (std::any_of(nodes.begin(), nodes.end(), [&](const NetworkNode& n) { return n.address == nodeAddress; }))
+            continue;
+
+        // Mostly low metrics and the default role, like the real routing tables
+        uint8_t nodeMetric = rng() % 4 == 0 ? metric(rng) : metric(rng) % 8;
+        uint8_t nodeRole = rng() % 4 == 0 ? role(rng) : ROLE_DEFAULT;
+        nodes.push_back(NetworkNode(nodeAddress, nodeMetric, nodeRole));
+    }
+
+    std::sort(nodes.begin(), nodes.end(), [](const NetworkNode& a, const NetworkNode& b) { return a.address < b.address; });
+    return nodes;
+}
+
+// Encode the nodes in a buffer of maxLength bytes and check that the encoded prefix decodes back
+static size_t checkRoundTrip(std::vector<NetworkNode>& nodes, size_t maxLength) {
+    std::vector<uint8_t> buffer(maxLength);
+    size_t length = 0;
+    size_t numOfEncoded = PacketService::encodeRoutes(nodes.data(), nodes.size(), buffer.data(), maxLength, length);
+
+    LM_CHECK(length <= maxLength);
+    LM_CHECK(numOfEncoded <= nodes.size());
+    LM_CHECK(numOfEncoded == 0 || length <= numOfEncoded * PacketService::MAX_ENCODED_ROUTE_LENGTH);
+
+    // Every node fits when there is room for the worst case
+    if (maxLength >= PacketService::MAX_ENCODED_ROUTE_LENGTH)
+        LM_CHECK(numOfEncoded > 0 || nodes.empty());
+
+    size_t numOfDecoded = 0;
+    NetworkNode* decoded = PacketService::decodeRoutes(buffer.data(), length, numOfDecoded);
+    LM_CHECK(numOfDecoded == numOfEncoded);
+    LM_CHECK((decoded == nullptr) == (numOfEncoded == 0));
+
+    for (size_t i = 0; i < numOfDecoded && i < numOfEncoded; i++)
+        LM_CHECK(equal(decoded[i], nodes[i]));
+
+    delete[] decoded;
+    return numOfEncoded;
+}
+
+static void testRoundTrip() {
+    std::mt19937 rng(42);
+
+    for (size_t numOfNodes = 0; numOfNodes < 64; numOfNodes++) {
+        std::vector<NetworkNode> dense = randomNodes(rng, numOfNodes, 255);
+        LM_CHECK(checkRoundTrip(dense, numOfNodes * PacketService::MAX_ENCODED_ROUTE_LENGTH) == numOfNodes);
+
+        std::vector<NetworkNode> sparse = randomNodes(rng, numOfNodes, UINT16_MAX);
+        LM_CHECK(checkRoundTrip(sparse, numOfNodes * PacketService::MAX_ENCODED_ROUTE_LENGTH) == numOfNodes);
+    }
+}
+
+static void testWorstCase() {
+    // Three bytes of varint, the role and the escaped metric
+    std::vector<NetworkNode> nodes = {NetworkNode(0xFFFF, 0xFF, ROLE_GATEWAY)};
+    LM_CHECK(checkRoundTrip(nodes, PacketService::MAX_ENCODED_ROUTE_LENGTH) == 1);
+    LM_CHECK(checkRoundTrip(nodes, PacketService::MAX_ENCODED_ROUTE_LENGTH - 1) == 0);
+
+    // The second node of the pair shares the byte of metrics
+    nodes = {NetworkNode(0x0001, 1, ROLE_DEFAULT), NetworkNode(0xFFFF, 0xFF, ROLE_GATEWAY)};
+    LM_CHECK(checkRoundTrip(nodes, 2) == 1);
+    LM_CHECK(checkRoundTrip(nodes, 2 + PacketService::MAX_ENCODED_ROUTE_LENGTH - 1) == 2);
+}
+
+static void testTruncated() {
+    std::mt19937 rng(7);
+    std::vector<NetworkNode> nodes = randomNodes(rng, 40, UINT16_MAX);
+
+    // Any buffer length encodes a prefix of the nodes, no node fits in less than 2 bytes
+    size_t previous = 0;
+    for (size_t maxLength = 0; maxLength < 40 * PacketService::MAX_ENCODED_ROUTE_LENGTH; maxLength++) {
+        size_t numOfEncoded = checkRoundTrip(nodes, maxLength);
+        if (maxLength < 2)
+            LM_CHECK(numOfEncoded == 0);
+        LM_CHECK(numOfEncoded >= previous);
+        previous = numOfEncoded;
+    }
+
+    LM_CHECK(previous == nodes.size());
+}
+
+static void testInvalid() {
+    size_t numOfNodes = 1;
+
+    // Varint without its last byte
+    uint8_t unfinished[] = {0x01, 0x80};
+    LM_CHECK(PacketService::decodeRoutes(unfinished, sizeof(unfinished), numOfNodes) == nullptr);
+    LM_CHECK(numOfNodes == 0);
+
+    // Varint longer than 3 bytes
+    uint8_t tooLong[] = {0x01, 0x80, 0x80, 0x80, 0x01};
+    LM_CHECK(PacketService::decodeRoutes(tooLong, sizeof(tooLong), numOfNodes) == nullptr);
+
+    // Escaped metric missing
+    uint8_t noMetric[] = {0x0F, 0x02};
+    LM_CHECK(PacketService::decodeRoutes(noMetric, sizeof(noMetric), numOfNodes) == nullptr);
+
+    LM_CHECK(PacketService::decodeRoutes(nullptr, 0, numOfNodes) == nullptr);
+    LM_CHECK(numOfNodes == 0);
+}
+
+// The route packets of the previous versions keep their type and layout, the new ones use a type that the previous versions ignore
+static void testLegacyRoutePackets() {
+    NetworkNode nodes[] = {NetworkNode(0x0102, 1, ROLE_DEFAULT), NetworkNode(0x0304, 2, ROLE_GATEWAY)};
+
+    LegacyRoutePacket* legacy = PacketService::createLegacyRoutingPacket(0x1234, nodes, 2, ROLE_GATEWAY);
+    LM_CHECK(legacy->type == HELLO_P);
+    LM_CHECK(legacy->packetSize == sizeof(PacketHeader) + 1 + 2 * sizeof(NetworkNode));
+    LM_CHECK(legacy->nodeRole == ROLE_GATEWAY);
+    LM_CHECK(legacy->getNetworkNodesSize() == 2);
+    LM_CHECK(equal(legacy->networkNodes[1], nodes[1]));
+    LM_CHECK(PacketService::isHelloPacket(legacy->type) && PacketService::isLegacyHelloPacket(legacy->type));
+    LM_PacketPool::getInstance().release(legacy);
+
+    RoutePacket* route = PacketService::createRoutingPacket(0x1234, reinterpret_cast<uint8_t*>(nodes), sizeof(nodes), ROLE_DEFAULT, 1, LM_ROUTE_FULL);
+    LM_CHECK(route->type == ROUTING_P);
+    LM_CHECK(PacketService::isHelloPacket(route->type) && !PacketService::isLegacyHelloPacket(route->type));
+    LM_PacketPool::getInstance().release(route);
+
+    // The nodes of the previous versions only process the types with the HELLO_P or the DATA_P bits
+    LM_CHECK((ROUTING_P & (HELLO_P | DATA_P)) == 0);
+
+    uint8_t others[] = {DATA_P, ACK_P, XL_DATA_P, LOST_P, SYNC_P, AGGREGATED_P, NEED_ACK_P};
+    for (uint8_t type : others)
+        LM_CHECK(!PacketService::isHelloPacket(type));
+}
+
+int main() {
+    testRoundTrip();
+    testWorstCase();
+    testTruncated();
+    testInvalid();
+    testLegacyRoutePackets();
+
+    return LM_TEST_RESULT();
+}
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+
+#include "utilities/RWLock.hpp"
+
+// Readers and writers hammer the lock. The writers update two values that the readers must always see equal
+static void testContention() {
+    static constexpr int READERS = 4;
+    static constexpr int WRITERS = 2;
+    static constexpr int WRITES = 2000;
+
+    LM_RWLock lock;
+    volatile uint32_t first = 0;
+    volatile uint32_t second = 0;
+    std::atomic<int> readersInside{0};
+    std::atomic<int> maxReadersInside{0};
+    std::atomic<int> writersInside{0};
+    std::atomic<bool> writing{true};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> overlapped{0};
+    std::atomic<uint32_t> reads{0};
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < READERS; r++) {
+        threads.emplace_back([&]() {
+            // The readers never stop while there are writers, the writers cannot be starved
+            while (writing.load()) {
+                lock.readLock();
+
+                int inside = readersInside.fetch_add(1) + 1;
+                int previous = maxReadersInside.load();
+                while (inside > previous && !maxReadersInside.compare_exchange_weak(previous, inside)) {}
+
+                if (writersInside.load() != 0)
+                    overlapped++;
+
+                uint32_t a = first;
+                std::this_thread::yield();
+                if (a != second)
+                    torn++;
+
+                readersInside--;
+                lock.readUnlock();
+                reads++;
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < WRITES; i++) {
+                lock.writeLock();
+
+                if (writersInside.fetch_add(1) != 0 || readersInside.load() != 0)
+                    overlapped++;
+
+                first = first + 1;
+                std::this_thread::yield();
+                second = second + 1;
+
+                writersInside--;
+                lock.writeUnlock();
+            }
+        });
+    }
+
+    for (std::thread& writer : writers)
+        writer.join();
+
+    writing = false;
+    for (std::thread& thread : threads)
+        thread.join();
+
+    LM_CHECK(first == WRITERS * WRITES);
+    LM_CHECK(second == WRITERS * WRITES);
+    LM_CHECK(torn.load() == 0);
+    LM_CHECK(overlapped.load() == 0);
+
+    printf("%u reads, up to %d readers at the same time, %d writes\n", reads.load(), maxReadersInside.load(), WRITERS * WRITES);
+}
+
+int main() {
+    testContention();
+
+    return LM_TEST_RESULT();
+}